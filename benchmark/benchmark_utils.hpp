@@ -0,0 +1,48 @@
+#ifndef VOXEL_GAME_BENCHMARK_BENCHMARK_UTILS_HPP
+#define VOXEL_GAME_BENCHMARK_BENCHMARK_UTILS_HPP
+
+#include "../src/terrain/terrain_edits.hpp"
+
+#include <beyond/math/point.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <vector>
+
+// Shared by the benchmarks of terrain editing
+
+inline constexpr double frame_ms = 1000.0 / 60.0;
+
+// Sample below which `fraction` of the samples lie, zero without samples
+[[nodiscard]] inline auto percentile(std::vector<double> samples,
+                                     double fraction) -> double
+{
+  if (samples.empty()) { return 0; }
+  const auto index = static_cast<std::size_t>(
+      fraction * static_cast<double>(samples.size() - 1));
+  const auto nth = samples.begin() + static_cast<std::ptrdiff_t>(index);
+  std::ranges::nth_element(samples, nth);
+  return samples[index];
+}
+
+// Sphere or box of any mode, centered within the box from `min` to `max`
+[[nodiscard]] inline auto random_brush(std::mt19937& random, beyond::Point3 min,
+                                       beyond::Point3 max, float min_radius,
+                                       float max_radius) -> Brush
+{
+  std::uniform_real_distribution<float> x{min.x, max.x};
+  std::uniform_real_distribution<float> y{min.y, max.y};
+  std::uniform_real_distribution<float> z{min.z, max.z};
+  std::uniform_real_distribution<float> radius{min_radius, max_radius};
+  std::uniform_int_distribution<int> shape{0, 1};
+  std::uniform_int_distribution<int> mode{0, 2};
+  return Brush{
+      .shape = static_cast<BrushShape>(shape(random)),
+      .mode = static_cast<BrushMode>(mode(random)),
+      .center = {x(random), y(random), z(random)},
+      .radius = radius(random),
+  };
+}
+
+#endif // VOXEL_GAME_BENCHMARK_BENCHMARK_UTILS_HPP
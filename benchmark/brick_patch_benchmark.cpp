@@ -0,0 +1,217 @@
+#include "../src/terrain/bricked_mesh.hpp"
+#include "../src/terrain/terrain_edits.hpp"
+#include "benchmark_utils.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Applies a sustained stream of small brushes over a block of chunks of level
+// 0, and remeshes the chunks that read the changed densities the way
+// ChunkManager does, once whole and once by patching their dirty bricks.
+// Reports the time and the bytes to upload per edit on one thread, and
+// checks the patched meshes against whole ones
+
+namespace {
+
+constexpr int edit_count = 2'000;
+// Patched meshes are compared against whole ones every this many edits
+constexpr int verify_interval = 20;
+// Chunks edited, around the terrain surface
+constexpr beyond::IVec3 first_chunk{-2, -1, -2};
+constexpr beyond::IVec3 last_chunk{1, 0, 1};
+// Same as ChunkManager::max_synchronous_edit_bricks
+constexpr int max_synchronous_edit_bricks = 16;
+
+using Clock = std::chrono::steady_clock;
+
+[[nodiscard]] auto mesh_bytes(const ChunkMesh& mesh) -> std::size_t
+{
+  return mesh.vertices.size() * sizeof(Vertex) +
+         mesh.indices.size() * sizeof(std::uint32_t);
+}
+
+using Triangle = std::array<std::byte, 3 * sizeof(Vertex)>;
+
+// Sorted triangles of a mesh, without the degenerate ones, to compare meshes
+// laid out differently
+[[nodiscard]] auto sorted_triangles(const ChunkMesh& mesh)
+    -> std::vector<Triangle>
+{
+  std::vector<Triangle> triangles;
+  for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+    const std::uint32_t* corners = mesh.indices.data() + i;
+    if (corners[0] == corners[1] && corners[1] == corners[2]) { continue; }
+    Triangle& triangle = triangles.emplace_back();
+    for (std::size_t corner = 0; corner < 3; ++corner) {
+      std::memcpy(triangle.data() + corner * sizeof(Vertex),
+                  &mesh.vertices[corners[corner]], sizeof(Vertex));
+    }
+  }
+  std::ranges::sort(triangles);
+  return triangles;
+}
+
+struct PatchedChunk {
+  ChunkKey key;
+  BrickedMesh mesh;
+};
+
+void print_times(const char* label, const std::vector<double>& samples_ms)
+{
+  double total_ms = 0;
+  for (const double ms : samples_ms) { total_ms += ms; }
+  const double mean_ms = total_ms / static_cast<double>(samples_ms.size());
+  const auto within_frame = std::ranges::count_if(
+      samples_ms, [](double ms) { return ms <= frame_ms; });
+  fmt::print("{:<16} {:>9.3f} {:>9.3f} {:>9.3f} {:>10.0f} {:>11.1f}%\n", label,
+             mean_ms, percentile(samples_ms, 0.5),
+             percentile(samples_ms, 0.99), 1000.0 / mean_ms,
+             100.0 * static_cast<double>(within_frame) /
+                 static_cast<double>(samples_ms.size()));
+}
+
+} // anonymous namespace
+
+auto main() -> int
+{
+  TerrainEdits edits;
+  std::mt19937 random{25};
+  // Brushes are centered within the chunks edited
+  const auto lattice_bound = [](int chunk) {
+    return static_cast<float>(chunk_origin(chunk, 1));
+  };
+  const beyond::Point3 brush_min{lattice_bound(first_chunk.x),
+                                 lattice_bound(first_chunk.y),
+                                 lattice_bound(first_chunk.z)};
+  const beyond::Point3 brush_max{lattice_bound(last_chunk.x + 1),
+                                 lattice_bound(last_chunk.y + 1),
+                                 lattice_bound(last_chunk.z + 1)};
+
+  std::vector<PatchedChunk> chunks;
+  for (int z = first_chunk.z; z <= last_chunk.z; ++z) {
+    for (int y = first_chunk.y; y <= last_chunk.y; ++y) {
+      for (int x = first_chunk.x; x <= last_chunk.x; ++x) {
+        const ChunkKey chunk{.position = {x, y, z}};
+        const ChunkDensityField field = generate_density_field(chunk);
+        chunks.push_back({.key = chunk, .mesh = mesh_in_bricks(field)});
+      }
+    }
+  }
+
+  // Per edit, for every chunk it changed
+  std::vector<double> whole_ms;
+  std::vector<double> patch_ms;
+  // Edits patched within max_synchronous_edit_bricks
+  std::vector<double> synchronous_patch_ms;
+  std::size_t whole_bytes = 0;
+  std::size_t patch_bytes = 0;
+  std::size_t moved_bytes = 0; // Copied within the heaps on the GPU
+  std::size_t remeshed_chunk_count = 0;
+  std::size_t dirty_brick_count = 0;
+  std::size_t relayout_count = 0;
+  std::size_t mismatch_count = 0;
+  std::size_t verified_count = 0;
+
+  for (int i = 0; i < edit_count; ++i) {
+    const GridBox points = edits.apply(
+        random_brush(random, brush_min, brush_max, 1.f, 4.f));
+    if (points.is_empty()) { continue; }
+
+    double edit_whole_ms = 0;
+    double edit_patch_ms = 0;
+    int edit_dirty_brick_count = 0;
+    for (PatchedChunk& patched : chunks) {
+      const GridBox changed = lattice_points_in(patched.key, points);
+      if (changed.is_empty()) { continue; }
+      ++remeshed_chunk_count;
+
+      auto start = Clock::now();
+      ChunkDensityField field = generate_density_field(patched.key);
+      edits.add_deltas(patched.key, field);
+      const ChunkMesh whole = mesh_density_field(field);
+      edit_whole_ms +=
+          std::chrono::duration<double, std::milli>(Clock::now() - start)
+              .count();
+      whole_bytes += mesh_bytes(whole);
+
+      const MeshBrickMask dirty = mesh_bricks_reading(
+          {changed.min.x, changed.min.y, changed.min.z},
+          {changed.max.x, changed.max.y, changed.max.z});
+      dirty_brick_count += static_cast<std::size_t>(std::popcount(dirty));
+      edit_dirty_brick_count += std::popcount(dirty);
+      start = Clock::now();
+      ChunkDensityField brick_field;
+      generate_brick_densities(patched.key, dirty, brick_field);
+      edits.add_deltas(patched.key, brick_field);
+      const std::optional<BrickedMeshPatch> patch =
+          patch_bricks(brick_field, patched.mesh.layout, dirty);
+      if (patch) {
+        edit_patch_ms +=
+            std::chrono::duration<double, std::milli>(Clock::now() - start)
+                .count();
+        patch_bytes += mesh_bytes(patch->data);
+        moved_bytes += mesh_bytes(patched.mesh.mesh);
+        apply_patch(*patch, patched.mesh.mesh);
+        patched.mesh.layout = patch->layout;
+      } else {
+        ChunkDensityField relayout_field = generate_density_field(patched.key);
+        edits.add_deltas(patched.key, relayout_field);
+        patched.mesh = mesh_in_bricks(relayout_field);
+        edit_patch_ms +=
+            std::chrono::duration<double, std::milli>(Clock::now() - start)
+                .count();
+        patch_bytes += mesh_bytes(patched.mesh.mesh);
+        ++relayout_count;
+      }
+
+      if (i % verify_interval == 0) {
+        ++verified_count;
+        if (sorted_triangles(patched.mesh.mesh) != sorted_triangles(whole)) {
+          ++mismatch_count;
+        }
+      }
+    }
+    whole_ms.push_back(edit_whole_ms);
+    patch_ms.push_back(edit_patch_ms);
+    if (edit_dirty_brick_count <= max_synchronous_edit_bricks) {
+      synchronous_patch_ms.push_back(edit_patch_ms);
+    }
+  }
+
+  const auto edits_applied = static_cast<double>(whole_ms.size());
+  fmt::print("{} edits over {} chunks of level 0, {:.2f} chunks remeshed per "
+             "edit, {:.1f} of their {} bricks dirty\n",
+             whole_ms.size(), chunks.size(),
+             static_cast<double>(remeshed_chunk_count) / edits_applied,
+             static_cast<double>(dirty_brick_count) /
+                 static_cast<double>(remeshed_chunk_count),
+             mesh_brick_count);
+  fmt::print("{:<16} {:>9} {:>9} {:>9} {:>10} {:>12}\n", "Remesh per edit",
+             "mean (ms)", "p50 (ms)", "p99 (ms)", "edits/s", "<= 16.7 ms");
+  print_times("whole", whole_ms);
+  print_times("dirty bricks", patch_ms);
+  fmt::print("{:.1f}% of the edits have at most {} dirty bricks, and would be "
+             "patched within the frame:\n",
+             100.0 * static_cast<double>(synchronous_patch_ms.size()) /
+                 edits_applied,
+             max_synchronous_edit_bricks);
+  print_times("synchronous", synchronous_patch_ms);
+
+  constexpr double kibibyte = 1024.0;
+  fmt::print("Uploaded per edit: {:.1f} KiB whole, {:.1f} KiB of patches "
+             "(and {:.1f} KiB copied within the heaps)\n",
+             static_cast<double>(whole_bytes) / edits_applied / kibibyte,
+             static_cast<double>(patch_bytes) / edits_applied / kibibyte,
+             static_cast<double>(moved_bytes) / edits_applied / kibibyte);
+  fmt::print("Laid out again: {} of {} remeshes\n", relayout_count,
+             remeshed_chunk_count);
+  fmt::print("Patched meshes different from whole ones: {} of {}\n",
+             mismatch_count, verified_count);
+}
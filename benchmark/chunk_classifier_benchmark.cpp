@@ -0,0 +1,101 @@
+#include "../src/terrain/cpu_mesher.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+
+// How many chunks classify_chunk lets the chunk manager skip, among the chunks
+// of each level of detail within a radius of 5 chunks of the origin, and how
+// much meshing time it saves on the CPU. Also checks that the chunks it skips
+// are indeed all air or all solid
+
+namespace {
+
+constexpr int radius = 5;
+
+struct LevelStats {
+  int chunk_count = 0;
+  int uniform_count = 0; // All air or all solid
+  int skipped_count = 0; // Classified as air or solid
+  int misclassified_count = 0;
+  double classify_us = 0;
+  double skipped_meshing_us = 0; // Generating and meshing the skipped chunks
+};
+
+[[nodiscard]] auto field_contents(const ChunkDensityField& field)
+    -> ChunkContents
+{
+  const auto is_solid = [](float density) { return density < 0.f; };
+  if (std::ranges::none_of(field.densities, is_solid)) {
+    return ChunkContents::air;
+  }
+  if (std::ranges::all_of(field.densities, is_solid)) {
+    return ChunkContents::solid;
+  }
+  return ChunkContents::mixed;
+}
+
+[[nodiscard]] auto measure_level(int lod) -> LevelStats
+{
+  using Clock = std::chrono::steady_clock;
+  LevelStats stats;
+  for (int x = -radius; x <= radius; ++x) {
+    for (int y = -radius; y <= radius; ++y) {
+      for (int z = -radius; z <= radius; ++z) {
+        const ChunkKey chunk{.position = {x, y, z}, .lod = lod};
+        auto start = Clock::now();
+        const ChunkContents contents = classify_chunk(chunk);
+        stats.classify_us +=
+            std::chrono::duration<double, std::micro>(Clock::now() - start)
+                .count();
+
+        start = Clock::now();
+        const ChunkDensityField field = generate_density_field(chunk);
+        const ChunkMesh mesh = mesh_density_field(field);
+        const double meshing_us =
+            std::chrono::duration<double, std::micro>(Clock::now() - start)
+                .count();
+
+        const ChunkContents actual = field_contents(field);
+        ++stats.chunk_count;
+        if (actual != ChunkContents::mixed) { ++stats.uniform_count; }
+        if (contents != ChunkContents::mixed) {
+          ++stats.skipped_count;
+          stats.skipped_meshing_us += meshing_us;
+          if (contents != actual || !mesh.indices.empty()) {
+            ++stats.misclassified_count;
+          }
+        }
+      }
+    }
+  }
+  return stats;
+}
+
+} // anonymous namespace
+
+auto main() -> int
+{
+  fmt::print("Chunks within {} chunks of the origin\n", radius);
+  fmt::print("{:>5} {:>8} {:>8} {:>8} {:>10} {:>14} {:>14} {:>12}\n", "level",
+             "chunks", "uniform", "skipped", "skip rate", "classify (us)",
+             "saved (ms)", "misclassified");
+  LevelStats total;
+  for (int lod = 0; lod < max_chunk_lod_count; ++lod) {
+    const LevelStats stats = measure_level(lod);
+    fmt::print("{:>5} {:>8} {:>8} {:>8} {:>9.1f}% {:>14.2f} {:>14.1f} {:>12}\n",
+               lod, stats.chunk_count, stats.uniform_count, stats.skipped_count,
+               100.0 * stats.skipped_count / stats.chunk_count,
+               stats.classify_us / stats.chunk_count,
+               stats.skipped_meshing_us / 1000.0, stats.misclassified_count);
+    total.chunk_count += stats.chunk_count;
+    total.skipped_count += stats.skipped_count;
+    total.classify_us += stats.classify_us;
+    total.skipped_meshing_us += stats.skipped_meshing_us;
+  }
+  fmt::print("\nSingle-threaded CPU meshing saved: {:.1f} ms, for {:.1f} ms of "
+             "classification of all the {} chunks\n",
+             total.skipped_meshing_us / 1000.0, total.classify_us / 1000.0,
+             total.chunk_count);
+}
@@ -0,0 +1,180 @@
+#include "../src/terrain/chunk_map.hpp"
+#include "../src/terrain/chunk_mesh_store.hpp"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+// Compares ChunkMap with the std::unordered_map that ChunkManager used to track
+// its loaded chunks, on the access patterns of the chunk manager: filling the
+// cube around the camera, probing every chunk of it, probing it again after
+// the camera moved by half the radius, and looking up face neighbors
+
+namespace {
+
+constexpr int repetition_count = 5;
+constexpr int view_radii[] = {5, 16, 32};
+
+using StdChunkMap = std::unordered_map<beyond::IVec3, ChunkHandle>;
+
+[[nodiscard]] auto cube_around(beyond::IVec3 center, int radius)
+    -> std::vector<beyond::IVec3>
+{
+  std::vector<beyond::IVec3> positions;
+  for (int x = -radius; x <= radius; ++x) {
+    for (int y = -radius; y <= radius; ++y) {
+      for (int z = -radius; z <= radius; ++z) {
+        positions.push_back(beyond::IVec3{x, y, z} + center);
+      }
+    }
+  }
+  return positions;
+}
+
+[[nodiscard]] auto handle_of(std::size_t i) -> ChunkHandle
+{
+  return ChunkHandle{.index = static_cast<std::uint32_t>(i)};
+}
+
+void insert_all(ChunkMap<ChunkHandle>& map,
+                const std::vector<beyond::IVec3>& positions)
+{
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    map.try_emplace(ChunkKey{.position = positions[i]}, handle_of(i));
+  }
+}
+void insert_all(StdChunkMap& map, const std::vector<beyond::IVec3>& positions)
+{
+  for (std::size_t i = 0; i < positions.size(); ++i) {
+    map.try_emplace(positions[i], handle_of(i));
+  }
+}
+
+// Returns the number of hits
+[[nodiscard]] auto look_up_all(const ChunkMap<ChunkHandle>& map,
+                               const std::vector<beyond::IVec3>& positions)
+    -> std::size_t
+{
+  std::size_t hits = 0;
+  for (const beyond::IVec3& position : positions) {
+    if (map.contains(ChunkKey{.position = position})) { ++hits; }
+  }
+  return hits;
+}
+[[nodiscard]] auto look_up_all(const StdChunkMap& map,
+                               const std::vector<beyond::IVec3>& positions)
+    -> std::size_t
+{
+  std::size_t hits = 0;
+  for (const beyond::IVec3& position : positions) {
+    if (map.contains(position)) { ++hits; }
+  }
+  return hits;
+}
+
+[[nodiscard]] auto
+look_up_neighbors(ChunkMap<ChunkHandle>& map,
+                  const std::vector<beyond::IVec3>& positions) -> std::size_t
+{
+  std::size_t hits = 0;
+  for (const beyond::IVec3& position : positions) {
+    for (const ChunkHandle* neighbor :
+         map.neighbors(ChunkKey{.position = position})) {
+      if (neighbor != nullptr) { ++hits; }
+    }
+  }
+  return hits;
+}
+[[nodiscard]] auto
+look_up_neighbors(const StdChunkMap& map,
+                  const std::vector<beyond::IVec3>& positions) -> std::size_t
+{
+  static constexpr beyond::IVec3 offsets[] = {
+      {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+  std::size_t hits = 0;
+  for (const beyond::IVec3& position : positions) {
+    for (const beyond::IVec3& offset : offsets) {
+      if (map.contains(position + offset)) { ++hits; }
+    }
+  }
+  return hits;
+}
+
+struct Timings {
+  double insert_ns = 0;
+  double hit_ns = 0;
+  double moved_ns = 0;
+  double neighbor_ns = 0;
+  std::size_t checksum = 0; // Keeps the lookups from being optimized away
+};
+
+// Best time per operation of the repetitions, in nanoseconds
+template <typename Map> [[nodiscard]] auto run(int radius) -> Timings
+{
+  const std::vector<beyond::IVec3> cube = cube_around({}, radius);
+  const std::vector<beyond::IVec3> moved_cube =
+      cube_around({radius / 2, 0, radius / 2}, radius);
+  const auto operation_count = static_cast<double>(cube.size());
+
+  Timings best;
+  for (int repetition = 0; repetition < repetition_count; ++repetition) {
+    using Clock = std::chrono::steady_clock;
+    const auto per_operation = [operation_count](Clock::time_point start,
+                                                 double operations_per_chunk) {
+      const std::chrono::duration<double, std::nano> elapsed =
+          Clock::now() - start;
+      return elapsed.count() / (operation_count * operations_per_chunk);
+    };
+    const auto keep_best = [repetition](double& best_ns, double ns) {
+      if (repetition == 0 || ns < best_ns) { best_ns = ns; }
+    };
+
+    Map map;
+    auto start = Clock::now();
+    insert_all(map, cube);
+    keep_best(best.insert_ns, per_operation(start, 1));
+
+    start = Clock::now();
+    best.checksum += look_up_all(map, cube);
+    keep_best(best.hit_ns, per_operation(start, 1));
+
+    start = Clock::now();
+    best.checksum += look_up_all(map, moved_cube);
+    keep_best(best.moved_ns, per_operation(start, 1));
+
+    start = Clock::now();
+    best.checksum += look_up_neighbors(map, cube);
+    keep_best(best.neighbor_ns, per_operation(start, 6));
+  }
+  return best;
+}
+
+void print_row(const char* name, const Timings& timings)
+{
+  fmt::print("{:>16} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f}\n", name,
+             timings.insert_ns, timings.hit_ns, timings.moved_ns,
+             timings.neighbor_ns);
+}
+
+} // anonymous namespace
+
+auto main() -> int
+{
+  fmt::print("Nanoseconds per operation, best of {}\n", repetition_count);
+  std::size_t checksum = 0;
+  for (const int radius : view_radii) {
+    const int side = 2 * radius + 1;
+    fmt::print("\nRadius {} ({} chunks)\n", radius, side * side * side);
+    fmt::print("{:>16} {:>10} {:>10} {:>10} {:>10}\n", "", "insert", "hit",
+               "moved", "neighbor");
+
+    const Timings chunk_map = run<ChunkMap<ChunkHandle>>(radius);
+    const Timings std_map = run<StdChunkMap>(radius);
+    print_row("ChunkMap", chunk_map);
+    print_row("unordered_map", std_map);
+    checksum += chunk_map.checksum + std_map.checksum;
+  }
+  fmt::print("\n(checksum {})\n", checksum);
+}
@@ -0,0 +1,169 @@
+#include "../src/terrain/chunk_store.hpp"
+#include "../src/terrain/cpu_mesher.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <vector>
+
+// Compares loading chunk meshes from a ChunkStore with generating and meshing
+// them again on the CPU, one chunk at a time on the calling thread. The region
+// files are likely in the page cache, as they would be when revisiting an area
+// soon after leaving it
+
+namespace {
+
+constexpr int repetition_count = 3;
+
+// A band of chunks around the terrain surface, so that most of them have
+// triangles, spanning several regions
+[[nodiscard]] auto benchmark_chunks() -> std::vector<ChunkKey>
+{
+  std::vector<ChunkKey> chunks;
+  for (int x = -12; x < 12; ++x) {
+    for (int y = -2; y <= 0; ++y) {
+      for (int z = -12; z < 12; ++z) {
+        chunks.push_back({.position = {x, y, z}});
+      }
+    }
+  }
+  return chunks;
+}
+
+struct Latencies {
+  double mean_us = 0;
+  double p50_us = 0;
+  double p99_us = 0;
+};
+
+[[nodiscard]] auto summarize(std::vector<double> latencies_us) -> Latencies
+{
+  std::ranges::sort(latencies_us);
+  double total_us = 0;
+  for (const double latency : latencies_us) { total_us += latency; }
+  const auto percentile = [&](double p) {
+    return latencies_us[static_cast<std::size_t>(
+        p * static_cast<double>(latencies_us.size() - 1))];
+  };
+  return Latencies{
+      .mean_us = total_us / static_cast<double>(latencies_us.size()),
+      .p50_us = percentile(0.5),
+      .p99_us = percentile(0.99),
+  };
+}
+
+// Latency of `function` for each chunk, best of the repetitions
+template <typename Function>
+[[nodiscard]] auto measure(const std::vector<ChunkKey>& chunks,
+                           Function function) -> std::vector<double>
+{
+  std::vector<double> best_us(chunks.size());
+  for (int repetition = 0; repetition < repetition_count; ++repetition) {
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+      const auto start = std::chrono::steady_clock::now();
+      function(chunks[i]);
+      const std::chrono::duration<double, std::micro> elapsed =
+          std::chrono::steady_clock::now() - start;
+      if (repetition == 0 || elapsed.count() < best_us[i]) {
+        best_us[i] = elapsed.count();
+      }
+    }
+  }
+  return best_us;
+}
+
+void print_row(const char* name, const Latencies& latencies)
+{
+  fmt::print("{:>12} {:>10.1f} {:>10.1f} {:>10.1f}\n", name,
+             latencies.mean_us, latencies.p50_us, latencies.p99_us);
+}
+
+[[nodiscard]] auto directory_size(const std::filesystem::path& directory)
+    -> std::uintmax_t
+{
+  std::uintmax_t size = 0;
+  for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+    size += entry.file_size();
+  }
+  return size;
+}
+
+} // anonymous namespace
+
+auto main() -> int
+{
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path() / "voxel_game_chunk_store";
+  std::filesystem::remove_all(directory);
+
+  const std::vector<ChunkKey> chunks = benchmark_chunks();
+  std::vector<ChunkMesh> meshes;
+  meshes.reserve(chunks.size());
+  std::size_t raw_bytes = 0;
+  for (const ChunkKey& chunk : chunks) {
+    meshes.push_back(mesh_chunk_on_cpu(chunk));
+    raw_bytes += meshes.back().vertices.size() * sizeof(Vertex) +
+                 meshes.back().indices.size() * sizeof(std::uint32_t);
+  }
+  {
+    ChunkStore store{directory};
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+      store.save(chunks[i], 0, meshes[i]);
+    }
+  }
+
+  constexpr double mebibyte = 1024.0 * 1024.0;
+  fmt::print("{} chunks, {:.1f} MiB of meshes, {:.1f} MiB on disk\n",
+             chunks.size(), static_cast<double>(raw_bytes) / mebibyte,
+             static_cast<double>(directory_size(directory)) / mebibyte);
+
+  std::size_t checksum = 0;
+  const Latencies regenerated = summarize(
+      measure(chunks, [&](ChunkKey chunk) {
+        checksum += mesh_chunk_on_cpu(chunk).indices.size();
+      }));
+
+  ChunkStore store{directory};
+  const Latencies loaded =
+      summarize(measure(chunks, [&](ChunkKey chunk) {
+        const std::optional<ChunkMesh> mesh = store.load(chunk, 0);
+        checksum += mesh ? mesh->indices.size() : 0;
+      }));
+
+  const auto same_vertex = [](const Vertex& a, const Vertex& b) {
+    return std::ranges::equal(a.position, b.position) &&
+           std::ranges::equal(a.normal, b.normal);
+  };
+  std::size_t mismatch_count = 0;
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    const std::optional<ChunkMesh> mesh = store.load(chunks[i], 0);
+    if (!mesh || mesh->indices != meshes[i].indices ||
+        !std::ranges::equal(mesh->vertices, meshes[i].vertices,
+                            same_vertex)) {
+      ++mismatch_count;
+    }
+  }
+
+  fmt::print("\nMicroseconds per chunk, best of {}\n", repetition_count);
+  fmt::print("{:>12} {:>10} {:>10} {:>10}\n", "", "mean", "p50", "p99");
+  print_row("regenerated", regenerated);
+  print_row("loaded", loaded);
+  fmt::print("{:.1f}x faster from the store, {} mismatched meshes\n",
+             regenerated.mean_us / loaded.mean_us, mismatch_count);
+
+  // Every chunk saved again makes all the previous payloads stale
+  for (int pass = 0; pass < 2; ++pass) {
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+      store.save(chunks[i], 0, meshes[i]);
+    }
+    fmt::print("After saving every chunk again: {:.1f} MiB on disk, {} "
+               "compactions\n",
+               static_cast<double>(directory_size(directory)) / mebibyte,
+               store.stats().compaction_count);
+  }
+
+  fmt::print("(checksum {})\n", checksum);
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,146 @@
+#include "../src/terrain/chunk_volume.hpp"
+#include "../src/terrain/cpu_mesher.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+
+// Memory footprint of ChunkVolume on the generated terrain, over the cube of
+// radius 5 around the origin, against the float density field it compresses.
+// Also checks how far the densities within ChunkVolume::max_exact_density and
+// the meshes of the compressed chunks are from the original ones
+
+namespace {
+
+constexpr int radius = 5;
+
+enum class ChunkClass { air, solid, surface };
+
+struct ClassStats {
+  std::size_t chunk_count = 0;
+  std::size_t total_bytes = 0;
+};
+
+struct MeshError {
+  std::size_t topology_mismatch_count = 0; // Different triangles
+  float max_position_error = 0;            // In cells
+  float min_normal_cos = 1;
+};
+
+void compare_meshes(const ChunkMesh& original, const ChunkMesh& compressed,
+                    MeshError& error)
+{
+  if (original.indices != compressed.indices ||
+      original.vertices.size() != compressed.vertices.size()) {
+    ++error.topology_mismatch_count;
+    return;
+  }
+  using namespace vertex_packing;
+  for (std::size_t i = 0; i < original.vertices.size(); ++i) {
+    const Vertex& a = original.vertices[i];
+    const Vertex& b = compressed.vertices[i];
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      const float delta = dequantize_position(a.position[axis]) -
+                          dequantize_position(b.position[axis]);
+      error.max_position_error =
+          std::max(error.max_position_error, std::abs(delta));
+    }
+    const auto n = decode_octahedral({a.normal[0], a.normal[1]});
+    const auto m = decode_octahedral({b.normal[0], b.normal[1]});
+    const auto dot = [](std::array<float, 3> u, std::array<float, 3> v) {
+      return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+    };
+    const float cos = dot(n, m) / std::sqrt(dot(n, n) * dot(m, m));
+    error.min_normal_cos = std::min(error.min_normal_cos, cos);
+  }
+}
+
+} // anonymous namespace
+
+auto main() -> int
+{
+  std::array<ClassStats, 3> class_stats{};
+  MeshError mesh_error;
+  float max_density_error = 0; // Within ChunkVolume::max_exact_density
+  double compress_seconds = 0;
+  double decompress_seconds = 0;
+  std::size_t chunk_count = 0;
+
+  for (int x = -radius; x <= radius; ++x) {
+    for (int y = -radius; y <= radius; ++y) {
+      for (int z = -radius; z <= radius; ++z) {
+        const ChunkKey chunk{.position = {x, y, z}};
+        const ChunkDensityField field = generate_density_field(chunk);
+
+        using Clock = std::chrono::steady_clock;
+        auto start = Clock::now();
+        const ChunkVolume volume = ChunkVolume::from_density_field(field);
+        compress_seconds +=
+            std::chrono::duration<double>(Clock::now() - start).count();
+        start = Clock::now();
+        const ChunkDensityField decompressed = volume.to_density_field();
+        decompress_seconds +=
+            std::chrono::duration<double>(Clock::now() - start).count();
+        ++chunk_count;
+
+        ChunkClass chunk_class = ChunkClass::surface;
+        if (volume.palette_size() == 1) {
+          chunk_class = volume.material_at(0, 0, 0) == air_material
+                            ? ChunkClass::air
+                            : ChunkClass::solid;
+        }
+        ClassStats& stats = class_stats[static_cast<std::size_t>(chunk_class)];
+        ++stats.chunk_count;
+        stats.total_bytes += volume.memory_bytes();
+
+        for (std::size_t i = 0; i < ChunkDensityField::point_count; ++i) {
+          const float density = field.densities[i];
+          if (std::abs(density) > ChunkVolume::max_exact_density) { continue; }
+          // Relative, except for the densities too close to the isolevel
+          const float error = std::abs(decompressed.densities[i] - density) /
+                              std::max(std::abs(density), 1e-3f);
+          max_density_error = std::max(max_density_error, error);
+        }
+        if (chunk_class == ChunkClass::surface) {
+          compare_meshes(mesh_density_field(field),
+                         mesh_density_field(decompressed), mesh_error);
+        }
+      }
+    }
+  }
+
+  constexpr std::size_t field_bytes =
+      ChunkDensityField::point_count * sizeof(float);
+  fmt::print("{} chunks, {} bytes per chunk as a float density field\n",
+             chunk_count, field_bytes);
+  fmt::print("{:>10} {:>8} {:>16}\n", "", "chunks", "bytes per chunk");
+  std::size_t total_bytes = 0;
+  constexpr const char* class_names[] = {"air", "solid", "surface"};
+  for (std::size_t i = 0; i < class_stats.size(); ++i) {
+    const ClassStats& stats = class_stats[i];
+    total_bytes += stats.total_bytes;
+    if (stats.chunk_count == 0) { continue; }
+    fmt::print("{:>10} {:>8} {:>16.0f}\n", class_names[i], stats.chunk_count,
+               static_cast<double>(stats.total_bytes) /
+                   static_cast<double>(stats.chunk_count));
+  }
+  const double mean_bytes =
+      static_cast<double>(total_bytes) / static_cast<double>(chunk_count);
+  fmt::print("{:>10} {:>8} {:>16.0f} ({:.1f}x smaller)\n", "all", chunk_count,
+             mean_bytes, static_cast<double>(field_bytes) / mean_bytes);
+
+  fmt::print("\nCompress {:.1f} us, decompress {:.1f} us per chunk\n",
+             1e6 * compress_seconds / static_cast<double>(chunk_count),
+             1e6 * decompress_seconds / static_cast<double>(chunk_count));
+  fmt::print("Max relative error of the densities within {}: {:.3f}\n",
+             static_cast<double>(ChunkVolume::max_exact_density),
+             static_cast<double>(max_density_error));
+  fmt::print("Meshes of the surface chunks: {} with other triangles, max "
+             "vertex error {:.4f} cells, min normal cos {:.5f}\n",
+             mesh_error.topology_mismatch_count,
+             static_cast<double>(mesh_error.max_position_error),
+             static_cast<double>(mesh_error.min_normal_cos));
+}
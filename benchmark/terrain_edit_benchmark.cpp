@@ -0,0 +1,116 @@
+#include "../src/concurrency/thread_pool.hpp"
+#include "../src/terrain/terrain_edits.hpp"
+#include "benchmark_utils.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Applies 10k random brushes around the terrain surface, and remeshes the
+// chunks of level 0 that read the densities changed by some of them on a
+// thread pool, the way ChunkManager::apply_edit does. Reports how long the
+// edits take to apply, and how long until the meshes of the edited chunks are
+// ready
+
+namespace {
+
+constexpr int edit_count = 10'000;
+// Every edit is applied, but only these are remeshed
+constexpr int remesh_interval = 10;
+// Brushes up to this many chunks are expected to be drawn in the next frame
+constexpr std::size_t max_small_edit_chunk_count = 8;
+
+using Clock = std::chrono::steady_clock;
+
+void print_latencies(const char* label, const std::vector<double>& samples_ms)
+{
+  if (samples_ms.empty()) { return; }
+  const auto within_frame = std::ranges::count_if(
+      samples_ms, [](double ms) { return ms <= frame_ms; });
+  fmt::print("{:<22} {:>6} {:>9.2f} {:>9.2f} {:>9.2f} {:>11.1f}%\n", label,
+             samples_ms.size(), percentile(samples_ms, 0.5),
+             percentile(samples_ms, 0.99), std::ranges::max(samples_ms),
+             100.0 * static_cast<double>(within_frame) /
+                 static_cast<double>(samples_ms.size()));
+}
+
+} // anonymous namespace
+
+auto main() -> int
+{
+  TerrainEdits edits;
+  ThreadPool pool;
+  std::mt19937 random{24};
+
+  std::vector<double> apply_us;
+  std::vector<double> small_latencies_ms; // Edit to meshes, small brushes
+  std::vector<double> large_latencies_ms;
+  std::size_t remeshed_chunk_count = 0;
+  std::size_t triangle_count = 0;
+  apply_us.reserve(edit_count);
+
+  for (int i = 0; i < edit_count; ++i) {
+    // Around the terrain surface
+    const Brush brush = random_brush(random, {-96.f, -40.f, -96.f},
+                                     {96.f, 40.f, 96.f}, 1.f, 8.f);
+    const auto start = Clock::now();
+    const GridBox points = edits.apply(brush);
+    apply_us.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - start)
+            .count());
+    if (i % remesh_interval != 0 || points.is_empty()) { continue; }
+
+    std::vector<ChunkKey> chunks;
+    const GridBox reading = chunks_reading(points, 0);
+    for (int z = reading.min.z; z <= reading.max.z; ++z) {
+      for (int y = reading.min.y; y <= reading.max.y; ++y) {
+        for (int x = reading.min.x; x <= reading.max.x; ++x) {
+          chunks.push_back({.position = {x, y, z}});
+        }
+      }
+    }
+    std::vector<std::size_t> triangles(chunks.size());
+    for (std::size_t c = 0; c < chunks.size(); ++c) {
+      pool.submit(
+          [&, c] {
+            ChunkDensityField field = generate_density_field(chunks[c]);
+            edits.add_deltas(chunks[c], field);
+            triangles[c] = mesh_density_field(field).indices.size() / 3;
+          },
+          TaskPriority::high);
+    }
+    pool.wait_idle();
+    const double latency_ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    (chunks.size() <= max_small_edit_chunk_count ? small_latencies_ms
+                                                 : large_latencies_ms)
+        .push_back(latency_ms);
+    remeshed_chunk_count += chunks.size();
+    for (const std::size_t count : triangles) { triangle_count += count; }
+  }
+
+  double total_apply_us = 0;
+  for (const double us : apply_us) { total_apply_us += us; }
+  fmt::print("{} edits applied in {:.1f} ms: p50 {:.1f} us, p99 {:.1f} us, "
+             "max {:.1f} us\n",
+             edit_count, total_apply_us / 1000.0, percentile(apply_us, 0.5),
+             percentile(apply_us, 0.99), std::ranges::max(apply_us));
+  fmt::print("{} bricks, {:.2f} MiB of deltas\n", edits.brick_count(),
+             static_cast<double>(edits.memory_bytes()) / (1024.0 * 1024.0));
+
+  fmt::print("\nEdit to meshes of level 0 with {} worker threads, every {}th "
+             "edit, {} chunks remeshed ({} triangles)\n",
+             pool.thread_count(), remesh_interval, remeshed_chunk_count,
+             triangle_count);
+  fmt::print("{:<22} {:>6} {:>9} {:>9} {:>9} {:>12}\n", "", "edits",
+             "p50 (ms)", "p99 (ms)", "max (ms)", "<= 16.7 ms");
+  print_latencies(fmt::format("<= {} chunks", max_small_edit_chunk_count)
+                      .c_str(),
+                  small_latencies_ms);
+  print_latencies(fmt::format("> {} chunks", max_small_edit_chunk_count)
+                      .c_str(),
+                  large_latencies_ms);
+}
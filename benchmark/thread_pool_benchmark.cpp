@@ -0,0 +1,92 @@
+#include "../src/concurrency/mpsc_queue.hpp"
+#include "../src/concurrency/thread_pool.hpp"
+#include "../src/terrain/cpu_mesher.hpp"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Meshes the same set of chunks on the CPU with 1 to 32 worker threads, the
+// way ChunkManager does with its CPU backend: one task per chunk, results
+// handed back to the calling thread through an MPSC queue
+
+namespace {
+
+constexpr int repetition_count = 3;
+constexpr std::size_t max_thread_count = 32;
+
+// A band of chunks around the terrain surface, so that most of them have
+// triangles
+[[nodiscard]] auto benchmark_chunks() -> std::vector<ChunkKey>
+{
+  std::vector<ChunkKey> chunks;
+  for (int x = -6; x < 6; ++x) {
+    for (int y = -2; y <= 0; ++y) {
+      for (int z = -6; z < 6; ++z) {
+        chunks.push_back({.position = {x, y, z}});
+      }
+    }
+  }
+  return chunks;
+}
+
+// Returns the best wall time of the repetitions, in seconds
+[[nodiscard]] auto mesh_chunks(std::size_t thread_count,
+                               const std::vector<ChunkKey>& chunks)
+    -> double
+{
+  ThreadPool pool{thread_count};
+  double best_seconds = 0;
+  for (int repetition = 0; repetition < repetition_count; ++repetition) {
+    MpscQueue<ChunkMesh> completed;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (const ChunkKey& chunk : chunks) {
+      pool.submit([&completed, chunk] {
+        completed.push(mesh_chunk_on_cpu(chunk));
+      });
+    }
+    std::size_t received = 0;
+    while (received < chunks.size()) {
+      if (completed.try_pop()) {
+        ++received;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    if (repetition == 0 || elapsed.count() < best_seconds) {
+      best_seconds = elapsed.count();
+    }
+  }
+  return best_seconds;
+}
+
+} // anonymous namespace
+
+auto main() -> int
+{
+  const std::vector<ChunkKey> chunks = benchmark_chunks();
+  fmt::print("Meshing {} chunks on the CPU ({} density), {} hardware "
+             "threads, best of {}\n",
+             chunks.size(), density_instruction_set(),
+             std::thread::hardware_concurrency(), repetition_count);
+  fmt::print("{:>8} {:>12} {:>8} {:>11}\n", "threads", "chunks/s", "speedup",
+             "efficiency");
+
+  double single_thread_seconds = 0;
+  for (std::size_t thread_count = 1; thread_count <= max_thread_count;
+       thread_count *= 2) {
+    const double seconds = mesh_chunks(thread_count, chunks);
+    if (thread_count == 1) { single_thread_seconds = seconds; }
+
+    const double speedup = single_thread_seconds / seconds;
+    fmt::print("{:>8} {:>12.1f} {:>7.2f}x {:>10.0f}%\n", thread_count,
+               static_cast<double>(chunks.size()) / seconds, speedup,
+               100.0 * speedup / static_cast<double>(thread_count));
+  }
+}
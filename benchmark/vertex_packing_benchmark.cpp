@@ -0,0 +1,302 @@
+#include "../src/terrain/cpu_mesher.hpp"
+#include "../src/vertex.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// Checks the packed vertices of the CPU mesher against the float positions and
+// normals they are packed from, and the packing and decoding of
+// terrain_vertex.glsl against those of vertex.hpp. Exits with a failure when
+// an error is out of bounds
+
+namespace {
+
+using vertex_packing::decode_octahedral;
+using vertex_packing::dequantize_position;
+using vertex_packing::encode_octahedral;
+using vertex_packing::quantize_position;
+
+// Half a quantization step, plus slack for float rounding
+constexpr float max_position_error =
+    0.5f * Vertex::position_extent / 65535.f + 1e-5f;
+
+// cos^2 of 0.06 degree. The actual error of a 16-bit octahedral encoding is
+// far smaller, the bound leaves room for float rounding in the check itself
+constexpr float min_normal_cos2 = 0.999999f;
+
+[[nodiscard]] constexpr auto max_position_round_trip_error() -> float
+{
+  constexpr int sample_count = 4099; // Not aligned with the quantization grid
+  float max_error = 0;
+  for (int i = 0; i < sample_count; ++i) {
+    const float v = (static_cast<float>(i) / (sample_count - 1) - 0.5f) *
+                    Vertex::position_extent;
+    const float error =
+        vertex_packing::detail::abs(dequantize_position(quantize_position(v)) -
+                                    v);
+    max_error = error > max_error ? error : max_error;
+  }
+  return max_error;
+}
+static_assert(max_position_round_trip_error() <= max_position_error);
+
+[[nodiscard]] constexpr auto normal_round_trip_cos2(float x, float y, float z)
+    -> float
+{
+  const auto [dx, dy, dz] = decode_octahedral(encode_octahedral(x, y, z));
+  const float dot = x * dx + y * dy + z * dz;
+  return dot * dot / (dx * dx + dy * dy + dz * dz);
+}
+
+[[nodiscard]] constexpr auto min_normal_round_trip_cos2() -> float
+{
+  // Axes, face diagonals, cube diagonals, and a few arbitrary directions
+  constexpr float a = 0.70710678f;
+  constexpr float b = 0.57735027f;
+  constexpr float normals[][3] = {
+      {1, 0, 0},  {-1, 0, 0},         {0, 1, 0},           {0, -1, 0},
+      {0, 0, 1},  {0, 0, -1},         {a, a, 0},           {a, 0, -a},
+      {0, -a, a}, {-a, 0, -a},        {b, b, b},           {-b, b, -b},
+      {b, -b, -b}, {-b, -b, b},       {0.48f, 0.6f, -0.64f},
+      {-0.8f, 0.36f, -0.48f},         {0.28f, -0.96f, 0.f}};
+
+  float min_cos2 = 1;
+  for (const auto& n : normals) {
+    const float cos2 = normal_round_trip_cos2(n[0], n[1], n[2]);
+    min_cos2 = cos2 < min_cos2 ? cos2 : min_cos2;
+  }
+  return min_cos2;
+}
+static_assert(min_normal_round_trip_cos2() >= min_normal_cos2);
+
+using Vec3 = std::array<float, 3>;
+
+[[nodiscard]] auto dot(const Vec3& u, const Vec3& v) -> float
+{
+  return u[0] * v[0] + u[1] * v[1] + u[2] * v[2];
+}
+
+[[nodiscard]] auto normalize(const Vec3& v) -> Vec3
+{
+  const float inverse_length = 1.f / std::sqrt(dot(v, v));
+  return {v[0] * inverse_length, v[1] * inverse_length, v[2] * inverse_length};
+}
+
+struct FloatVertex {
+  Vec3 position; // Relative to the center of the chunk
+  Vec3 normal;
+};
+
+[[nodiscard]] auto gradient(const ChunkDensityField& field, int x, int y,
+                            int z) -> Vec3
+{
+  return {field.at(x + 1, y, z) - field.at(x - 1, y, z),
+          field.at(x, y + 1, z) - field.at(x, y - 1, z),
+          field.at(x, y, z + 1) - field.at(x, y, z - 1)};
+}
+
+// The unpacked vertices of the regular cells of mesh_density_field, in the
+// same order, recomputed from the formulas of terrain_meshing.comp.glsl
+[[nodiscard]] auto float_vertices(const ChunkDensityField& field)
+    -> std::vector<FloatVertex>
+{
+  constexpr int dimension = ChunkDensityField::chunk_dimension;
+  std::vector<FloatVertex> vertices;
+  for (int z = 0; z <= dimension; ++z) {
+    for (int y = 0; y <= dimension; ++y) {
+      for (int x = 0; x <= dimension; ++x) {
+        const std::array<int, 3> first = {x, y, z};
+        const float first_value = field.at(x, y, z);
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+          if (first[axis] >= dimension) { continue; }
+          std::array<int, 3> other = first;
+          ++other[axis];
+          const float other_value = field.at(other[0], other[1], other[2]);
+          if ((first_value < 0.f) == (other_value < 0.f)) { continue; }
+
+          float t = -first_value / (other_value - first_value);
+          if (std::abs(first_value) < 0.00001f) {
+            t = 0;
+          } else if (std::abs(other_value) < 0.00001f) {
+            t = 1;
+          } else if (std::abs(first_value - other_value) < 0.00001f) {
+            t = 0;
+          }
+          const Vec3 first_gradient = gradient(field, x, y, z);
+          const Vec3 other_gradient =
+              gradient(field, other[0], other[1], other[2]);
+          FloatVertex vertex{};
+          for (std::size_t i = 0; i < 3; ++i) {
+            const auto from = static_cast<float>(first[i] - dimension / 2);
+            const auto to = static_cast<float>(other[i] - dimension / 2);
+            vertex.position[i] = from * (1.f - t) + to * t;
+            vertex.normal[i] =
+                -(first_gradient[i] * (1.f - t) + other_gradient[i] * t);
+          }
+          vertex.normal = normalize(vertex.normal);
+          vertices.push_back(vertex);
+        }
+      }
+    }
+  }
+  return vertices;
+}
+
+// packUnorm2x16 and packSnorm2x16 of GLSL for one component
+[[nodiscard]] auto glsl_pack_unorm16(float v) -> std::uint16_t
+{
+  return static_cast<std::uint16_t>(
+      std::round(std::clamp(v, 0.f, 1.f) * 65535.f));
+}
+
+[[nodiscard]] auto glsl_pack_snorm16(float v) -> std::int16_t
+{
+  return static_cast<std::int16_t>(
+      std::round(std::clamp(v, -1.f, 1.f) * 32767.f));
+}
+
+// pack_vertex of terrain_vertex.glsl
+[[nodiscard]] auto glsl_pack_vertex(const Vec3& position, const Vec3& normal)
+    -> Vertex
+{
+  Vertex vertex{};
+  for (std::size_t i = 0; i < 3; ++i) {
+    vertex.position[i] =
+        glsl_pack_unorm16(position[i] / Vertex::position_extent + 0.5f);
+  }
+  const float l1_norm =
+      std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+  std::array<float, 2> p = {normal[0] / l1_norm, normal[1] / l1_norm};
+  if (normal[2] < 0.f) {
+    p = {(1.f - std::abs(p[1])) * (p[0] >= 0.f ? 1.f : -1.f),
+         (1.f - std::abs(p[0])) * (p[1] >= 0.f ? 1.f : -1.f)};
+  }
+  vertex.normal[0] = glsl_pack_snorm16(p[0]);
+  vertex.normal[1] = glsl_pack_snorm16(p[1]);
+  return vertex;
+}
+
+// The R16G16B16A16_UNORM and R16G16_SNORM attribute fetches followed by
+// decode_position and decode_octahedral of terrain_vertex.glsl
+[[nodiscard]] auto glsl_decode_vertex(const Vertex& vertex) -> FloatVertex
+{
+  FloatVertex decoded{};
+  for (std::size_t i = 0; i < 3; ++i) {
+    decoded.position[i] = (static_cast<float>(vertex.position[i]) / 65535.f -
+                           0.5f) *
+                          Vertex::position_extent;
+  }
+  std::array<float, 2> e{};
+  for (std::size_t i = 0; i < 2; ++i) {
+    e[i] = std::max(static_cast<float>(vertex.normal[i]) / 32767.f, -1.f);
+  }
+  Vec3 n = {e[0], e[1], 1.f - std::abs(e[0]) - std::abs(e[1])};
+  if (n[2] < 0.f) {
+    n[0] = (1.f - std::abs(e[1])) * (e[0] >= 0.f ? 1.f : -1.f);
+    n[1] = (1.f - std::abs(e[0])) * (e[1] >= 0.f ? 1.f : -1.f);
+  }
+  decoded.normal = normalize(n);
+  return decoded;
+}
+
+struct PackingError {
+  std::size_t vertex_count = 0;
+  std::size_t count_mismatch_count = 0; // Chunks with other vertex counts
+  float max_position_error = 0;         // Packed against float, in cells
+  float min_normal_cos2 = 1;            // Packed against float
+  int max_glsl_pack_delta = 0;          // In quantization steps
+  float max_glsl_decode_delta = 0;      // Decoded by GLSL against by C++
+};
+
+void check_chunk(ChunkKey chunk, PackingError& error)
+{
+  const ChunkDensityField field = generate_density_field(chunk);
+  const ChunkMesh mesh = mesh_density_field(field);
+  const std::vector<FloatVertex> expected = float_vertices(field);
+  if (mesh.vertices.size() != expected.size()) {
+    ++error.count_mismatch_count;
+    return;
+  }
+
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    const Vertex& packed = mesh.vertices[i];
+    const FloatVertex& original = expected[i];
+    ++error.vertex_count;
+
+    const auto normal = decode_octahedral({packed.normal[0], packed.normal[1]});
+    const float cos = dot(normal, original.normal);
+    error.min_normal_cos2 =
+        std::min(error.min_normal_cos2, cos * cos / dot(normal, normal));
+
+    const Vertex glsl_packed =
+        glsl_pack_vertex(original.position, original.normal);
+    const FloatVertex glsl_decoded = glsl_decode_vertex(packed);
+    const Vec3 unit_normal = normalize(normal);
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      const float position = dequantize_position(packed.position[axis]);
+      error.max_position_error =
+          std::max(error.max_position_error,
+                   std::abs(position - original.position[axis]));
+      error.max_glsl_pack_delta =
+          std::max(error.max_glsl_pack_delta,
+                   std::abs(int{glsl_packed.position[axis]} -
+                            int{packed.position[axis]}));
+      error.max_glsl_decode_delta =
+          std::max({error.max_glsl_decode_delta,
+                    std::abs(glsl_decoded.position[axis] - position),
+                    std::abs(glsl_decoded.normal[axis] - unit_normal[axis])});
+    }
+    for (std::size_t j = 0; j < 2; ++j) {
+      error.max_glsl_pack_delta =
+          std::max(error.max_glsl_pack_delta,
+                   std::abs(int{glsl_packed.normal[j]} -
+                            int{packed.normal[j]}));
+    }
+  }
+}
+
+} // anonymous namespace
+
+auto main() -> int
+{
+  // A column of chunks through the surface around the origin
+  PackingError error;
+  for (int x = -1; x <= 1; ++x) {
+    for (int y = -2; y <= 2; ++y) {
+      for (int z = -1; z <= 1; ++z) {
+        check_chunk(ChunkKey{.position = {x, y, z}}, error);
+      }
+    }
+  }
+
+  // Rounding ties may go either way in GLSL
+  constexpr int max_glsl_pack_delta = 1;
+  constexpr float max_glsl_decode_delta = 1e-5f;
+  const bool passed = error.vertex_count > 0 &&
+                      error.count_mismatch_count == 0 &&
+                      error.max_position_error <= max_position_error &&
+                      error.min_normal_cos2 >= min_normal_cos2 &&
+                      error.max_glsl_pack_delta <= max_glsl_pack_delta &&
+                      error.max_glsl_decode_delta <= max_glsl_decode_delta;
+
+  fmt::print("{} vertices, {} chunks with another vertex count\n",
+             error.vertex_count, error.count_mismatch_count);
+  fmt::print("Packed against float: max position error {:.6f} cells (bound "
+             "{:.6f}), min normal cos^2 {:.7f} (bound {:.7f})\n",
+             static_cast<double>(error.max_position_error),
+             static_cast<double>(max_position_error),
+             static_cast<double>(error.min_normal_cos2),
+             static_cast<double>(min_normal_cos2));
+  fmt::print("GLSL against C++: max packing delta {} steps, max decoding "
+             "delta {:.2e}\n",
+             error.max_glsl_pack_delta,
+             static_cast<double>(error.max_glsl_decode_delta));
+  fmt::print("{}\n", passed ? "Passed" : "FAILED");
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -48,6 +48,15 @@ elseif (CMAKE_CXX_COMPILER_ID MATCHES "GNU|Clang")
     endif ()
 endif ()
 
+option(VOXEL_GAME_ENABLE_AVX2 "Use AVX2 in the CPU terrain mesher" OFF)
+if (VOXEL_GAME_ENABLE_AVX2)
+    if (MSVC)
+        target_compile_options(compiler_options INTERFACE /arch:AVX2)
+    else ()
+        target_compile_options(compiler_options INTERFACE -mavx2)
+    endif ()
+endif ()
+
 option(VOXEL_GAME_ENABLE_PCH "Enable Precompiled Headers" ON)
 if (VOXEL_GAME_ENABLE_PCH)
     target_precompile_headers(compiler_options INTERFACE
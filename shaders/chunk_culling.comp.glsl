@@ -0,0 +1,135 @@
+#version 450
+
+// Tests the bounding box of every chunk draw against the view frustum and the
+// depth pyramid of the previous frame, and appends the surviving draws to the
+// visible draw list
+
+layout (local_size_x = 64) in;
+
+// VkDrawIndexedIndirectCommand
+struct DrawCommand {
+  uint index_count;
+  uint instance_count;
+  uint first_index;
+  int vertex_offset;
+  uint first_instance;
+};
+
+// Needs to match ChunkManager::chunk_dimension
+const float half_chunk_dimension = 16.0;
+
+// Needs to match the flags in chunk_culler.cpp
+const uint frustum_culling_bit = 1;
+const uint occlusion_culling_bit = 2;
+
+layout(binding = 0) readonly buffer draw_command_buffer
+{
+  DrawCommand draw_commands[];
+};
+
+// x, y, z for translation, w for scaling
+layout(binding = 1) readonly buffer draw_transform_buffer
+{
+  vec4 transforms[];
+};
+
+layout(binding = 2) writeonly buffer visible_draw_command_buffer
+{
+  DrawCommand visible_draw_commands[];
+};
+
+layout(binding = 3) buffer stats_buffer
+{
+  uint visible_count;
+  uint frustum_culled_count;
+  uint occlusion_culled_count;
+};
+
+layout(binding = 4) uniform culling_uniforms
+{
+  mat4 viewproj;
+  mat4 depth_pyramid_viewproj;
+  vec2 depth_pyramid_size;
+  uint draw_count;
+  uint flags;
+};
+
+layout(binding = 5) uniform sampler2D depth_pyramid;
+
+vec3 box_corner(in vec3 aabb_min, in vec3 aabb_max, in uint i) {
+  return mix(aabb_min, aabb_max, vec3(i & 1u, (i >> 1) & 1u, (i >> 2) & 1u));
+}
+
+// The box is outside if all of its corners are beyond the same clip plane
+bool is_outside_frustum(in vec3 aabb_min, in vec3 aabb_max) {
+  uint outside_all = 0x3Fu;
+  for (uint i = 0; i < 8; ++i) {
+    vec4 clip = viewproj * vec4(box_corner(aabb_min, aabb_max, i), 1.0);
+    uint outside = 0;
+    if (clip.x < -clip.w) { outside |= 1u; }
+    if (clip.x > clip.w) { outside |= 2u; }
+    if (clip.y < -clip.w) { outside |= 4u; }
+    if (clip.y > clip.w) { outside |= 8u; }
+    if (clip.z < 0.0) { outside |= 16u; }
+    if (clip.z > clip.w) { outside |= 32u; }
+    outside_all &= outside;
+  }
+  return outside_all != 0;
+}
+
+bool is_occluded(in vec3 aabb_min, in vec3 aabb_max) {
+  vec2 ndc_min = vec2(1.0);
+  vec2 ndc_max = vec2(-1.0);
+  float nearest_depth = 1.0;
+  for (uint i = 0; i < 8; ++i) {
+    vec4 clip = depth_pyramid_viewproj * vec4(box_corner(aabb_min, aabb_max, i), 1.0);
+    // The box crosses the camera plane
+    if (clip.w <= 0.0) { return false; }
+
+    vec3 ndc = clip.xyz / clip.w;
+    ndc_min = min(ndc_min, ndc.xy);
+    ndc_max = max(ndc_max, ndc.xy);
+    nearest_depth = min(nearest_depth, ndc.z);
+  }
+
+  // The viewport of the terrain pipelines is flipped vertically
+  vec2 uv_min = clamp(vec2(ndc_min.x, -ndc_max.y) * 0.5 + 0.5, 0.0, 1.0);
+  vec2 uv_max = clamp(vec2(ndc_max.x, -ndc_min.y) * 0.5 + 0.5, 0.0, 1.0);
+
+  // At this level the rectangle covers at most 2x2 texels, so sampling its
+  // corners covers all of it
+  vec2 size = (uv_max - uv_min) * depth_pyramid_size;
+  float level = ceil(log2(max(max(size.x, size.y), 1.0)));
+
+  float farthest_depth = max(
+    max(textureLod(depth_pyramid, uv_min, level).r,
+        textureLod(depth_pyramid, vec2(uv_max.x, uv_min.y), level).r),
+    max(textureLod(depth_pyramid, vec2(uv_min.x, uv_max.y), level).r,
+        textureLod(depth_pyramid, uv_max, level).r));
+  return nearest_depth > farthest_depth;
+}
+
+void main(){
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= draw_count) { return; }
+
+  DrawCommand command = draw_commands[index];
+  if (command.instance_count == 0) { return; }
+
+  vec4 transform = transforms[command.first_instance];
+  vec3 half_extent = vec3(half_chunk_dimension * transform.w);
+  vec3 aabb_min = transform.xyz - half_extent;
+  vec3 aabb_max = transform.xyz + half_extent;
+
+  if ((flags & frustum_culling_bit) != 0 && is_outside_frustum(aabb_min, aabb_max)) {
+    atomicAdd(frustum_culled_count, 1);
+    return;
+  }
+  if ((flags & occlusion_culling_bit) != 0 && is_occluded(aabb_min, aabb_max)) {
+    atomicAdd(occlusion_culled_count, 1);
+    return;
+  }
+
+  uint slot = atomicAdd(visible_count, 1);
+  visible_draw_commands[slot] = command;
+}
@@ -0,0 +1,32 @@
+#version 450
+
+// Builds one level of the depth pyramid. Each texel keeps the farthest depth of
+// every source texel it covers, so the pyramid never reports an occluder that
+// is not there, including at odd sizes
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+layout(binding = 0) uniform sampler2D source;
+layout(binding = 1, r32f) uniform writeonly image2D destination;
+
+layout(push_constant) uniform constants
+{
+  uvec2 source_size;
+  uvec2 destination_size;
+};
+
+void main(){
+  uvec2 texel = gl_GlobalInvocationID.xy;
+  if (any(greaterThanEqual(texel, destination_size))) { return; }
+
+  uvec2 begin = texel * source_size / destination_size;
+  uvec2 end = min(((texel + 1) * source_size + destination_size - 1) / destination_size, source_size);
+
+  float depth = 0;
+  for (uint y = begin.y; y < end.y; ++y) {
+    for (uint x = begin.x; x < end.x; ++x) {
+      depth = max(depth, texelFetch(source, ivec2(x, y), 0).r);
+    }
+  }
+  imageStore(destination, ivec2(texel), vec4(depth));
+}
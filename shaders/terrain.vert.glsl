@@ -1,7 +1,10 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "terrain_vertex.glsl"
 
 layout (location = 0) in vec4 vPosition;
-layout (location = 1) in vec4 vNormal;
+layout (location = 1) in vec2 vNormal;
 
 layout(set = 0, binding = 0) uniform CameraBuffer {
     mat4 view;
@@ -9,10 +12,10 @@ layout(set = 0, binding = 0) uniform CameraBuffer {
     mat4 viewproj;
 } cameraData;
 
-layout( push_constant ) uniform constants
-{
-    vec4 transform;
-} PushConstants;
+// Indexed by the first instance of each indirect draw
+layout(std430, set = 0, binding = 1) readonly buffer DrawTransformBuffer {
+    vec4 transforms[];
+} drawTransforms;
 
 layout (location = 0) out VS_OUT {
     vec3 position;
@@ -21,8 +24,10 @@ layout (location = 0) out VS_OUT {
 
 void main()
 {
-    vec3 world_position = PushConstants.transform.xyz + vPosition.xyz;
+    // Vertices are in cells, which are transform.w apart in world space
+    vec4 transform = drawTransforms.transforms[gl_InstanceIndex];
+    vec3 world_position = transform.xyz + transform.w * decode_position(vPosition);
     gl_Position = cameraData.viewproj * vec4(world_position, 1.0f);
     vs_out.position = world_position;
-    vs_out.normal = vNormal.xyz;
+    vs_out.normal = decode_octahedral(vNormal);
 }
\ No newline at end of file
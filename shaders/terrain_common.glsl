@@ -0,0 +1,178 @@
+// Shared by the terrain meshing passes. Requires GL_EXT_scalar_block_layout
+
+const int chunk_dimension = 32;
+const int half_chunk_dimension = chunk_dimension / 2;
+
+// Every cell owns the vertices on its edges 0, 3 and 8 (the x, y and z edges
+// leaving its first corner), so that neighbouring cells share vertices. The
+// cells one past the max faces of the chunk only exist to own the vertices of
+// the boundary edges
+const uint owner_cells_per_axis = uint(chunk_dimension) + 1;
+const uint owner_cells_per_chunk = owner_cells_per_axis * owner_cells_per_axis * owner_cells_per_axis;
+
+// The density field of a chunk holds the corners of all its owner cells, plus
+// one point of halo on each side for the gradients
+const int density_halo = 1;
+const uint density_points_per_axis = owner_cells_per_axis + 1 + 2 * density_halo;
+const uint density_points_per_chunk = density_points_per_axis * density_points_per_axis * density_points_per_axis;
+
+// Both the owner cells and the density points, rounded up to the workgroup
+// size
+const uint dispatch_cells_per_axis = 36;
+
+layout(binding = 2, scalar) readonly buffer edge_table_buffer
+{
+  uint edge_table[256];
+};
+
+layout(binding = 3, scalar) readonly buffer tri_table_buffer
+{
+  int tri_table[][16];
+};
+
+// x, y, z for translation, w for scaling
+layout(binding = 4) readonly buffer chunk_transform_buffer
+{
+  vec4 chunk_transforms[];
+};
+
+// Written by the density pass, read by the others
+layout(binding = 9) buffer density_buffer
+{
+  float densities[];
+};
+
+struct GridCell {
+  vec3 p[8];
+  float val[8];
+};
+
+const ivec3 corner_offsets[8] =
+  ivec3[8](
+    ivec3(0, 0, 0),
+    ivec3(1, 0, 0),
+    ivec3(1, 1, 0),
+    ivec3(0, 1, 0),
+    ivec3(0, 0, 1),
+    ivec3(1, 0, 1),
+    ivec3(1, 1, 1),
+    ivec3(0, 1, 1)
+  );
+
+// Second corner of the owned x, y and z edges. The first one is corner 0
+const uint owned_edge_corners[3] = uint[3](1, 3, 4);
+
+float hash(in float p) { p = fract(p * 0.011); p *= p + 7.5; p *= p + p; return fract(p); }
+
+float perlin(in vec3 x) {
+  const vec3 step = vec3(110, 241, 171);
+
+  vec3 i = floor(x);
+  vec3 f = fract(x);
+
+  float n = dot(i, step);
+
+  vec3 u = f * f * (3.0 - 2.0 * f);
+  return mix(mix(mix( hash(n + dot(step, vec3(0, 0, 0))), hash(n + dot(step, vec3(1, 0, 0))), u.x),
+         mix( hash(n + dot(step, vec3(0, 1, 0))), hash(n + dot(step, vec3(1, 1, 0))), u.x), u.y),
+         mix(mix( hash(n + dot(step, vec3(0, 0, 1))), hash(n + dot(step, vec3(1, 0, 1))), u.x),
+         mix( hash(n + dot(step, vec3(0, 1, 1))), hash(n + dot(step, vec3(1, 1, 1))), u.x), u.y), u.z);
+}
+
+// Fractal Brownian Motion
+struct FBM_Params {
+  int octave_count;
+  float amplitude;
+  float frequency;
+  float lacunarity;
+  float gain;
+};
+
+float fbm3(in vec3 x, in FBM_Params params) {
+  float v = 0.0;
+  for (int i = 0; i < params.octave_count; ++i) {
+    v += params.amplitude * perlin(params.frequency * x);
+    x = x * params.lacunarity;
+    params.amplitude *= params.gain;
+  }
+  return v;
+}
+
+float noise(in vec3 pt) {
+  FBM_Params params;
+  params.octave_count = 6;
+  params.amplitude = 0.5;
+  params.frequency = 0.02;
+  params.lacunarity = 2.0;
+  params.gain = 0.5;
+  return fbm3(pt, params) - 0.5 - pt.y * 0.01;
+}
+
+// Chunks of a batch are stacked along the z axis of the dispatch
+uint batch_chunk_index() {
+  return gl_GlobalInvocationID.z / dispatch_cells_per_axis;
+}
+
+uvec3 chunk_cell_index() {
+  return uvec3(gl_GlobalInvocationID.xy, gl_GlobalInvocationID.z % dispatch_cells_per_axis);
+}
+
+bool is_owner_cell(in uvec3 cell_index) {
+  return all(lessThan(cell_index, uvec3(owner_cells_per_axis)));
+}
+
+// Cells inside the chunk, which are the only ones producing triangles
+bool is_inner_cell(in uvec3 cell_index) {
+  return all(lessThan(cell_index, uvec3(chunk_dimension)));
+}
+
+uint linear_cell_index(in uvec3 cell_index) {
+  return (cell_index.z * owner_cells_per_axis + cell_index.y) * owner_cells_per_axis + cell_index.x;
+}
+
+// `point` is relative to the first corner of the chunk and can go one point
+// past the corners of the owner cells in each direction
+uint linear_density_index(in ivec3 point) {
+  uvec3 p = uvec3(point + density_halo);
+  return (p.z * density_points_per_axis + p.y) * density_points_per_axis + p.x;
+}
+
+float density_at(in uint chunk_index, in ivec3 point) {
+  return densities[chunk_index * density_points_per_chunk + linear_density_index(point)];
+}
+
+GridCell evaluate_cell(in uint chunk_index, in uvec3 cell_index) {
+  ivec3 first_corner = ivec3(cell_index);
+
+  GridCell cell;
+  for (int i = 0; i < 8; ++i) {
+    ivec3 corner = first_corner + corner_offsets[i];
+    cell.p[i] = vec3(corner - half_chunk_dimension);
+    cell.val[i] = density_at(chunk_index, corner);
+  }
+  return cell;
+}
+
+uint cube_index(in GridCell cell, in float isolevel) {
+  uint cubeindex = 0;
+  for (uint i = 0; i < 8; ++i) {
+    if (cell.val[i] < isolevel) {
+      cubeindex |= 1u << i;
+    }
+  }
+  return cubeindex;
+}
+
+// Bit i is set if the owned edge along axis i is intersected by the surface.
+// Edges leaving the chunk are not owned
+uint owned_edge_mask(in uint cubeindex, in uvec3 cell_index) {
+  uint mask = 0;
+  for (uint axis = 0; axis < 3; ++axis) {
+    uint other_corner = owned_edge_corners[axis];
+    bool intersected = ((cubeindex ^ (cubeindex >> other_corner)) & 1u) != 0u;
+    if (intersected && cell_index[axis] < uint(chunk_dimension)) {
+      mask |= 1u << axis;
+    }
+  }
+  return mask;
+}
@@ -0,0 +1,40 @@
+#version 450
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_GOOGLE_include_directive : require
+
+// Second meshing pass: counts the vertices owned by every cell and the indices
+// of its triangles, and records which of its edges hold a vertex
+
+#include "terrain_common.glsl"
+
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+layout(binding = 5) writeonly buffer cell_offset_buffer
+{
+  uvec2 cell_counts[]; // x: vertex count, y: index count
+};
+
+layout(binding = 7) writeonly buffer cell_edge_mask_buffer
+{
+  uint cell_edge_masks[];
+};
+
+void main(){
+  uint chunk_index = batch_chunk_index();
+  uvec3 cell_index = chunk_cell_index();
+  if (!is_owner_cell(cell_index)) { return; }
+
+  uint cubeindex = cube_index(evaluate_cell(chunk_index, cell_index), 0);
+  uint edge_mask = owned_edge_mask(cubeindex, cell_index);
+
+  uint triangle_count = 0;
+  if (is_inner_cell(cell_index)) {
+    while (triangle_count < 5 && tri_table[cubeindex][triangle_count * 3] != -1) {
+      ++triangle_count;
+    }
+  }
+
+  uint cell = chunk_index * owner_cells_per_chunk + linear_cell_index(cell_index);
+  cell_counts[cell] = uvec2(bitCount(edge_mask), triangle_count * 3);
+  cell_edge_masks[cell] = edge_mask;
+}
@@ -0,0 +1,20 @@
+#version 450
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_GOOGLE_include_directive : require
+
+// First meshing pass: evaluates the density once per lattice point of every
+// chunk, so that the other passes only read the field
+
+#include "terrain_common.glsl"
+
+layout (local_size_x = 4, local_size_y = 4, local_size_z = 4) in;
+
+void main(){
+  uint chunk_index = batch_chunk_index();
+  ivec3 point = ivec3(chunk_cell_index()) - density_halo;
+
+  // Lattice points are one cell apart, and cells are w apart in world space
+  vec4 transform = chunk_transforms[chunk_index];
+  densities[chunk_index * density_points_per_chunk + linear_density_index(point)] =
+    noise(transform.w * vec3(point - half_chunk_dimension) + transform.xyz);
+}
@@ -0,0 +1,59 @@
+#version 450
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_GOOGLE_include_directive : require
+
+// Third meshing pass: turns the vertex and index counts of the cells of a
+// chunk into offsets with an exclusive prefix sum. One workgroup per chunk
+
+#include "terrain_common.glsl"
+
+const uint local_size = 256;
+const uint cells_per_invocation = (owner_cells_per_chunk + local_size - 1) / local_size;
+
+layout (local_size_x = local_size) in;
+
+layout(binding = 0) buffer reduced_buffer
+{
+  uvec2 chunk_counts[]; // x: vertex count, y: index count
+};
+
+layout(binding = 5) buffer cell_offset_buffer
+{
+  uvec2 cell_offsets[];
+};
+
+shared uvec2 partial_sums[local_size];
+
+void main(){
+  uint chunk_index = gl_WorkGroupID.x;
+  uint invocation = gl_LocalInvocationID.x;
+  uint first_local_cell = invocation * cells_per_invocation;
+  uint cell_count = min(cells_per_invocation, owner_cells_per_chunk - min(first_local_cell, owner_cells_per_chunk));
+  uint first_cell = chunk_index * owner_cells_per_chunk + first_local_cell;
+
+  uvec2 sum = uvec2(0);
+  for (uint i = 0; i < cell_count; ++i) {
+    sum += cell_offsets[first_cell + i];
+  }
+  partial_sums[invocation] = sum;
+  barrier();
+
+  // Inclusive Hillis-Steele scan over the partial sums
+  for (uint offset = 1; offset < local_size; offset *= 2) {
+    uvec2 addend = invocation >= offset ? partial_sums[invocation - offset] : uvec2(0);
+    barrier();
+    partial_sums[invocation] += addend;
+    barrier();
+  }
+
+  uvec2 offset = partial_sums[invocation] - sum;
+  for (uint i = 0; i < cell_count; ++i) {
+    uvec2 counts = cell_offsets[first_cell + i];
+    cell_offsets[first_cell + i] = offset;
+    offset += counts;
+  }
+
+  if (invocation == local_size - 1) {
+    chunk_counts[chunk_index] = partial_sums[invocation];
+  }
+}
@@ -0,0 +1,40 @@
+// Packed terrain vertex. Needs to match Vertex in vertex.hpp
+//
+// position_xy and position_z hold the chunk-local position as unorm16 over the
+// chunk extent, normal holds an octahedral-encoded normal as two snorm16
+
+const float vertex_position_extent = 32.0;
+
+struct Vertex {
+  uint position_xy;
+  uint position_z; // High half unused
+  uint normal;
+};
+
+vec2 sign_not_zero(in vec2 v) {
+  return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encode_octahedral(in vec3 n) {
+  vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+  return n.z < 0.0 ? (1.0 - abs(p.yx)) * sign_not_zero(p) : p;
+}
+
+vec3 decode_octahedral(in vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0) { n.xy = (1.0 - abs(e.yx)) * sign_not_zero(e); }
+  return normalize(n);
+}
+
+Vertex pack_vertex(in vec3 position, in vec3 normal) {
+  vec3 unorm_position = position / vertex_position_extent + 0.5;
+  return Vertex(packUnorm2x16(unorm_position.xy),
+                packUnorm2x16(vec2(unorm_position.z, 0.0)),
+                packSnorm2x16(encode_octahedral(normal)));
+}
+
+// Decodes the vertex attributes fetched with the R16G16B16A16_UNORM and
+// R16G16_SNORM formats
+vec3 decode_position(in vec4 packed_position) {
+  return (packed_position.xyz - 0.5) * vertex_position_extent;
+}
@@ -1,7 +1,9 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "terrain_vertex.glsl"
 
 layout (location = 0) in vec4 vPosition;
-layout (location = 1) in vec4 vNormal;
 
 layout(set = 0, binding = 0) uniform CameraBuffer {
     mat4 view;
@@ -9,13 +11,14 @@ layout(set = 0, binding = 0) uniform CameraBuffer {
     mat4 viewproj;
 } cameraData;
 
-layout( push_constant ) uniform constants
-{
-    vec4 transform;
-} PushConstants;
+// Indexed by the first instance of each indirect draw
+layout(std430, set = 0, binding = 1) readonly buffer DrawTransformBuffer {
+    vec4 transforms[];
+} drawTransforms;
 
 void main()
 {
-    vec3 world_position = PushConstants.transform.xyz + vPosition.xyz;
+    vec4 transform = drawTransforms.transforms[gl_InstanceIndex];
+    vec3 world_position = transform.xyz + transform.w * decode_position(vPosition);
     gl_Position = cameraData.viewproj * vec4(world_position, 1.0f);
 }
\ No newline at end of file
@@ -9,6 +9,8 @@
 
 #include <beyond/math/transform.hpp>
 
+#include <algorithm>
+
 #include "vulkan_helpers/graphics_pipeline.hpp"
 #include "vulkan_helpers/shader_module.hpp"
 #include "vulkan_helpers/sync.hpp"
@@ -47,6 +49,9 @@ void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action,
       break;
     }
     break;
+  case GLFW_PRESS:
+    if (key == GLFW_KEY_E) { app->apply_brush(); }
+    break;
   default:
     break;
   }
@@ -79,19 +84,25 @@ static constexpr int window_height = 900;
 
 } // anonymous namespace
 
-App::App()
-    : window_manager_{&WindowManager::instance()},
-      window_{Window(window_width, window_height, "Voxel Game")},
+App::App(const AppOptions& options)
+    : headless_{options.headless},
+      headless_frame_count_{options.headless_frame_count},
       window_extent_{VkExtent2D{static_cast<std::uint32_t>(window_width),
                                 static_cast<std::uint32_t>(window_height)}}
 {
-  glfwMakeContextCurrent(window_.glfw_window());
-  glfwSetKeyCallback(window_.glfw_window(), key_callback);
-  glfwSetWindowUserPointer(window_.glfw_window(), this);
-  glfwSetCursorPosCallback(window_.glfw_window(), cursor_position_callback);
-  glfwSetMouseButtonCallback(window_.glfw_window(), mouse_button_callback);
-
-  context_ = vkh::Context(window_);
+  if (headless_) {
+    context_ = vkh::Context::create_headless();
+  } else {
+    window_manager_ = &WindowManager::instance();
+    window_ = Window(window_width, window_height, "Voxel Game");
+    glfwMakeContextCurrent(window_.glfw_window());
+    glfwSetKeyCallback(window_.glfw_window(), key_callback);
+    glfwSetWindowUserPointer(window_.glfw_window(), this);
+    glfwSetCursorPosCallback(window_.glfw_window(), cursor_position_callback);
+    glfwSetMouseButtonCallback(window_.glfw_window(), mouse_button_callback);
+
+    context_ = vkh::Context(window_);
+  }
   deletion_queue_ = vkh::DeletionQueue(context_);
 
   init_swapchain();
@@ -100,9 +111,28 @@ App::App()
   init_framebuffer();
   init_sync_strucures();
   init_imgui();
+  // The global descriptors reference the draw transforms of the chunk manager
+  chunk_manager_ = std::make_unique<ChunkManager>(
+      context_, frames_in_flight, options.view_settings,
+      options.chunk_store_directory);
+  chunk_manager_->set_skipping_uniform_chunks(options.skip_uniform_chunks);
+  VkBuffer draw_command_buffers[frames_in_flight] = {};
+  VkBuffer draw_transform_buffers[frames_in_flight] = {};
+  for (auto i = 0u; i < frames_in_flight; ++i) {
+    draw_command_buffers[i] = chunk_manager_->draw_command_buffer(i);
+    draw_transform_buffers[i] = chunk_manager_->draw_transform_buffer(i);
+  }
+  chunk_culler_ = std::make_unique<ChunkCuller>(
+      context_, ChunkCullerCreateInfo{
+                    .depth_extent = window_extent_,
+                    .depth_image_view = depth_image_view_,
+                    .frames_in_flight = frames_in_flight,
+                    .draw_command_buffers = draw_command_buffers,
+                    .draw_transform_buffers = draw_transform_buffers,
+                    .max_draw_count = ChunkManager::max_draw_count,
+                });
   init_descriptors();
   init_pipeline();
-  chunk_manager_ = std::make_unique<ChunkManager>(context_);
 }
 
 App::~App()
@@ -110,11 +140,14 @@ App::~App()
   if (!context_) { return; }
 
   context_.wait_idle();
+  // Some of the deleters release chunks of the chunk manager
+  for (auto& frame_data : frame_data_) { frame_data.deletion_queue.flush(); }
 
   vkDestroyFence(context_.device(), upload_context_.fence, nullptr);
   vkDestroyCommandPool(context_.device(), upload_context_.command_pool,
                        nullptr);
 
+  chunk_culler_.reset();
   chunk_manager_.reset();
   terrain_wireframe_pipeline_.reset();
   terrain_graphics_pipeline_.reset();
@@ -133,7 +166,7 @@ App::~App()
     vkDestroyCommandPool(context_.device(), frame_data.command_pool, nullptr);
   }
 
-  ImGui_ImplVulkan_Shutdown();
+  if (!headless_) { ImGui_ImplVulkan_Shutdown(); }
 
   vkDestroyDescriptorPool(context_.device(), default_descriptor_pool_, nullptr);
   vkDestroyDescriptorSetLayout(context_.device(), global_descriptor_set_layout_,
@@ -145,6 +178,12 @@ App::~App()
   vkDestroyImageView(context_.device(), depth_image_view_, nullptr);
   vmaDestroyImage(context_.allocator(), depth_image_.image,
                   depth_image_.allocation);
+  if (headless_) {
+    vkDestroyImageView(context_.device(), offscreen_color_image_view_,
+                       nullptr);
+    vmaDestroyImage(context_.allocator(), offscreen_color_image_.image,
+                    offscreen_color_image_.allocation);
+  }
 }
 
 void App::move_camera(FirstPersonCamera::Movement movement)
@@ -152,6 +191,11 @@ void App::move_camera(FirstPersonCamera::Movement movement)
   camera_.process_keyboard(movement, 0.1f);
 }
 
+void App::apply_brush()
+{
+  chunk_manager_->apply_brush_along_ray(camera_.position(), camera_.front());
+}
+
 void App::mouse_dragging(bool is_dragging)
 {
   dragging_ = is_dragging ? MouseDraggingState::Start : MouseDraggingState::No;
@@ -172,8 +216,14 @@ void App::mouse_move(float x, float y)
 
 void App::exec()
 {
+  if (headless_) {
+    exec_headless();
+    return;
+  }
+
   while (!window_.should_close()) {
-    chunk_manager_->update(camera_.position());
+    chunk_manager_->update(camera_.position(), camera_.front(),
+                           get_last_submitted_frame().deletion_queue);
 
     render();
 
@@ -182,11 +232,124 @@ void App::exec()
   }
 }
 
+void App::exec_headless()
+{
+  std::vector<double> frame_times_ms;
+  frame_times_ms.reserve(headless_frame_count_);
+
+  const auto print_streaming_stats = [this]() {
+    const ChunkStreamingStats stats = chunk_manager_->streaming_stats();
+    fmt::print("  chunks: {} in view, {} tracked, {} meshed, {} streamed "
+               "({:.1f} chunks/s)\n",
+               stats.layout_chunk_count, stats.tracked_chunk_count,
+               stats.meshed_chunk_count, stats.streamed_chunk_count,
+               stats.meshing_throughput);
+    fmt::print("  load queue: {} chunks, {} unloaded\n",
+               stats.queued_chunk_count, stats.unloaded_chunk_count);
+    fmt::print("  geometry: {} vertices, {} triangles\n", stats.vertex_count,
+               stats.index_count / 3);
+    const std::uint64_t loaded_count =
+        stats.skipped_chunk_count + stats.streamed_chunk_count;
+    if (loaded_count != 0) {
+      fmt::print("  uniform chunks: {} skipped without meshing ({:.1f}% of "
+                 "the loaded chunks)\n",
+                 stats.skipped_chunk_count,
+                 100.0 * static_cast<double>(stats.skipped_chunk_count) /
+                     static_cast<double>(loaded_count));
+    }
+    if (const ChunkStore* store = chunk_manager_->chunk_store();
+        store != nullptr) {
+      const ChunkStoreStats store_stats = store->stats();
+      fmt::print("  chunk store: {} hits, {} misses, {} saved\n",
+                 store_stats.hit_count, store_stats.miss_count,
+                 store_stats.saved_count);
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  for (std::uint32_t frame = 0; frame < headless_frame_count_; ++frame) {
+    update_scripted_camera();
+    chunk_manager_->update(camera_.position(), camera_.front(),
+                           get_last_submitted_frame().deletion_queue);
+    render();
+
+    // The first frame has no previous frame to measure against
+    if (frame != 0) { frame_times_ms.push_back(frame_time_ms_); }
+    if ((frame + 1) % 100 == 0) {
+      fmt::print("frame {}: {:.2f} ms\n", frame + 1, frame_time_ms_);
+      print_streaming_stats();
+    }
+  }
+  context_.wait_idle();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  fmt::print("{} frames in {:.2f} s\n", headless_frame_count_,
+             elapsed.count());
+  if (!frame_times_ms.empty()) {
+    std::ranges::sort(frame_times_ms);
+    const auto percentile = [&](double p) {
+      const auto index = static_cast<std::size_t>(
+          p * static_cast<double>(frame_times_ms.size() - 1));
+      return frame_times_ms[index];
+    };
+    double total_ms = 0;
+    for (const double time : frame_times_ms) { total_ms += time; }
+    fmt::print("frame time: avg {:.2f} ms, p50 {:.2f} ms, p95 {:.2f} ms, "
+               "p99 {:.2f} ms, max {:.2f} ms\n",
+               total_ms / static_cast<double>(frame_times_ms.size()),
+               percentile(0.5), percentile(0.95), percentile(0.99),
+               frame_times_ms.back());
+  }
+  print_streaming_stats();
+  if (const double startup_load_ms =
+          chunk_manager_->streaming_stats().startup_load_ms;
+      startup_load_ms != 0) {
+    fmt::print("startup: chunks in view loaded in {:.0f} ms{}\n",
+               startup_load_ms,
+               chunk_manager_->is_skipping_uniform_chunks()
+                   ? ""
+                   : ", without skipping uniform chunks");
+  }
+
+  const ChunkViewSettings& view_settings = chunk_manager_->view_settings();
+  fmt::print("view: {} chunks horizontally, {} vertically, {}, {} levels of "
+             "detail, draw distance {:.0f}\n",
+             view_settings.view_distance, view_settings.vertical_view_distance,
+             load_shape_name(view_settings.load_shape), view_settings.lod_count,
+             chunk_manager_->draw_distance());
+  for (const ViewDistanceSample& sample :
+       chunk_manager_->view_distance_samples()) {
+    const double geometry_mib =
+        static_cast<double>(sample.vertex_count * sizeof(Vertex) +
+                            sample.index_count * sizeof(std::uint32_t)) /
+        (1024.0 * 1024.0);
+    fmt::print("  once loaded: {} chunks in view, {} meshed, {:.1f} MiB of "
+               "geometry\n",
+               sample.layout_chunk_count, sample.meshed_chunk_count,
+               geometry_mib);
+  }
+}
+
+void App::update_scripted_camera()
+{
+  // One turn every 3600 frames, a circle of about six chunks radius
+  static constexpr float time_step = 1.f / 60.f;
+  static constexpr float turn_per_frame = 2.f; // In mouse movement units
+  camera_.process_keyboard(FirstPersonCamera::Movement::FORWARD, time_step);
+  camera_.process_mouse_movement(turn_per_frame, 0.f);
+}
+
 void App::init_swapchain()
 {
-  swapchain_ = vkh::Swapchain(context_, {
-                                            .extent = window_extent_,
-                                        });
+  if (headless_) {
+    init_offscreen_color_image();
+  } else {
+    swapchain_ = vkh::Swapchain(context_, {
+                                              .extent = window_extent_,
+                                          });
+    color_image_format_ = swapchain_.image_format();
+  }
 
   depth_image_format_ = VK_FORMAT_D32_SFLOAT;
 
@@ -202,7 +365,9 @@ void App::init_swapchain()
       .arrayLayers = 1,
       .samples = VK_SAMPLE_COUNT_1_BIT,
       .tiling = VK_IMAGE_TILING_OPTIMAL,
-      .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+      // Sampled to build the depth pyramid used for occlusion culling
+      .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+               VK_IMAGE_USAGE_SAMPLED_BIT,
   };
   constexpr VmaAllocationCreateInfo depth_image_allocation_create_info = {
       .usage = VMA_MEMORY_USAGE_GPU_ONLY,
@@ -231,6 +396,51 @@ void App::init_swapchain()
                              nullptr, &depth_image_view_));
 }
 
+void App::init_offscreen_color_image()
+{
+  color_image_format_ = VK_FORMAT_R8G8B8A8_UNORM;
+
+  const VkImageCreateInfo color_image_create_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .pNext = nullptr,
+      .imageType = VK_IMAGE_TYPE_2D,
+      .format = color_image_format_,
+      .extent = {window_extent_.width, window_extent_.height, 1},
+      .mipLevels = 1,
+      .arrayLayers = 1,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      // Transfer source so that frames can be read back
+      .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+               VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+  };
+  constexpr VmaAllocationCreateInfo color_image_allocation_create_info = {
+      .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+      .requiredFlags =
+          VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+  };
+  VK_CHECK(vmaCreateImage(context_.allocator(), &color_image_create_info,
+                          &color_image_allocation_create_info,
+                          &offscreen_color_image_.image,
+                          &offscreen_color_image_.allocation, nullptr));
+
+  const VkImageViewCreateInfo color_view_create_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .pNext = nullptr,
+      .image = offscreen_color_image_.image,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D,
+      .format = color_image_format_,
+      .subresourceRange = {
+          .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+          .baseMipLevel = 0,
+          .levelCount = 1,
+          .baseArrayLayer = 0,
+          .layerCount = 1,
+      }};
+  VK_CHECK(vkCreateImageView(context_.device(), &color_view_create_info,
+                             nullptr, &offscreen_color_image_view_));
+}
+
 void App::init_command()
 {
   const VkCommandPoolCreateInfo command_pool_create_info = {
@@ -272,14 +482,15 @@ void App::init_render_pass()
   // the renderpass will use this color attachment.
   const VkAttachmentDescription color_attachment = {
       .flags = 0,
-      .format = swapchain_.image_format(),
+      .format = color_image_format_,
       .samples = VK_SAMPLE_COUNT_1_BIT,
       .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
       .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
       .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
       .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
       .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-      .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+      .finalLayout = headless_ ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                               : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
   };
 
   static constexpr VkAttachmentReference color_attachment_ref = {
@@ -349,14 +560,21 @@ void App::init_framebuffer()
       .layers = 1,
   };
 
-  // grab how many images we have in the swapchain
-  const auto swapchain_imagecount =
-      static_cast<std::uint32_t>(swapchain_.images().size());
-  framebuffers_ = std::vector<VkFramebuffer>(swapchain_imagecount);
+  // One framebuffer per swapchain image, or a single one for the offscreen
+  // color image
+  std::vector<VkImageView> color_image_views;
+  if (headless_) {
+    color_image_views.push_back(offscreen_color_image_view_);
+  } else {
+    color_image_views.assign(swapchain_.image_views().begin(),
+                             swapchain_.image_views().end());
+  }
+  const auto color_image_count =
+      static_cast<std::uint32_t>(color_image_views.size());
+  framebuffers_ = std::vector<VkFramebuffer>(color_image_count);
 
-  // create framebuffers for each of the swapchain image views
-  for (std::uint32_t i = 0; i < swapchain_imagecount; ++i) {
-    const VkImageView attachments[] = {swapchain_.image_views()[i],
+  for (std::uint32_t i = 0; i < color_image_count; ++i) {
+    const VkImageView attachments[] = {color_image_views[i],
                                        depth_image_view_};
     framebuffer_create_info.pAttachments = beyond::to_pointer(attachments);
     framebuffer_create_info.attachmentCount = beyond::size(attachments);
@@ -371,6 +589,7 @@ void App::init_sync_strucures()
       vkh::create_fence(context_, {.debug_name = "Upload Fence"}).value();
   for (auto i = 0u; i < frames_in_flight; ++i) {
     auto& frame_data = frame_data_[i];
+    frame_data.deletion_queue = vkh::DeletionQueue(context_);
     frame_data.render_semaphore =
         vkh::create_semaphore(
             context_,
@@ -390,6 +609,9 @@ void App::init_sync_strucures()
 
 void App::init_imgui()
 {
+  // There is no window to get input from nor to show the GUI in
+  if (headless_) { return; }
+
   VkDescriptorPoolSize pool_sizes[] = {
       {VK_DESCRIPTOR_TYPE_SAMPLER, 100},
       {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100},
@@ -442,23 +664,31 @@ void App::init_imgui()
 
 void App::init_descriptors()
 {
-  static constexpr VkDescriptorSetLayoutBinding camera_buffer_binding = {
-      .binding = 0,
-      .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-      .descriptorCount = 1,
-      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-  };
+  static constexpr VkDescriptorSetLayoutBinding global_bindings[] = {
+      {
+          .binding = 0,
+          .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+          .descriptorCount = 1,
+          .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+      },
+      {
+          .binding = 1,
+          .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+          .descriptorCount = 1,
+          .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+      }};
 
   static constexpr VkDescriptorSetLayoutCreateInfo set_layout_create_info = {
       .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
       .pNext = nullptr,
       .flags = 0,
-      .bindingCount = 1,
-      .pBindings = &camera_buffer_binding,
+      .bindingCount = beyond::size(global_bindings),
+      .pBindings = beyond::to_pointer(global_bindings),
   };
 
   static constexpr VkDescriptorPoolSize pool_sizes[] = {
-      {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 10}};
+      {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, .descriptorCount = 10},
+      {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, .descriptorCount = 10}};
 
   default_descriptor_pool_ =
       vkh::create_descriptor_pool(context_,
@@ -500,34 +730,43 @@ void App::init_descriptors()
         .range = sizeof(GPUCameraData),
     };
 
-    const VkWriteDescriptorSet write_set = {
-        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .pNext = nullptr,
-        .dstSet = frame_data.global_descriptor,
-        .dstBinding = 0,
-        .descriptorCount = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-        .pBufferInfo = &buffer_info,
+    const VkDescriptorBufferInfo draw_transform_buffer_info = {
+        .buffer = chunk_manager_->draw_transform_buffer(i),
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
     };
 
-    vkUpdateDescriptorSets(context_.device(), 1, &write_set, 0, nullptr);
+    const VkWriteDescriptorSet write_sets[] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = frame_data.global_descriptor,
+            .dstBinding = 0,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .pBufferInfo = &buffer_info,
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .pNext = nullptr,
+            .dstSet = frame_data.global_descriptor,
+            .dstBinding = 1,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .pBufferInfo = &draw_transform_buffer_info,
+        }};
+
+    vkUpdateDescriptorSets(context_.device(), beyond::size(write_sets),
+                           beyond::to_pointer(write_sets), 0, nullptr);
   }
 }
 
 void App::init_pipeline()
 {
-  static constexpr VkPushConstantRange push_constant_range{
-      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
-      .offset = 0,
-      .size = sizeof(beyond::Vec4),
-  };
-
   const VkPipelineLayoutCreateInfo pipeline_layout_info{
       .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
       .setLayoutCount = 1,
       .pSetLayouts = &global_descriptor_set_layout_,
-      .pushConstantRangeCount = 1,
-      .pPushConstantRanges = &push_constant_range,
   };
 
   VK_CHECK(vkCreatePipelineLayout(context_.device(), &pipeline_layout_info,
@@ -625,9 +864,20 @@ void App::render_gui()
       ImGui::SameLine();
       ImGui::RadioButton("Wireframe", &render_mode_int, 1);
       render_mode_ = static_cast<RenderMode>(render_mode_int);
+
+      ImGui::Text("Frame time: %.2f ms (%.0f FPS)", frame_time_ms_,
+                  frame_time_ms_ > 0 ? 1000.0 / frame_time_ms_ : 0.0);
+      ImGui::Text("Command recording: %.3f ms", record_time_ms_);
+
+      ImGui::Separator();
+      chunk_culler_->draw_gui();
       ImGui::EndTabItem();
     }
     if (ImGui::BeginTabItem("Terrain Generation")) {
+      // Measures how fast terrain appears in an area with nothing loaded
+      if (ImGui::Button("Teleport 1000 units forward")) {
+        camera_.set_position(camera_.position() + camera_.front() * 1000.f);
+      }
       chunk_manager_->draw_gui();
       ImGui::EndTabItem();
     }
@@ -641,14 +891,21 @@ void App::render_gui()
 
 void App::render()
 {
-  render_gui();
-  auto current_frame_data = get_current_frame();
+  const auto frame_start = std::chrono::steady_clock::now();
+  frame_time_ms_ = std::chrono::duration<double, std::milli>(
+                       frame_start - last_frame_start_)
+                       .count();
+  last_frame_start_ = frame_start;
+
+  if (!headless_) { render_gui(); }
+  auto& current_frame_data = get_current_frame();
 
   const float aspect_ratio = static_cast<float>(window_extent_.width) /
                              static_cast<float>(window_extent_.height);
   const beyond::Mat4 view = camera_.get_view_matrix();
   beyond::Mat4 projection =
-      beyond::perspective(beyond::Degree(60.f), aspect_ratio, 0.1f, 2000.0f);
+      beyond::perspective(beyond::Degree(60.f), aspect_ratio, 0.1f,
+                          chunk_manager_->draw_distance());
   projection[1][1] *= -1;
 
   // fill a GPU camera data struct
@@ -668,11 +925,15 @@ void App::render()
                            &current_frame_data.render_fence, true, time_out));
   VK_CHECK(
       vkResetFences(context_.device(), 1, &current_frame_data.render_fence));
+  current_frame_data.deletion_queue.flush();
 
+  // Headless frames always render to the single offscreen framebuffer
   uint32_t swapchain_image_index = 0;
-  VK_CHECK(vkAcquireNextImageKHR(context_.device(), swapchain_, time_out,
-                                 current_frame_data.present_semaphore, nullptr,
-                                 &swapchain_image_index));
+  if (!headless_) {
+    VK_CHECK(vkAcquireNextImageKHR(context_.device(), swapchain_, time_out,
+                                   current_frame_data.present_semaphore,
+                                   nullptr, &swapchain_image_index));
+  }
   VK_CHECK(vkResetCommandBuffer(current_frame_data.main_command_buffer, 0));
 
   VkCommandBuffer cmd = current_frame_data.main_command_buffer;
@@ -682,8 +943,13 @@ void App::render()
       .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
       .pInheritanceInfo = nullptr,
   };
+  const auto record_start = std::chrono::steady_clock::now();
   VK_CHECK(vkBeginCommandBuffer(cmd, &cmd_begin_info));
 
+  const std::uint32_t frame_index = frame_number_ % frames_in_flight;
+  chunk_culler_->cull(cmd, frame_index, camera_data.viewproj,
+                      chunk_manager_->write_draws(frame_index));
+
   static constexpr VkClearValue clear_value = {
       .color = {{0.0f, 0.0f, 0.0f, 1.0f}}};
   static constexpr VkClearValue depth_clear_value = {
@@ -719,37 +985,48 @@ void App::render()
   vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
                           terrain_graphics_pipeline_layout_, 0, 1,
                           &current_frame_data.global_descriptor, 0, nullptr);
-  for (const ChunkVertexCache& cache : chunk_manager_->vertex_caches()) {
-    if (cache.vertex_count == 0) continue;
-    vkCmdPushConstants(cmd, terrain_graphics_pipeline_layout_,
-                       VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(beyond::Vec4),
-                       &cache.transform);
-    vkCmdBindVertexBuffers(cmd, 0, 1, &cache.vertex_buffer.buffer, &offset);
-    vkCmdDraw(cmd, cache.vertex_count, 1, 0, 0);
+  const VkBuffer terrain_vertex_buffer = chunk_manager_->vertex_buffer();
+  vkCmdBindVertexBuffers(cmd, 0, 1, &terrain_vertex_buffer, &offset);
+  vkCmdBindIndexBuffer(cmd, chunk_manager_->index_buffer(), 0,
+                       VK_INDEX_TYPE_UINT32);
+  chunk_culler_->draw(cmd, frame_index);
+
+  if (!headless_) {
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
   }
 
-  ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
-
   vkCmdEndRenderPass(cmd);
+  chunk_culler_->build_depth_pyramid(cmd, depth_image_.image,
+                                     camera_data.viewproj);
   vkEndCommandBuffer(cmd);
+  record_time_ms_ = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - record_start)
+                        .count();
 
   static constexpr VkPipelineStageFlags wait_stage =
       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
+  // Nothing to acquire or present in headless mode
+  const std::uint32_t semaphore_count = headless_ ? 0 : 1;
   const VkSubmitInfo submit_info{
       .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
       .pNext = nullptr,
-      .waitSemaphoreCount = 1,
+      .waitSemaphoreCount = semaphore_count,
       .pWaitSemaphores = &current_frame_data.present_semaphore,
       .pWaitDstStageMask = &wait_stage,
       .commandBufferCount = 1,
       .pCommandBuffers = &current_frame_data.main_command_buffer,
-      .signalSemaphoreCount = 1,
+      .signalSemaphoreCount = semaphore_count,
       .pSignalSemaphores = &current_frame_data.render_semaphore,
   };
   VK_CHECK(vkQueueSubmit(context_.graphics_queue(), 1, &submit_info,
                          current_frame_data.render_fence));
 
+  if (headless_) {
+    ++frame_number_;
+    return;
+  }
+
   VkSwapchainKHR swapchain = swapchain_.get();
   const VkPresentInfoKHR present_info = {
       .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
@@ -771,6 +1048,14 @@ auto App::get_current_frame() -> FrameData&
   return frame_data_[frame_number_ % frames_in_flight];
 }
 
+// Its fence is the next one waited, and frames recorded from now on do not use
+// what is released now
+auto App::get_last_submitted_frame() -> FrameData&
+{
+  return frame_data_[(frame_number_ + frames_in_flight - 1) %
+                     frames_in_flight];
+}
+
 void App::immediate_submit(
     beyond::function_ref<void(VkCommandBuffer cmd)> function)
 {
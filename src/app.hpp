@@ -6,7 +6,9 @@
 #include <vulkan/vulkan.h>
 
 #include <array>
+#include <chrono>
 #include <cstdint>
+#include <filesystem>
 #include <vector>
 
 #include <beyond/math/matrix.hpp>
@@ -24,6 +26,7 @@
 #include "vulkan_helpers/swapchain.hpp"
 
 #include "first_person_camera.hpp"
+#include "terrain/chunk_culler.hpp"
 #include "terrain/chunk_manager.hpp"
 #include "vertex.hpp"
 
@@ -43,6 +46,9 @@ struct FrameData {
 
   vkh::Buffer camera_buffer{};
   VkDescriptorSet global_descriptor{};
+
+  // Flushed right after waiting for render_fence
+  vkh::DeletionQueue deletion_queue;
 };
 constexpr std::uint32_t frames_in_flight = 2;
 
@@ -60,7 +66,23 @@ struct UploadContext {
   VkCommandPool command_pool = {};
 };
 
+struct AppOptions {
+  // Renders offscreen without a window and follows a scripted camera path,
+  // then prints frame and chunk streaming statistics
+  bool headless = false;
+  std::uint32_t headless_frame_count = 1000;
+  ChunkViewSettings view_settings;
+  // Where chunk meshes are kept between runs, none if empty
+  std::filesystem::path chunk_store_directory;
+  // Loads the chunks that are all air or all solid without meshing them
+  bool skip_uniform_chunks = true;
+};
+
 class App {
+  bool headless_ = false;
+  std::uint32_t headless_frame_count_ = 0;
+
+  // Null in headless mode
   WindowManager* window_manager_ = nullptr;
   Window window_;
 
@@ -70,6 +92,11 @@ class App {
   vkh::DeletionQueue deletion_queue_;
   vkh::Swapchain swapchain_;
 
+  // Replaces the swapchain images in headless mode
+  VkFormat color_image_format_{};
+  AllocatedImage offscreen_color_image_{};
+  VkImageView offscreen_color_image_view_{};
+
   VkImageView depth_image_view_{};
   AllocatedImage depth_image_{};
   VkFormat depth_image_format_{};
@@ -88,6 +115,7 @@ class App {
   vkh::Pipeline terrain_wireframe_pipeline_{};
 
   std::unique_ptr<ChunkManager> chunk_manager_{};
+  std::unique_ptr<ChunkCuller> chunk_culler_{};
 
   FirstPersonCamera camera_{beyond::Vec3(0.0f, -50.0f, 0.0f)};
   MouseDraggingState dragging_ = MouseDraggingState::No;
@@ -95,10 +123,14 @@ class App {
   float last_mouse_y_{};
   RenderMode render_mode_ = RenderMode::Fill;
 
+  std::chrono::steady_clock::time_point last_frame_start_{};
+  double frame_time_ms_ = 0;
+  double record_time_ms_ = 0; // CPU time spent recording the frame commands
+
   UploadContext upload_context_;
 
 public:
-  App();
+  explicit App(const AppOptions& options = {});
   ~App();
 
   void exec();
@@ -109,6 +141,8 @@ public:
   auto operator=(App&&) noexcept -> App& = delete;
 
   void move_camera(FirstPersonCamera::Movement movement);
+  // Edits the terrain where the camera looks, with the brush of the GUI
+  void apply_brush();
   void mouse_dragging(bool is_dragging);
   [[nodiscard]] auto dragging_status() const
   {
@@ -118,6 +152,7 @@ public:
 
 private:
   void init_swapchain();
+  void init_offscreen_color_image();
   void init_command();
   void init_render_pass();
   void init_framebuffer();
@@ -127,9 +162,15 @@ private:
   void init_pipeline();
 
   [[nodiscard]] auto get_current_frame() -> FrameData&;
+  // Resources that the GPU may still use can be pushed to its deletion queue
+  [[nodiscard]] auto get_last_submitted_frame() -> FrameData&;
 
   void render();
   void render_gui();
+
+  void exec_headless();
+  // Flies forward while slowly turning, at a fixed time step
+  void update_scripted_camera();
   void generate_mesh();
 
   void
@@ -0,0 +1,54 @@
+#ifndef VOXEL_GAME_CONCURRENCY_CANCELLATION_TOKEN_HPP
+#define VOXEL_GAME_CONCURRENCY_CANCELLATION_TOKEN_HPP
+
+#include <atomic>
+#include <memory>
+
+class CancellationToken;
+
+// Owned by whoever may cancel a group of tasks. Cancelling is sticky: create a
+// new source to schedule more tasks
+class CancellationSource {
+  std::shared_ptr<std::atomic<bool>> cancelled_ =
+      std::make_shared<std::atomic<bool>>(false);
+
+public:
+  void cancel()
+  {
+    cancelled_->store(true, std::memory_order_release);
+  }
+
+  [[nodiscard]] auto is_cancelled() const -> bool
+  {
+    return cancelled_->load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] auto token() const -> CancellationToken;
+};
+
+// Cheap to copy. A default constructed token is never cancelled
+class CancellationToken {
+  std::shared_ptr<const std::atomic<bool>> cancelled_;
+
+  friend class CancellationSource;
+  explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> cancelled)
+      : cancelled_{std::move(cancelled)}
+  {
+  }
+
+public:
+  CancellationToken() = default;
+
+  [[nodiscard]] auto is_cancelled() const -> bool
+  {
+    return cancelled_ != nullptr &&
+           cancelled_->load(std::memory_order_acquire);
+  }
+};
+
+inline auto CancellationSource::token() const -> CancellationToken
+{
+  return CancellationToken{cancelled_};
+}
+
+#endif // VOXEL_GAME_CONCURRENCY_CANCELLATION_TOKEN_HPP
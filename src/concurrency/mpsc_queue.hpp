@@ -0,0 +1,61 @@
+#ifndef VOXEL_GAME_CONCURRENCY_MPSC_QUEUE_HPP
+#define VOXEL_GAME_CONCURRENCY_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <optional>
+#include <utility>
+
+// Unbounded lock-free multiple-producer single-consumer queue (Vyukov's
+// node-based queue). `push` can be called from any thread, `try_pop` only from
+// the consumer thread
+template <typename T> class MpscQueue {
+  struct Node {
+    std::atomic<Node*> next = nullptr;
+    std::optional<T> value; // Empty for the stub
+  };
+
+  // Producers swap themselves in at the head, the consumer follows the next
+  // pointers from the tail. The tail is always a node whose value is consumed
+  alignas(64) std::atomic<Node*> head_;
+  alignas(64) Node* tail_;
+
+public:
+  MpscQueue() : head_{new Node}, tail_{head_.load(std::memory_order_relaxed)}
+  {
+  }
+
+  ~MpscQueue()
+  {
+    while (try_pop()) {}
+    delete tail_;
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  auto operator=(const MpscQueue&) & -> MpscQueue& = delete;
+  MpscQueue(MpscQueue&&) noexcept = delete;
+  auto operator=(MpscQueue&&) & noexcept -> MpscQueue& = delete;
+
+  void push(T value)
+  {
+    Node* node = new Node;
+    node->value.emplace(std::move(value));
+    Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+    // Until this store, the consumer cannot see `node` or anything pushed after
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  // May miss an element whose push has not completed yet
+  [[nodiscard]] auto try_pop() -> std::optional<T>
+  {
+    Node* next = tail_->next.load(std::memory_order_acquire);
+    if (next == nullptr) { return std::nullopt; }
+
+    std::optional<T> value = std::move(next->value);
+    next->value.reset();
+    delete tail_;
+    tail_ = next;
+    return value;
+  }
+};
+
+#endif // VOXEL_GAME_CONCURRENCY_MPSC_QUEUE_HPP
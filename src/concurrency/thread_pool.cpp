@@ -0,0 +1,126 @@
+#include "thread_pool.hpp"
+
+#include <beyond/utils/assert.hpp>
+
+namespace {
+
+// Lets submit() find the deque of the worker it is called from
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local std::size_t current_worker_index = 0;
+
+} // anonymous namespace
+
+auto ThreadPool::default_thread_count() -> std::size_t
+{
+  const unsigned int hardware_threads = std::thread::hardware_concurrency();
+  return hardware_threads > 1 ? hardware_threads - 1 : 1;
+}
+
+ThreadPool::ThreadPool(std::size_t thread_count)
+    : worker_count_{thread_count},
+      workers_{std::make_unique<Worker[]>(thread_count)}
+{
+  BEYOND_ENSURE(thread_count > 0);
+  threads_.reserve(thread_count);
+  for (std::size_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back([this, i] { run_worker(i); });
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::scoped_lock lock{sleep_mutex_};
+    stopping_ = true;
+  }
+  wake_condition_.notify_all();
+  for (std::thread& thread : threads_) { thread.join(); }
+}
+
+void ThreadPool::submit(std::function<void()> task, TaskPriority priority,
+                        CancellationToken cancellation_token)
+{
+  const std::size_t worker_index =
+      current_pool == this
+          ? current_worker_index
+          : next_worker_.fetch_add(1, std::memory_order_relaxed) %
+                worker_count_;
+
+  unfinished_task_count_.fetch_add(1, std::memory_order_relaxed);
+  {
+    Worker& worker = workers_[worker_index];
+    std::scoped_lock lock{worker.mutex};
+    worker.deques[static_cast<std::size_t>(priority)].push_back(
+        {.function = std::move(task),
+         .cancellation_token = std::move(cancellation_token)});
+  }
+  {
+    std::scoped_lock lock{sleep_mutex_};
+    queued_task_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  wake_condition_.notify_one();
+}
+
+void ThreadPool::wait_idle()
+{
+  std::unique_lock lock{sleep_mutex_};
+  idle_condition_.wait(lock, [this] {
+    return unfinished_task_count_.load(std::memory_order_acquire) == 0;
+  });
+}
+
+auto ThreadPool::take_task(std::size_t worker_index) -> std::optional<Task>
+{
+  for (std::size_t priority = 0; priority < task_priority_count; ++priority) {
+    for (std::size_t offset = 0; offset < worker_count_; ++offset) {
+      const bool is_own = offset == 0;
+      Worker& worker = workers_[(worker_index + offset) % worker_count_];
+
+      std::scoped_lock lock{worker.mutex};
+      std::deque<Task>& deque = worker.deques[priority];
+      if (deque.empty()) { continue; }
+
+      // The owner runs its oldest task, thieves take the newest one, which the
+      // owner would have run last
+      Task task = std::move(is_own ? deque.front() : deque.back());
+      if (is_own) {
+        deque.pop_front();
+      } else {
+        deque.pop_back();
+      }
+      queued_task_count_.fetch_sub(1, std::memory_order_relaxed);
+      return task;
+    }
+  }
+  return std::nullopt;
+}
+
+void ThreadPool::finish_task()
+{
+  if (unfinished_task_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    // Taking the lock orders this notification after the check in wait_idle
+    std::scoped_lock lock{sleep_mutex_};
+    idle_condition_.notify_all();
+  }
+}
+
+void ThreadPool::run_worker(std::size_t worker_index)
+{
+  current_pool = this;
+  current_worker_index = worker_index;
+
+  while (true) {
+    if (std::optional<Task> task = take_task(worker_index)) {
+      if (!task->cancellation_token.is_cancelled()) { task->function(); }
+      finish_task();
+      continue;
+    }
+
+    std::unique_lock lock{sleep_mutex_};
+    wake_condition_.wait(lock, [this] {
+      return stopping_ ||
+             queued_task_count_.load(std::memory_order_relaxed) > 0;
+    });
+    if (stopping_) { return; }
+  }
+}
@@ -0,0 +1,91 @@
+#ifndef VOXEL_GAME_CONCURRENCY_THREAD_POOL_HPP
+#define VOXEL_GAME_CONCURRENCY_THREAD_POOL_HPP
+
+#include "cancellation_token.hpp"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+enum class TaskPriority : std::uint8_t {
+  high,
+  normal,
+  low,
+};
+inline constexpr std::size_t task_priority_count = 3;
+
+// Work-stealing thread pool. Each worker owns one deque per priority. Workers
+// run the tasks of their own deques in submission order and, when those are
+// empty, steal the most recently submitted task of another worker. Higher
+// priorities are drained from every deque before lower ones
+class ThreadPool {
+  struct Task {
+    std::function<void()> function;
+    CancellationToken cancellation_token;
+  };
+
+  // Padded so that workers do not share cache lines
+  struct alignas(64) Worker {
+    std::mutex mutex;
+    std::array<std::deque<Task>, task_priority_count> deques;
+  };
+
+  std::size_t worker_count_ = 0;
+  std::unique_ptr<Worker[]> workers_;
+  std::vector<std::thread> threads_;
+
+  std::atomic<std::size_t> next_worker_ = 0; // Round-robin for outside submits
+
+  // Tasks in the deques. Changed under sleep_mutex_ when increasing so that a
+  // worker going to sleep cannot miss a submission. Can briefly go negative
+  // when a task is taken before its submission bumped the count
+  std::atomic<std::ptrdiff_t> queued_task_count_ = 0;
+  // Tasks submitted and not finished or skipped yet
+  std::atomic<std::size_t> unfinished_task_count_ = 0;
+  bool stopping_ = false; // Guarded by sleep_mutex_
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_condition_;
+  std::condition_variable idle_condition_;
+
+public:
+  // One thread per hardware thread but the calling one
+  [[nodiscard]] static auto default_thread_count() -> std::size_t;
+
+  explicit ThreadPool(std::size_t thread_count = default_thread_count());
+  // Tasks that have not started are discarded
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  auto operator=(const ThreadPool&) & -> ThreadPool& = delete;
+  ThreadPool(ThreadPool&&) noexcept = delete;
+  auto operator=(ThreadPool&&) & noexcept -> ThreadPool& = delete;
+
+  // Tasks whose token is cancelled before they start are skipped. Tasks
+  // submitted from a worker go to the deque of that worker
+  void submit(std::function<void()> task,
+              TaskPriority priority = TaskPriority::normal,
+              CancellationToken cancellation_token = {});
+
+  // Blocks until every submitted task has finished or been skipped
+  void wait_idle();
+
+  [[nodiscard]] auto thread_count() const -> std::size_t
+  {
+    return worker_count_;
+  }
+
+private:
+  void run_worker(std::size_t worker_index);
+  [[nodiscard]] auto take_task(std::size_t worker_index) -> std::optional<Task>;
+  void finish_task();
+};
+
+#endif // VOXEL_GAME_CONCURRENCY_THREAD_POOL_HPP
@@ -63,6 +63,17 @@ public:
     return position_;
   }
 
+  void set_position(beyond::Point3 position) noexcept
+  {
+    position_ = position;
+  }
+
+  // Normalized view direction
+  [[nodiscard]] auto front() const noexcept -> beyond::Vec3
+  {
+    return front_;
+  }
+
   // returns the view matrix calculated using Euler Angles and the LookAt Matrix
   [[nodiscard]] auto get_view_matrix() const -> beyond::Mat4
   {
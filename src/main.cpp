@@ -1,9 +1,98 @@
+#include <charconv>
 #include <iostream>
+#include <string_view>
+
+#include <fmt/format.h>
 
 #include "app.hpp"
 
-auto main() -> int
+namespace {
+
+void print_usage()
 {
-  App app;
+  fmt::print(stderr,
+             "Usage: app [options]\n"
+             "  --headless                         Render offscreen without a "
+             "window, following a\n"
+             "                                     scripted camera path\n"
+             "  --frames <count>                   Frames to render in "
+             "headless mode\n"
+             "  --view-distance <chunks>           Horizontal radius per level "
+             "(default 4)\n"
+             "  --vertical-view-distance <chunks>  Vertical radius per level "
+             "(default 4)\n"
+             "  --load-shape <shape>               cube, sphere or cylinder "
+             "(default cube)\n"
+             "  --lod-count <count>                Levels of detail, each "
+             "twice as coarse\n"
+             "                                     as the previous one "
+             "(default 4)\n"
+             "  --chunk-store <directory>          Keep chunk meshes in region "
+             "files there,\n"
+             "                                     and load them from there "
+             "later on\n"
+             "  --no-chunk-skipping                Mesh the chunks that are "
+             "all air or all\n"
+             "                                     solid too, to measure the "
+             "time it saves\n");
+}
+
+// Returns false if the whole argument is not a number
+template <typename T>
+[[nodiscard]] auto parse_number(std::string_view arg, T& value) -> bool
+{
+  const auto [end, error] =
+      std::from_chars(arg.data(), arg.data() + arg.size(), value);
+  return error == std::errc{} && end == arg.data() + arg.size();
+}
+
+[[nodiscard]] auto parse_load_shape(std::string_view arg, LoadShape& shape)
+    -> bool
+{
+  for (const LoadShape candidate :
+       {LoadShape::cube, LoadShape::sphere, LoadShape::cylinder}) {
+    if (arg == load_shape_name(candidate)) {
+      shape = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // anonymous namespace
+
+auto main(int argc, char** argv) -> int
+{
+  AppOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    bool valid = true;
+    if (arg == "--headless") {
+      options.headless = true;
+    } else if (arg == "--frames" && i + 1 < argc) {
+      valid = parse_number(argv[++i], options.headless_frame_count);
+    } else if (arg == "--view-distance" && i + 1 < argc) {
+      valid = parse_number(argv[++i], options.view_settings.view_distance);
+    } else if (arg == "--vertical-view-distance" && i + 1 < argc) {
+      valid = parse_number(argv[++i],
+                           options.view_settings.vertical_view_distance);
+    } else if (arg == "--load-shape" && i + 1 < argc) {
+      valid = parse_load_shape(argv[++i], options.view_settings.load_shape);
+    } else if (arg == "--lod-count" && i + 1 < argc) {
+      valid = parse_number(argv[++i], options.view_settings.lod_count);
+    } else if (arg == "--chunk-store" && i + 1 < argc) {
+      options.chunk_store_directory = argv[++i];
+    } else if (arg == "--no-chunk-skipping") {
+      options.skip_uniform_chunks = false;
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      print_usage();
+      return 1;
+    }
+  }
+
+  App app{options};
   app.exec();
 }
@@ -0,0 +1,249 @@
+#include "bricked_mesh.hpp"
+
+#include <algorithm>
+#include <span>
+
+namespace {
+
+constexpr int halo = ChunkDensityField::halo;
+constexpr int points_per_axis = ChunkDensityField::points_per_axis;
+// Lattice points read by the cells of a brick along each axis, from its first
+// cell: the corners of its cells and of the owner cells past its max faces,
+// and one more point on each side for the gradients of the vertices
+constexpr int first_point_read = -1;
+constexpr int last_point_read = mesh_brick_dimension + 1;
+
+// Bricks along an axis whose cells read the points from `min` to `max`
+[[nodiscard]] auto bricks_reading_along_axis(int min, int max) -> unsigned
+{
+  unsigned bricks = 0;
+  for (int brick = 0; brick < mesh_bricks_per_axis; ++brick) {
+    const int first_cell = brick * mesh_brick_dimension;
+    if (first_cell + first_point_read <= max &&
+        min <= first_cell + last_point_read) {
+      bricks |= 1u << static_cast<unsigned>(brick);
+    }
+  }
+  return bricks;
+}
+
+// Bricks of a row of bricks along x, from the brick at y and z
+[[nodiscard]] auto brick_row(MeshBrickMask bricks, int y, int z) -> unsigned
+{
+  constexpr MeshBrickMask row_mask = (1u << mesh_bricks_per_axis) - 1;
+  const auto shift =
+      static_cast<unsigned>((z * mesh_bricks_per_axis + y) *
+                            mesh_bricks_per_axis);
+  return static_cast<unsigned>((bricks >> shift) & row_mask);
+}
+
+[[nodiscard]] auto vertex_capacity_for(std::size_t vertex_count)
+    -> std::uint32_t
+{
+  return static_cast<std::uint32_t>(vertex_count + vertex_count / 2);
+}
+
+[[nodiscard]] auto index_capacity_for(std::size_t index_count)
+    -> std::uint32_t
+{
+  const std::size_t triangle_count = index_count / 3;
+  return static_cast<std::uint32_t>(3 * (triangle_count + triangle_count / 2));
+}
+
+// Appends the indices of a brick relative to the first vertex of its range,
+// then degenerate triangles up to the capacity of the range
+void append_brick_indices(const ChunkMesh& brick, const MeshBrickRange& range,
+                          std::vector<std::uint32_t>& indices)
+{
+  for (const std::uint32_t index : brick.indices) {
+    indices.push_back(range.first_vertex + index);
+  }
+  indices.resize(indices.size() + range.index_capacity - brick.indices.size(),
+                 0);
+}
+
+} // anonymous namespace
+
+auto mesh_bricks_reading(std::array<int, 3> min, std::array<int, 3> max)
+    -> MeshBrickMask
+{
+  const unsigned x_bricks = bricks_reading_along_axis(min[0], max[0]);
+  const unsigned y_bricks = bricks_reading_along_axis(min[1], max[1]);
+  const unsigned z_bricks = bricks_reading_along_axis(min[2], max[2]);
+  MeshBrickMask bricks = 0;
+  for (int z = 0; z < mesh_bricks_per_axis; ++z) {
+    if ((z_bricks & (1u << static_cast<unsigned>(z))) == 0u) { continue; }
+    for (int y = 0; y < mesh_bricks_per_axis; ++y) {
+      if ((y_bricks & (1u << static_cast<unsigned>(y))) == 0u) { continue; }
+      const auto shift = static_cast<unsigned>(
+          (z * mesh_bricks_per_axis + y) * mesh_bricks_per_axis);
+      bricks |= MeshBrickMask{x_bricks} << shift;
+    }
+  }
+  return bricks;
+}
+
+void generate_brick_densities(ChunkKey chunk, MeshBrickMask bricks,
+                              ChunkDensityField& field)
+{
+  const int scale = chunk.scale();
+  const auto origin = [scale](int chunk_coordinate) {
+    return static_cast<float>(chunk_origin(chunk_coordinate, scale));
+  };
+  const float origin_x = origin(chunk.position.x);
+  const float origin_y = origin(chunk.position.y);
+  const float origin_z = origin(chunk.position.z);
+  const auto step = static_cast<float>(scale);
+
+  // Rows of points along x, each evaluated once over the runs of consecutive
+  // bricks that read it
+  for (int z = -halo; z < points_per_axis - halo; ++z) {
+    const unsigned z_bricks = bricks_reading_along_axis(z, z);
+    for (int y = -halo; y < points_per_axis - halo; ++y) {
+      const unsigned y_bricks = bricks_reading_along_axis(y, y);
+      unsigned x_bricks = 0;
+      for (int bz = 0; bz < mesh_bricks_per_axis; ++bz) {
+        for (int by = 0; by < mesh_bricks_per_axis; ++by) {
+          if ((z_bricks & (1u << static_cast<unsigned>(bz))) != 0u &&
+              (y_bricks & (1u << static_cast<unsigned>(by))) != 0u) {
+            x_bricks |= brick_row(bricks, by, bz);
+          }
+        }
+      }
+
+      int bx = 0;
+      while (bx < mesh_bricks_per_axis) {
+        if ((x_bricks & (1u << static_cast<unsigned>(bx))) == 0u) {
+          ++bx;
+          continue;
+        }
+        const int first_brick = bx;
+        while (bx < mesh_bricks_per_axis &&
+               (x_bricks & (1u << static_cast<unsigned>(bx))) != 0u) {
+          ++bx;
+        }
+        const int first =
+            first_brick * mesh_brick_dimension + first_point_read;
+        const int last = (bx - 1) * mesh_brick_dimension + last_point_read;
+        const std::span<float> row{
+            field.densities.data() + ChunkDensityField::index_of(first, y, z),
+            static_cast<std::size_t>(last - first + 1)};
+        evaluate_density_row(origin_x + step * static_cast<float>(first),
+                             origin_y + step * static_cast<float>(y),
+                             origin_z + step * static_cast<float>(z), step,
+                             row);
+      }
+    }
+  }
+}
+
+auto mesh_in_bricks(const ChunkDensityField& field) -> BrickedMesh
+{
+  std::array<ChunkMesh, mesh_brick_count> bricks;
+  BrickedMesh result;
+  BrickedMeshLayout& layout = result.layout;
+  for (int brick = 0; brick < mesh_brick_count; ++brick) {
+    const auto b = static_cast<std::size_t>(brick);
+    bricks[b] = mesh_density_cells(field, mesh_brick_first_cell(brick),
+                                   mesh_brick_dimension);
+    layout.bricks[b] = {
+        .first_vertex = layout.vertex_count,
+        .vertex_capacity = vertex_capacity_for(bricks[b].vertices.size()),
+        .first_index = layout.index_count,
+        .index_capacity = index_capacity_for(bricks[b].indices.size()),
+    };
+    layout.vertex_count += layout.bricks[b].vertex_capacity;
+    layout.index_count += layout.bricks[b].index_capacity;
+  }
+
+  ChunkMesh& mesh = result.mesh;
+  mesh.vertices.reserve(layout.vertex_count);
+  mesh.indices.reserve(layout.index_count);
+  for (std::size_t b = 0; b < bricks.size(); ++b) {
+    const MeshBrickRange& range = layout.bricks[b];
+    mesh.vertices.insert(mesh.vertices.end(), bricks[b].vertices.begin(),
+                         bricks[b].vertices.end());
+    mesh.vertices.resize(range.first_vertex + range.vertex_capacity);
+    append_brick_indices(bricks[b], range, mesh.indices);
+  }
+  return result;
+}
+
+auto patch_bricks(const ChunkDensityField& field,
+                  const BrickedMeshLayout& layout, MeshBrickMask bricks)
+    -> std::optional<BrickedMeshPatch>
+{
+  BrickedMeshPatch patch;
+  patch.layout = layout;
+  ChunkMesh& data = patch.data;
+  for (int brick = 0; brick < mesh_brick_count; ++brick) {
+    if ((bricks & (MeshBrickMask{1} << static_cast<unsigned>(brick))) == 0) {
+      continue;
+    }
+    const ChunkMesh mesh = mesh_density_cells(
+        field, mesh_brick_first_cell(brick), mesh_brick_dimension);
+    MeshBrickRange& range =
+        patch.layout.bricks[static_cast<std::size_t>(brick)];
+    if (mesh.vertices.size() > range.vertex_capacity ||
+        mesh.indices.size() > range.index_capacity) {
+      // The old ranges are left dead, without any triangle
+      if (range.index_capacity != 0) {
+        patch.index_copies.push_back(
+            {.source = static_cast<std::uint32_t>(data.indices.size()),
+             .destination = range.first_index,
+             .count = range.index_capacity});
+        data.indices.resize(data.indices.size() + range.index_capacity, 0);
+      }
+      range = {
+          .first_vertex = patch.layout.vertex_count,
+          .vertex_capacity = vertex_capacity_for(mesh.vertices.size()),
+          .first_index = patch.layout.index_count,
+          .index_capacity = index_capacity_for(mesh.indices.size()),
+      };
+      patch.layout.vertex_count += range.vertex_capacity;
+      patch.layout.index_count += range.index_capacity;
+    }
+
+    if (!mesh.vertices.empty()) {
+      patch.vertex_copies.push_back(
+          {.source = static_cast<std::uint32_t>(data.vertices.size()),
+           .destination = range.first_vertex,
+           .count = static_cast<std::uint32_t>(mesh.vertices.size())});
+      data.vertices.insert(data.vertices.end(), mesh.vertices.begin(),
+                           mesh.vertices.end());
+    }
+    if (range.index_capacity != 0) {
+      patch.index_copies.push_back(
+          {.source = static_cast<std::uint32_t>(data.indices.size()),
+           .destination = range.first_index,
+           .count = range.index_capacity});
+      append_brick_indices(mesh, range, data.indices);
+    }
+  }
+
+  std::uint32_t live_vertex_count = 0;
+  std::uint32_t live_index_count = 0;
+  for (const MeshBrickRange& range : patch.layout.bricks) {
+    live_vertex_count += range.vertex_capacity;
+    live_index_count += range.index_capacity;
+  }
+  if (patch.layout.vertex_count - live_vertex_count > live_vertex_count ||
+      patch.layout.index_count - live_index_count > live_index_count) {
+    return std::nullopt;
+  }
+  return patch;
+}
+
+void apply_patch(const BrickedMeshPatch& patch, ChunkMesh& mesh)
+{
+  mesh.vertices.resize(patch.layout.vertex_count);
+  mesh.indices.resize(patch.layout.index_count);
+  for (const MeshPatchCopy& copy : patch.vertex_copies) {
+    std::copy_n(patch.data.vertices.data() + copy.source, copy.count,
+                mesh.vertices.data() + copy.destination);
+  }
+  for (const MeshPatchCopy& copy : patch.index_copies) {
+    std::copy_n(patch.data.indices.data() + copy.source, copy.count,
+                mesh.indices.data() + copy.destination);
+  }
+}
@@ -0,0 +1,106 @@
+#ifndef VOXEL_GAME_TERRAIN_BRICKED_MESH_HPP
+#define VOXEL_GAME_TERRAIN_BRICKED_MESH_HPP
+
+#include "chunk_key.hpp"
+#include "cpu_mesher.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Meshes of edited chunks are made of the meshes of bricks of
+// mesh_brick_dimension^3 cells, each in its own range of the vertices and
+// indices of the chunk, with room to grow. An edit remeshes only the bricks
+// whose cells read the densities it changed, and writes them over their
+// ranges in a copy of the previous mesh, without touching the other bricks
+//
+// Unused indices of a range form degenerate triangles. A brick that outgrows
+// its range moves to new ranges at the end of the mesh, and the mesh is laid
+// out again once such dead ranges take more room than the live ones
+
+inline constexpr int mesh_brick_dimension = 8; // In cells
+inline constexpr int mesh_bricks_per_axis =
+    ChunkDensityField::chunk_dimension / mesh_brick_dimension;
+inline constexpr int mesh_brick_count =
+    mesh_bricks_per_axis * mesh_bricks_per_axis * mesh_bricks_per_axis;
+
+// Bit `i` stands for the brick `i`, see mesh_brick_first_cell
+using MeshBrickMask = std::uint64_t;
+static_assert(mesh_brick_count == 64);
+inline constexpr MeshBrickMask all_mesh_bricks = ~MeshBrickMask{0};
+
+[[nodiscard]] constexpr auto mesh_brick_first_cell(int brick)
+    -> std::array<int, 3>
+{
+  return {brick % mesh_bricks_per_axis * mesh_brick_dimension,
+          brick / mesh_bricks_per_axis % mesh_bricks_per_axis *
+              mesh_brick_dimension,
+          brick / (mesh_bricks_per_axis * mesh_bricks_per_axis) *
+              mesh_brick_dimension};
+}
+
+// Bricks whose cells read lattice points, given in coordinates of
+// ChunkDensityField, from `min` to `max` included along each axis
+[[nodiscard]] auto mesh_bricks_reading(std::array<int, 3> min,
+                                       std::array<int, 3> max)
+    -> MeshBrickMask;
+
+struct MeshBrickRange {
+  std::uint32_t first_vertex = 0;
+  std::uint32_t vertex_capacity = 0;
+  std::uint32_t first_index = 0;
+  std::uint32_t index_capacity = 0; // A multiple of 3
+};
+
+struct BrickedMeshLayout {
+  std::array<MeshBrickRange, mesh_brick_count> bricks{};
+  // Of the whole mesh, dead ranges included
+  std::uint32_t vertex_count = 0;
+  std::uint32_t index_count = 0;
+};
+
+struct BrickedMesh {
+  BrickedMeshLayout layout;
+  ChunkMesh mesh; // Indices relative to the first vertex of the chunk
+};
+
+// Copy of `count` elements from the data of a patch into the mesh
+struct MeshPatchCopy {
+  std::uint32_t source = 0;
+  std::uint32_t destination = 0;
+  std::uint32_t count = 0;
+};
+
+// Bricks to write over a copy of a bricked mesh, which needs to be resized to
+// the counts of the new layout first
+struct BrickedMeshPatch {
+  BrickedMeshLayout layout; // Once patched
+  ChunkMesh data;
+  std::vector<MeshPatchCopy> vertex_copies; // From data.vertices
+  std::vector<MeshPatchCopy> index_copies;  // From data.indices
+};
+
+// Fills the densities of the lattice points read by the cells of `bricks`.
+// The others are left as they are
+void generate_brick_densities(ChunkKey chunk, MeshBrickMask bricks,
+                              ChunkDensityField& field);
+
+// Meshes every brick, with the triangles of mesh_density_field without
+// transition faces
+[[nodiscard]] auto mesh_in_bricks(const ChunkDensityField& field)
+    -> BrickedMesh;
+
+// Remeshes `bricks` of a mesh laid out as `layout`, from `field` whose
+// densities need to be up to date only for those bricks. Returns nothing if
+// the mesh needs to be laid out again, by mesh_in_bricks
+[[nodiscard]] auto patch_bricks(const ChunkDensityField& field,
+                                const BrickedMeshLayout& layout,
+                                MeshBrickMask bricks)
+    -> std::optional<BrickedMeshPatch>;
+
+// Applies a patch to the vertices and indices of a mesh, in place. What
+// the upload of a patch does on the GPU
+void apply_patch(const BrickedMeshPatch& patch, ChunkMesh& mesh);
+
+#endif // VOXEL_GAME_TERRAIN_BRICKED_MESH_HPP
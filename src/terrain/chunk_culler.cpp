@@ -0,0 +1,540 @@
+#include "chunk_culler.hpp"
+
+#include "../vulkan_helpers/compute_pipeline.hpp"
+#include "../vulkan_helpers/debug_utils.hpp"
+#include "../vulkan_helpers/descriptor_pool.hpp"
+
+#include <beyond/utils/bit_cast.hpp>
+#include <beyond/utils/size.hpp>
+#include <beyond/utils/to_pointer.hpp>
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+
+namespace {
+
+constexpr std::uint32_t max_depth_pyramid_level_count = 16;
+constexpr std::uint32_t max_frames_in_flight = 8;
+constexpr std::uint32_t culling_local_size = 64;
+constexpr std::uint32_t depth_pyramid_local_size = 8;
+
+// Needs to match the flags in chunk_culling.comp.glsl
+constexpr std::uint32_t frustum_culling_bit = 1;
+constexpr std::uint32_t occlusion_culling_bit = 2;
+
+struct CullingUniforms {
+  beyond::Mat4 viewproj;
+  beyond::Mat4 depth_pyramid_viewproj;
+  float depth_pyramid_width = 0;
+  float depth_pyramid_height = 0;
+  std::uint32_t draw_count = 0;
+  std::uint32_t flags = 0;
+};
+
+struct DepthPyramidPushConstants {
+  std::uint32_t source_width = 0;
+  std::uint32_t source_height = 0;
+  std::uint32_t destination_width = 0;
+  std::uint32_t destination_height = 0;
+};
+
+[[nodiscard]] auto level_extent(VkExtent2D extent, std::uint32_t level)
+    -> VkExtent2D
+{
+  return {std::max(extent.width >> level, 1u),
+          std::max(extent.height >> level, 1u)};
+}
+
+[[nodiscard]] constexpr auto group_count(std::uint32_t size,
+                                         std::uint32_t local_size)
+    -> std::uint32_t
+{
+  return (size + local_size - 1) / local_size;
+}
+
+} // anonymous namespace
+
+ChunkCuller::ChunkCuller(vkh::Context& context,
+                         const ChunkCullerCreateInfo& create_info)
+    : context_{context},
+      depth_extent_{create_info.depth_extent},
+      depth_pyramid_extent_{(create_info.depth_extent.width + 1) / 2,
+                            (create_info.depth_extent.height + 1) / 2},
+      max_draw_count_{create_info.max_draw_count}
+{
+  depth_pyramid_level_count_ = std::min(
+      static_cast<std::uint32_t>(std::bit_width(std::max(
+          depth_pyramid_extent_.width, depth_pyramid_extent_.height))),
+      max_depth_pyramid_level_count);
+
+  init_depth_pyramid(create_info.depth_image_view);
+  init_pipelines();
+  init_frames(create_info);
+}
+
+ChunkCuller::~ChunkCuller()
+{
+  for (CullingFrame& frame : frames_) {
+    vkh::destroy_buffer(context_, frame.stats_buffer);
+    vkh::destroy_buffer(context_, frame.visible_draw_buffer);
+    vkh::destroy_buffer(context_, frame.uniform_buffer);
+  }
+
+  vkDestroyPipeline(context_.device(), culling_pipeline_, nullptr);
+  vkDestroyPipeline(context_.device(), depth_pyramid_pipeline_, nullptr);
+  vkDestroyPipelineLayout(context_.device(), culling_pipeline_layout_, nullptr);
+  vkDestroyPipelineLayout(context_.device(), depth_pyramid_pipeline_layout_,
+                          nullptr);
+  vkDestroyDescriptorSetLayout(context_.device(),
+                               culling_descriptor_set_layout_, nullptr);
+  vkDestroyDescriptorSetLayout(context_.device(),
+                               depth_pyramid_descriptor_set_layout_, nullptr);
+  vkDestroyDescriptorPool(context_.device(), descriptor_pool_, nullptr);
+
+  vkDestroySampler(context_.device(), depth_sampler_, nullptr);
+  for (VkImageView view : depth_pyramid_level_views_) {
+    vkDestroyImageView(context_.device(), view, nullptr);
+  }
+  vkDestroyImageView(context_.device(), depth_pyramid_view_, nullptr);
+  vmaDestroyImage(context_.allocator(), depth_pyramid_image_,
+                  depth_pyramid_allocation_);
+}
+
+void ChunkCuller::init_depth_pyramid(VkImageView depth_image_view)
+{
+  const VkImageCreateInfo image_create_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .imageType = VK_IMAGE_TYPE_2D,
+      .format = VK_FORMAT_R32_SFLOAT,
+      .extent = {depth_pyramid_extent_.width, depth_pyramid_extent_.height, 1},
+      .mipLevels = depth_pyramid_level_count_,
+      .arrayLayers = 1,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      .usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+  };
+  constexpr VmaAllocationCreateInfo allocation_create_info = {
+      .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+  };
+  VK_CHECK(vmaCreateImage(context_.allocator(), &image_create_info,
+                          &allocation_create_info, &depth_pyramid_image_,
+                          &depth_pyramid_allocation_, nullptr));
+  VK_CHECK(vkh::set_debug_name(
+      context_, beyond::bit_cast<uint64_t>(depth_pyramid_image_),
+      VK_OBJECT_TYPE_IMAGE, "Depth Pyramid"));
+
+  const auto create_view = [&](std::uint32_t base_level,
+                               std::uint32_t level_count) {
+    const VkImageViewCreateInfo view_create_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = depth_pyramid_image_,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = VK_FORMAT_R32_SFLOAT,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = base_level,
+            .levelCount = level_count,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        }};
+    VkImageView view = VK_NULL_HANDLE;
+    VK_CHECK(
+        vkCreateImageView(context_.device(), &view_create_info, nullptr, &view));
+    return view;
+  };
+  depth_pyramid_view_ = create_view(0, depth_pyramid_level_count_);
+  for (std::uint32_t level = 0; level < depth_pyramid_level_count_; ++level) {
+    depth_pyramid_level_views_.push_back(create_view(level, 1));
+  }
+
+  static constexpr VkSamplerCreateInfo sampler_create_info = {
+      .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter = VK_FILTER_NEAREST,
+      .minFilter = VK_FILTER_NEAREST,
+      .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+      .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .maxLod = VK_LOD_CLAMP_NONE,
+  };
+  VK_CHECK(vkCreateSampler(context_.device(), &sampler_create_info, nullptr,
+                           &depth_sampler_));
+
+  static constexpr VkDescriptorPoolSize pool_sizes[] = {
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+       max_depth_pyramid_level_count + max_frames_in_flight},
+      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, max_depth_pyramid_level_count},
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * max_frames_in_flight},
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, max_frames_in_flight}};
+  descriptor_pool_ =
+      vkh::create_descriptor_pool(
+          context_, {.max_sets = max_depth_pyramid_level_count +
+                                 max_frames_in_flight,
+                     .pool_sizes = pool_sizes,
+                     .debug_name = "Chunk Culling Descriptor Pool"})
+          .value();
+
+  static constexpr VkDescriptorSetLayoutBinding depth_pyramid_bindings[] = {
+      {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,
+       VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+       nullptr}};
+  static constexpr VkDescriptorSetLayoutCreateInfo
+      depth_pyramid_set_layout_create_info = {
+          .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+          .bindingCount = beyond::size(depth_pyramid_bindings),
+          .pBindings = beyond::to_pointer(depth_pyramid_bindings)};
+  VK_CHECK(vkCreateDescriptorSetLayout(
+      context_.device(), &depth_pyramid_set_layout_create_info, nullptr,
+      &depth_pyramid_descriptor_set_layout_));
+
+  // Level 0 is downsampled from the depth buffer, the others from the level
+  // above them
+  depth_pyramid_descriptor_sets_.resize(depth_pyramid_level_count_);
+  for (std::uint32_t level = 0; level < depth_pyramid_level_count_; ++level) {
+    VkDescriptorSet& descriptor_set = depth_pyramid_descriptor_sets_[level];
+    const VkDescriptorSetAllocateInfo allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = descriptor_pool_,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &depth_pyramid_descriptor_set_layout_,
+    };
+    VK_CHECK(vkAllocateDescriptorSets(context_.device(), &allocate_info,
+                                      &descriptor_set));
+
+    const VkDescriptorImageInfo source_info =
+        level == 0 ? VkDescriptorImageInfo{depth_sampler_, depth_image_view,
+                                           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}
+                   : VkDescriptorImageInfo{depth_sampler_,
+                                           depth_pyramid_level_views_[level - 1],
+                                           VK_IMAGE_LAYOUT_GENERAL};
+    const VkDescriptorImageInfo destination_info = {
+        VK_NULL_HANDLE, depth_pyramid_level_views_[level],
+        VK_IMAGE_LAYOUT_GENERAL};
+
+    const VkWriteDescriptorSet writes[] = {
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptor_set, 0, 0,
+         1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &source_info, nullptr,
+         nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptor_set, 1, 0,
+         1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &destination_info, nullptr,
+         nullptr}};
+    vkUpdateDescriptorSets(context_.device(), beyond::size(writes),
+                           beyond::to_pointer(writes), 0, nullptr);
+  }
+}
+
+void ChunkCuller::init_pipelines()
+{
+  static constexpr VkPushConstantRange depth_pyramid_push_constant_range{
+      .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+      .offset = 0,
+      .size = sizeof(DepthPyramidPushConstants),
+  };
+  const VkPipelineLayoutCreateInfo depth_pyramid_layout_create_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = 1,
+      .pSetLayouts = &depth_pyramid_descriptor_set_layout_,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &depth_pyramid_push_constant_range,
+  };
+  VK_CHECK(vkCreatePipelineLayout(context_.device(),
+                                  &depth_pyramid_layout_create_info, nullptr,
+                                  &depth_pyramid_pipeline_layout_));
+  depth_pyramid_pipeline_ =
+      vkh::create_compute_pipeline(
+          context_, {.pipeline_layout = depth_pyramid_pipeline_layout_,
+                     .shader_filename = "shaders/depth_pyramid.comp.spv",
+                     .debug_name = "Depth Pyramid Pipeline"})
+          .value();
+
+  static constexpr VkDescriptorSetLayoutBinding culling_bindings[] = {
+      {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+       nullptr},
+      {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+       nullptr},
+      {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+       nullptr},
+      {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+       nullptr},
+      {4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+       nullptr},
+      {5, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,
+       VK_SHADER_STAGE_COMPUTE_BIT, nullptr}};
+  static constexpr VkDescriptorSetLayoutCreateInfo
+      culling_set_layout_create_info = {
+          .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+          .bindingCount = beyond::size(culling_bindings),
+          .pBindings = beyond::to_pointer(culling_bindings)};
+  VK_CHECK(vkCreateDescriptorSetLayout(context_.device(),
+                                       &culling_set_layout_create_info,
+                                       nullptr, &culling_descriptor_set_layout_));
+
+  const VkPipelineLayoutCreateInfo culling_layout_create_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = 1,
+      .pSetLayouts = &culling_descriptor_set_layout_,
+  };
+  VK_CHECK(vkCreatePipelineLayout(context_.device(),
+                                  &culling_layout_create_info, nullptr,
+                                  &culling_pipeline_layout_));
+  culling_pipeline_ =
+      vkh::create_compute_pipeline(
+          context_, {.pipeline_layout = culling_pipeline_layout_,
+                     .shader_filename = "shaders/chunk_culling.comp.spv",
+                     .debug_name = "Chunk Culling Pipeline"})
+          .value();
+}
+
+void ChunkCuller::init_frames(const ChunkCullerCreateInfo& create_info)
+{
+  BEYOND_ENSURE(create_info.frames_in_flight <= max_frames_in_flight);
+  BEYOND_ENSURE(create_info.draw_command_buffers.size() ==
+                create_info.frames_in_flight);
+  BEYOND_ENSURE(create_info.draw_transform_buffers.size() ==
+                create_info.frames_in_flight);
+
+  frames_.resize(create_info.frames_in_flight);
+  for (std::size_t i = 0; i < frames_.size(); ++i) {
+    CullingFrame& frame = frames_[i];
+    frame.uniform_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(CullingUniforms),
+             .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+             .debug_name =
+                 fmt::format("Chunk Culling Uniform Buffer ({})", i).c_str()})
+            .value();
+    frame.visible_draw_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(VkDrawIndexedIndirectCommand) * max_draw_count_,
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
+             .debug_name =
+                 fmt::format("Visible Chunk Draw Buffer ({})", i).c_str()})
+            .value();
+    frame.stats_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(ChunkCullingStats),
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_GPU_TO_CPU,
+             .debug_name =
+                 fmt::format("Chunk Culling Stats Buffer ({})", i).c_str()})
+            .value();
+    *context_.map<ChunkCullingStats>(frame.stats_buffer).value() = {};
+    context_.unmap(frame.stats_buffer);
+
+    const VkDescriptorSetAllocateInfo allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = descriptor_pool_,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &culling_descriptor_set_layout_,
+    };
+    VK_CHECK(vkAllocateDescriptorSets(context_.device(), &allocate_info,
+                                      &frame.descriptor_set));
+
+    const VkDescriptorBufferInfo draw_command_info = {
+        create_info.draw_command_buffers[i], 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo draw_transform_info = {
+        create_info.draw_transform_buffers[i], 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo visible_draw_info = {frame.visible_draw_buffer,
+                                                      0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo stats_info = {frame.stats_buffer, 0,
+                                               VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo uniform_info = {frame.uniform_buffer, 0,
+                                                 VK_WHOLE_SIZE};
+    const VkDescriptorImageInfo depth_pyramid_info = {
+        depth_sampler_, depth_pyramid_view_, VK_IMAGE_LAYOUT_GENERAL};
+
+    const VkWriteDescriptorSet writes[] = {
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, frame.descriptor_set,
+         0, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &draw_command_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, frame.descriptor_set,
+         1, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &draw_transform_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, frame.descriptor_set,
+         2, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &visible_draw_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, frame.descriptor_set,
+         3, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &stats_info,
+         nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, frame.descriptor_set,
+         4, 0, 1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, nullptr, &uniform_info,
+         nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, frame.descriptor_set,
+         5, 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+         &depth_pyramid_info, nullptr, nullptr}};
+    vkUpdateDescriptorSets(context_.device(), beyond::size(writes),
+                           beyond::to_pointer(writes), 0, nullptr);
+  }
+}
+
+void ChunkCuller::cull(VkCommandBuffer command_buffer,
+                       std::uint32_t frame_index, const beyond::Mat4& viewproj,
+                       std::uint32_t draw_count)
+{
+  CullingFrame& frame = frames_[frame_index];
+
+  // The last submission of this frame is complete, so its stats are ready
+  VK_CHECK(vmaInvalidateAllocation(context_.allocator(),
+                                   frame.stats_buffer.allocation, 0,
+                                   VK_WHOLE_SIZE));
+  stats_ = *context_.map<ChunkCullingStats>(frame.stats_buffer).value();
+  context_.unmap(frame.stats_buffer);
+
+  std::uint32_t flags = 0;
+  if (frustum_culling_) { flags |= frustum_culling_bit; }
+  if (occlusion_culling_ && has_depth_pyramid_) {
+    flags |= occlusion_culling_bit;
+  }
+  *context_.map<CullingUniforms>(frame.uniform_buffer).value() = {
+      .viewproj = viewproj,
+      .depth_pyramid_viewproj = depth_pyramid_viewproj_,
+      .depth_pyramid_width = static_cast<float>(depth_pyramid_extent_.width),
+      .depth_pyramid_height = static_cast<float>(depth_pyramid_extent_.height),
+      .draw_count = draw_count,
+      .flags = flags,
+  };
+  context_.unmap(frame.uniform_buffer);
+
+  vkCmdFillBuffer(command_buffer, frame.stats_buffer, 0, VK_WHOLE_SIZE, 0);
+  const VkMemoryBarrier clear_barrier{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                       &clear_barrier, 0, nullptr, 0, nullptr);
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    culling_pipeline_);
+  vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          culling_pipeline_layout_, 0, 1, &frame.descriptor_set,
+                          0, nullptr);
+  vkCmdDispatch(command_buffer, group_count(draw_count, culling_local_size), 1,
+                1);
+
+  const VkMemoryBarrier cull_barrier{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask =
+          VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT,
+  };
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                           VK_PIPELINE_STAGE_HOST_BIT,
+                       0, 1, &cull_barrier, 0, nullptr, 0, nullptr);
+}
+
+void ChunkCuller::draw(VkCommandBuffer command_buffer,
+                       std::uint32_t frame_index)
+{
+  const CullingFrame& frame = frames_[frame_index];
+  vkCmdDrawIndexedIndirectCount(
+      command_buffer, frame.visible_draw_buffer.buffer, 0,
+      frame.stats_buffer.buffer, offsetof(ChunkCullingStats, visible),
+      max_draw_count_, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void ChunkCuller::build_depth_pyramid(VkCommandBuffer command_buffer,
+                                      VkImage depth_image,
+                                      const beyond::Mat4& viewproj)
+{
+  // Also waits for the culling of this frame before the pyramid is overwritten
+  const VkImageMemoryBarrier image_barriers[] = {
+      {
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+          .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+          .oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+          .newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = depth_image,
+          .subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1},
+      },
+      {
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = 0,
+          .dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+          .oldLayout = has_depth_pyramid_ ? VK_IMAGE_LAYOUT_GENERAL
+                                          : VK_IMAGE_LAYOUT_UNDEFINED,
+          .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = depth_pyramid_image_,
+          .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0,
+                               depth_pyramid_level_count_, 0, 1},
+      }};
+  vkCmdPipelineBarrier(command_buffer,
+                       VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                           VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                           VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0,
+                       nullptr, beyond::size(image_barriers),
+                       beyond::to_pointer(image_barriers));
+
+  vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    depth_pyramid_pipeline_);
+
+  static constexpr VkMemoryBarrier level_barrier{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+  };
+  VkExtent2D source_extent = depth_extent_;
+  for (std::uint32_t level = 0; level < depth_pyramid_level_count_; ++level) {
+    const VkExtent2D destination_extent =
+        level_extent(depth_pyramid_extent_, level);
+    const DepthPyramidPushConstants push_constants{
+        .source_width = source_extent.width,
+        .source_height = source_extent.height,
+        .destination_width = destination_extent.width,
+        .destination_height = destination_extent.height,
+    };
+
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            depth_pyramid_pipeline_layout_, 0, 1,
+                            &depth_pyramid_descriptor_sets_[level], 0, nullptr);
+    vkCmdPushConstants(command_buffer, depth_pyramid_pipeline_layout_,
+                       VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push_constants),
+                       &push_constants);
+    vkCmdDispatch(
+        command_buffer,
+        group_count(destination_extent.width, depth_pyramid_local_size),
+        group_count(destination_extent.height, depth_pyramid_local_size), 1);
+
+    // Makes the level visible to the next level and to the culling of the
+    // next frame, and keeps the next render pass from overwriting the depth
+    // buffer while it is read
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                             VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                             VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                         0, 1, &level_barrier, 0, nullptr, 0, nullptr);
+    source_extent = destination_extent;
+  }
+
+  depth_pyramid_viewproj_ = viewproj;
+  has_depth_pyramid_ = true;
+}
+
+void ChunkCuller::draw_gui()
+{
+  ImGui::Checkbox("Frustum culling", &frustum_culling_);
+  ImGui::Checkbox("Occlusion culling", &occlusion_culling_);
+  ImGui::Text("Visible chunks: %u", stats_.visible);
+  ImGui::Text("Frustum culled chunks: %u", stats_.frustum_culled);
+  ImGui::Text("Occlusion culled chunks: %u", stats_.occlusion_culled);
+}
@@ -0,0 +1,104 @@
+#ifndef VOXEL_GAME_TERRAIN_CHUNK_CULLER_HPP
+#define VOXEL_GAME_TERRAIN_CHUNK_CULLER_HPP
+
+#include "../vulkan_helpers/buffer.hpp"
+#include "../vulkan_helpers/context.hpp"
+
+#include <beyond/math/matrix.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct ChunkCullingStats {
+  std::uint32_t visible = 0;
+  std::uint32_t frustum_culled = 0;
+  std::uint32_t occlusion_culled = 0;
+};
+
+struct ChunkCullerCreateInfo {
+  VkExtent2D depth_extent = {};
+  VkImageView depth_image_view = VK_NULL_HANDLE;
+  std::uint32_t frames_in_flight = 0;
+
+  // Draws of the chunk manager for each frame in flight, see
+  // ChunkManager::draw_command_buffer
+  std::span<const VkBuffer> draw_command_buffers;
+  std::span<const VkBuffer> draw_transform_buffers;
+  std::uint32_t max_draw_count = 0;
+};
+
+// Culls chunk draws against the view frustum and against a hierarchical depth
+// pyramid built from the depth buffer of the previous frame, then compacts the
+// surviving draws into an indirect draw list
+class ChunkCuller {
+  struct CullingFrame {
+    vkh::Buffer uniform_buffer{};
+    vkh::Buffer visible_draw_buffer{};
+    vkh::Buffer stats_buffer{}; // Starts with the visible draw count
+    VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+  };
+
+  vkh::Context& context_;
+  VkExtent2D depth_extent_{};
+  VkExtent2D depth_pyramid_extent_{};
+  std::uint32_t depth_pyramid_level_count_ = 0;
+  std::uint32_t max_draw_count_ = 0;
+
+  VkImage depth_pyramid_image_ = VK_NULL_HANDLE;
+  VmaAllocation depth_pyramid_allocation_ = VK_NULL_HANDLE;
+  VkImageView depth_pyramid_view_ = VK_NULL_HANDLE; // All the levels
+  std::vector<VkImageView> depth_pyramid_level_views_;
+  VkSampler depth_sampler_ = VK_NULL_HANDLE;
+
+  VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
+  VkDescriptorSetLayout depth_pyramid_descriptor_set_layout_ = VK_NULL_HANDLE;
+  VkDescriptorSetLayout culling_descriptor_set_layout_ = VK_NULL_HANDLE;
+  VkPipelineLayout depth_pyramid_pipeline_layout_ = VK_NULL_HANDLE;
+  VkPipelineLayout culling_pipeline_layout_ = VK_NULL_HANDLE;
+  VkPipeline depth_pyramid_pipeline_ = VK_NULL_HANDLE;
+  VkPipeline culling_pipeline_ = VK_NULL_HANDLE;
+  std::vector<VkDescriptorSet> depth_pyramid_descriptor_sets_; // One per level
+
+  std::vector<CullingFrame> frames_;
+
+  // The depth pyramid is built with the view projection of the previous frame
+  beyond::Mat4 depth_pyramid_viewproj_{};
+  bool has_depth_pyramid_ = false;
+
+  bool frustum_culling_ = true;
+  bool occlusion_culling_ = true;
+  ChunkCullingStats stats_{};
+
+public:
+  ChunkCuller(vkh::Context& context, const ChunkCullerCreateInfo& create_info);
+  ~ChunkCuller();
+  ChunkCuller(const ChunkCuller&) = delete;
+  auto operator=(const ChunkCuller&) & -> ChunkCuller& = delete;
+  ChunkCuller(ChunkCuller&&) noexcept = delete;
+  auto operator=(ChunkCuller&&) & noexcept -> ChunkCuller& = delete;
+
+  // Records the culling of the first `draw_count` draws. Needs to be recorded
+  // outside of a render pass, after the fence of the frame is waited
+  void cull(VkCommandBuffer command_buffer, std::uint32_t frame_index,
+            const beyond::Mat4& viewproj, std::uint32_t draw_count);
+
+  // Draws the visible chunks of the frame inside the current render pass. The
+  // terrain vertex and index buffers need to be bound
+  void draw(VkCommandBuffer command_buffer, std::uint32_t frame_index);
+
+  // Records the downsampling of the depth buffer into the pyramid used by the
+  // next frame. Needs to be recorded right after the render pass that wrote
+  // the depth with `viewproj`
+  void build_depth_pyramid(VkCommandBuffer command_buffer,
+                           VkImage depth_image, const beyond::Mat4& viewproj);
+
+  void draw_gui();
+
+private:
+  void init_depth_pyramid(VkImageView depth_image_view);
+  void init_pipelines();
+  void init_frames(const ChunkCullerCreateInfo& create_info);
+};
+
+#endif // VOXEL_GAME_TERRAIN_CHUNK_CULLER_HPP
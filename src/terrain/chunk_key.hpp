@@ -0,0 +1,89 @@
+#ifndef VOXEL_GAME_TERRAIN_CHUNK_KEY_HPP
+#define VOXEL_GAME_TERRAIN_CHUNK_KEY_HPP
+
+#include "morton.hpp"
+
+#include <beyond/math/vector.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Levels of detail 0 to max_chunk_lod_count - 1
+inline constexpr int max_chunk_lod_count = 4;
+
+// Faces of a chunk in the order -x, +x, -y, +y, -z, +z. Face `face` is
+// perpendicular to axis `face / 2`, on its positive side if `face` is odd
+inline constexpr int chunk_face_count = 6;
+
+// A chunk at a level of detail. Every chunk has the same number of cells, but
+// a chunk of level `lod` spans 2^lod chunks of level 0 along each axis. The
+// chunks of a level tile the world, and the chunk at `position` of level
+// `lod` covers the chunks from `2 * position` to `2 * position + 1` of level
+// `lod - 1`
+struct ChunkKey {
+  beyond::IVec3 position{};
+  int lod = 0;
+
+  friend auto operator==(const ChunkKey&, const ChunkKey&) -> bool = default;
+
+  // 2^lod
+  [[nodiscard]] constexpr auto scale() const -> int
+  {
+    return 1 << lod;
+  }
+
+  // The chunk of the same level across a face
+  [[nodiscard]] constexpr auto neighbor(int face) const -> ChunkKey
+  {
+    const int axis = face / 2;
+    const int step = face % 2 == 0 ? -1 : 1;
+    return ChunkKey{.position = {position.x + (axis == 0 ? step : 0),
+                                 position.y + (axis == 1 ? step : 0),
+                                 position.z + (axis == 2 ? step : 0)},
+                    .lod = lod};
+  }
+
+  // Child `index` of the eight chunks of level `lod - 1` that this one covers,
+  // whose bits 0, 1 and 2 are its offsets along x, y and z
+  [[nodiscard]] constexpr auto child(int index) const -> ChunkKey
+  {
+    return ChunkKey{.position = {2 * position.x + (index & 1),
+                                 2 * position.y + ((index >> 1) & 1),
+                                 2 * position.z + (index >> 2)},
+                    .lod = lod - 1};
+  }
+
+  // The chunk of level `lod + 1` that covers this one
+  [[nodiscard]] constexpr auto parent() const -> ChunkKey
+  {
+    return ChunkKey{.position = {position.x >> 1, position.y >> 1,
+                                 position.z >> 1},
+                    .lod = lod + 1};
+  }
+};
+
+// The level of detail goes above the Morton code of the position
+inline constexpr int chunk_key_lod_shift = 3 * morton_axis_bits;
+
+[[nodiscard]] constexpr auto chunk_key_encode(ChunkKey key) -> std::uint64_t
+{
+  return morton_encode(key.position) |
+         static_cast<std::uint64_t>(key.lod) << chunk_key_lod_shift;
+}
+
+[[nodiscard]] constexpr auto chunk_key_decode(std::uint64_t code) -> ChunkKey
+{
+  return ChunkKey{.position = morton_decode(code),
+                  .lod = static_cast<int>(code >> chunk_key_lod_shift)};
+}
+
+template <> struct std::hash<ChunkKey> {
+  [[nodiscard]] auto operator()(const ChunkKey& key) const noexcept
+      -> std::size_t
+  {
+    return std::hash<std::uint64_t>{}(chunk_key_encode(key));
+  }
+};
+
+#endif // VOXEL_GAME_TERRAIN_CHUNK_KEY_HPP
@@ -0,0 +1,110 @@
+#include "chunk_load_queue.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Keeps the heap ordered by increasing priority
+constexpr auto later = [](const auto& lhs, const auto& rhs) {
+  return lhs.priority > rhs.priority;
+};
+
+// About 10 degrees
+constexpr float refocus_min_cos = 0.985f;
+
+} // anonymous namespace
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration duration)
+{
+  const double ms =
+      std::chrono::duration<double, std::milli>(duration).count();
+  std::size_t bucket = 0;
+  while (bucket + 1 < bucket_count && ms >= bucket_upper_bound_ms(bucket)) {
+    ++bucket;
+  }
+  buckets_[bucket] += 1;
+  ++sample_count_;
+  total_ms_ += ms;
+}
+
+void LatencyHistogram::reset()
+{
+  *this = LatencyHistogram{};
+}
+
+auto LatencyHistogram::bucket_upper_bound_ms(std::size_t bucket) -> double
+{
+  if (bucket + 1 >= bucket_count) {
+    return std::numeric_limits<double>::infinity();
+  }
+  return std::ldexp(1.0, static_cast<int>(bucket));
+}
+
+void ChunkLoadQueue::set_focus(const ChunkLodLayout& layout,
+                               beyond::Vec3 view_direction)
+{
+  const float turn_cos = view_direction.x * view_direction_.x +
+                         view_direction.y * view_direction_.y +
+                         view_direction.z * view_direction_.z;
+  if (layout == layout_ && turn_cos >= refocus_min_cos) { return; }
+
+  layout_ = layout;
+  view_direction_ = view_direction;
+
+  const auto out_of_range =
+      std::ranges::partition(heap_, [this](const Entry& entry) {
+        return is_in_range(entry.request.key);
+      });
+  for (const Entry& entry : out_of_range) {
+    queued_keys_.erase(entry.request.key);
+  }
+  dropped_request_count_ += out_of_range.size();
+  heap_.erase(out_of_range.begin(), out_of_range.end());
+
+  for (Entry& entry : heap_) {
+    entry.priority = priority_of(entry.request.key);
+  }
+  std::ranges::make_heap(heap_, later);
+}
+
+void ChunkLoadQueue::push(ChunkKey key)
+{
+  if (!queued_keys_.insert(key).second) { return; }
+
+  heap_.push_back(
+      {.priority = priority_of(key),
+       .request = {.key = key,
+                   .enqueue_time = std::chrono::steady_clock::now()}});
+  std::ranges::push_heap(heap_, later);
+}
+
+auto ChunkLoadQueue::pop() -> std::optional<ChunkLoadRequest>
+{
+  if (heap_.empty()) { return std::nullopt; }
+
+  std::ranges::pop_heap(heap_, later);
+  const ChunkLoadRequest request = heap_.back().request;
+  heap_.pop_back();
+  queued_keys_.erase(request.key);
+  wait_times_.record(std::chrono::steady_clock::now() - request.enqueue_time);
+  return request;
+}
+
+auto ChunkLoadQueue::priority_of(ChunkKey key) const -> float
+{
+  const beyond::IVec3 center =
+      layout_.regions[static_cast<std::size_t>(key.lod)].center;
+  const auto dx = static_cast<float>(key.position.x - center.x);
+  const auto dy = static_cast<float>(key.position.y - center.y);
+  const auto dz = static_cast<float>(key.position.z - center.z);
+  const float distance_squared = dx * dx + dy * dy + dz * dz;
+  if (distance_squared == 0) { return 0; }
+
+  // 0.5 straight ahead, 2 straight behind
+  const float view_cos = (dx * view_direction_.x + dy * view_direction_.y +
+                          dz * view_direction_.z) /
+                         std::sqrt(distance_squared);
+  return distance_squared * (1.25f - 0.75f * view_cos);
+}
@@ -0,0 +1,121 @@
+#ifndef VOXEL_GAME_TERRAIN_CHUNK_LOAD_QUEUE_HPP
+#define VOXEL_GAME_TERRAIN_CHUNK_LOAD_QUEUE_HPP
+
+#include "chunk_key.hpp"
+#include "chunk_lod_layout.hpp"
+
+#include <beyond/math/vector.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+// Counts durations in power-of-two millisecond buckets: [0, 1), [1, 2),
+// [2, 4), ..., with the last bucket open-ended
+class LatencyHistogram {
+public:
+  static constexpr std::size_t bucket_count = 12;
+
+private:
+  std::array<float, bucket_count> buckets_{}; // float to plot them with ImGui
+  std::uint64_t sample_count_ = 0;
+  double total_ms_ = 0;
+
+public:
+  void record(std::chrono::steady_clock::duration duration);
+  void reset();
+
+  [[nodiscard]] auto buckets() const -> const std::array<float, bucket_count>&
+  {
+    return buckets_;
+  }
+  [[nodiscard]] auto sample_count() const -> std::uint64_t
+  {
+    return sample_count_;
+  }
+  [[nodiscard]] auto mean_ms() const -> double
+  {
+    return sample_count_ == 0 ? 0
+                              : total_ms_ / static_cast<double>(sample_count_);
+  }
+  // Exclusive upper bound of a bucket, infinite for the last one
+  [[nodiscard]] static auto bucket_upper_bound_ms(std::size_t bucket) -> double;
+};
+
+struct ChunkLoadRequest {
+  ChunkKey key;
+  std::chrono::steady_clock::time_point enqueue_time{};
+};
+
+// Chunks waiting to be meshed, nearest to the camera first, with distances in
+// chunks of their own level so that every level fills in from the camera
+// outwards at the same pace. Chunks in front of the camera count as up to
+// twice closer and chunks behind it as up to twice further. Requests for
+// chunks that the layout stops drawing are dropped
+class ChunkLoadQueue {
+  struct Entry {
+    float priority = 0; // Lower is sooner
+    ChunkLoadRequest request;
+  };
+
+  std::vector<Entry> heap_; // Min-heap on priority
+  std::unordered_set<ChunkKey> queued_keys_;
+  ChunkLodLayout layout_;
+  beyond::Vec3 view_direction_{0, 0, -1};
+  std::uint64_t dropped_request_count_ = 0;
+  LatencyHistogram wait_times_; // From push to pop
+
+public:
+  // Moves the camera, whose chunks are the centers of the regions of the
+  // layout. The queue is re-prioritized only when the layout changes or the
+  // camera turns noticeably, which also drops the requests that are now out of
+  // the layout
+  void set_focus(const ChunkLodLayout& layout, beyond::Vec3 view_direction);
+
+  // No-op if the chunk is already queued
+  void push(ChunkKey key);
+  [[nodiscard]] auto pop() -> std::optional<ChunkLoadRequest>;
+
+  [[nodiscard]] auto contains(ChunkKey key) const -> bool
+  {
+    return queued_keys_.contains(key);
+  }
+  [[nodiscard]] auto is_in_range(ChunkKey key) const -> bool
+  {
+    return layout_.contains(key);
+  }
+
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return heap_.size();
+  }
+  [[nodiscard]] auto empty() const -> bool
+  {
+    return heap_.empty();
+  }
+  [[nodiscard]] auto layout() const -> const ChunkLodLayout&
+  {
+    return layout_;
+  }
+  [[nodiscard]] auto dropped_request_count() const -> std::uint64_t
+  {
+    return dropped_request_count_;
+  }
+  [[nodiscard]] auto wait_times() const -> const LatencyHistogram&
+  {
+    return wait_times_;
+  }
+  void reset_wait_times()
+  {
+    wait_times_.reset();
+  }
+
+private:
+  [[nodiscard]] auto priority_of(ChunkKey key) const -> float;
+};
+
+#endif // VOXEL_GAME_TERRAIN_CHUNK_LOAD_QUEUE_HPP
@@ -0,0 +1,77 @@
+#include "chunk_lod_layout.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Of the chunks from `first` to `first + count - 1` along an axis, the nearest
+// to `center`
+[[nodiscard]] auto nearest_to(int center, int first, int count) -> int
+{
+  return std::clamp(center, first, first + count - 1);
+}
+
+} // anonymous namespace
+
+auto ChunkLodLayout::is_member(ChunkKey key) const -> bool
+{
+  if (key.lod < 0 || key.lod >= lod_count) { return false; }
+  if (key.lod == top_lod()) {
+    return regions[static_cast<std::size_t>(key.lod)].contains(key.position);
+  }
+  const ChunkKey parent = key.parent();
+  return is_member(parent) && is_subdivided_member(parent);
+}
+
+auto ChunkLodLayout::is_subdivided_member(ChunkKey key) const -> bool
+{
+  if (key.lod == 0) { return false; }
+  // Every shape only shrinks away from its center along each axis, so the
+  // region contains a child if it contains the child nearest to its center
+  const ChunkRegion& below = regions[static_cast<std::size_t>(key.lod - 1)];
+  return below.contains({nearest_to(below.center.x, 2 * key.position.x, 2),
+                         nearest_to(below.center.y, 2 * key.position.y, 2),
+                         nearest_to(below.center.z, 2 * key.position.z, 2)});
+}
+
+auto ChunkLodLayout::covers(ChunkKey key) const -> bool
+{
+  if (lod_count == 0 || key.lod < 0) { return false; }
+
+  // The drawn chunks cover the region of the top level
+  const ChunkRegion& top = regions[static_cast<std::size_t>(top_lod())];
+  if (key.lod <= top_lod()) {
+    const int shift = top_lod() - key.lod;
+    return top.contains({key.position.x >> shift, key.position.y >> shift,
+                         key.position.z >> shift});
+  }
+  const int shift = key.lod - top_lod();
+  const int count = 1 << shift;
+  return top.contains(
+      {nearest_to(top.center.x, key.position.x << shift, count),
+       nearest_to(top.center.y, key.position.y << shift, count),
+       nearest_to(top.center.z, key.position.z << shift, count)});
+}
+
+auto ChunkLodLayout::transition_faces(ChunkKey key) const -> std::uint32_t
+{
+  std::uint32_t faces = 0;
+  for (int face = 0; face < chunk_face_count; ++face) {
+    if (contains(key.neighbor(face).parent())) { faces |= 1u << face; }
+  }
+  return faces;
+}
+
+auto ChunkLodLayout::chunk_count(int lod) const -> std::size_t
+{
+  std::size_t count = 0;
+  for_each_chunk(lod, [&count](ChunkKey) { ++count; });
+  return count;
+}
+
+auto ChunkLodLayout::chunk_count() const -> std::size_t
+{
+  std::size_t count = 0;
+  for (int lod = 0; lod < lod_count; ++lod) { count += chunk_count(lod); }
+  return count;
+}
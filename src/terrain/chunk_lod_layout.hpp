@@ -0,0 +1,130 @@
+#ifndef VOXEL_GAME_TERRAIN_CHUNK_LOD_LAYOUT_HPP
+#define VOXEL_GAME_TERRAIN_CHUNK_LOD_LAYOUT_HPP
+
+#include "chunk_key.hpp"
+#include "chunk_region.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Clipmap of the levels of detail around the camera. Each level has a region,
+// in chunks of that level, around the chunk of the camera. The chunks in the
+// region of the top level are drawn unless they are subdivided, which they are
+// if one of their children is in the region of the level below, and so on down
+// to level 0. Every chunk of the region of a level is thus drawn at that level
+// of detail or finer, and drawn chunks neither overlap nor leave holes
+struct ChunkLodLayout {
+  std::array<ChunkRegion, max_chunk_lod_count> regions{};
+  int lod_count = 0; // Empty if 0
+
+  friend auto operator==(const ChunkLodLayout&, const ChunkLodLayout&)
+      -> bool = default;
+
+  [[nodiscard]] auto top_lod() const -> int
+  {
+    return lod_count - 1;
+  }
+
+  // Whether the chunk is drawn
+  [[nodiscard]] auto contains(ChunkKey key) const -> bool
+  {
+    return is_member(key) && !is_subdivided_member(key);
+  }
+  // Whether the chunk overlaps any drawn chunk, of any level
+  [[nodiscard]] auto covers(ChunkKey key) const -> bool;
+  // Faces of a drawn chunk across which a chunk of the level above is drawn,
+  // as bits `1 << face`. They need transition cells to meet the coarser mesh
+  // without cracks
+  [[nodiscard]] auto transition_faces(ChunkKey key) const -> std::uint32_t;
+
+  [[nodiscard]] auto chunk_count(int lod) const -> std::size_t;
+  [[nodiscard]] auto chunk_count() const -> std::size_t;
+
+  // Calls `function(key)` for each drawn chunk of the level
+  template <typename Function>
+  void for_each_chunk(int lod, Function&& function) const
+  {
+    if (lod < 0 || lod >= lod_count) { return; }
+    const ChunkRegion& top = regions[static_cast<std::size_t>(top_lod())];
+    for (int x = top.center.x - top.radius; x <= top.center.x + top.radius;
+         ++x) {
+      for (int y = top.center.y - top.vertical_radius;
+           y <= top.center.y + top.vertical_radius; ++y) {
+        const ChunkSpan span = top.column(x, y);
+        for (int z = span.first; z <= span.last; ++z) {
+          visit_members(ChunkKey{.position = {x, y, z}, .lod = top_lod()}, lod,
+                        function);
+        }
+      }
+    }
+  }
+
+private:
+  // Whether the chunk is drawn or subdivided
+  [[nodiscard]] auto is_member(ChunkKey key) const -> bool;
+  // Whether a chunk that is drawn or subdivided is subdivided
+  [[nodiscard]] auto is_subdivided_member(ChunkKey key) const -> bool;
+
+  // Walks down from a member to the drawn chunks of the level
+  template <typename Function>
+  void visit_members(ChunkKey key, int lod, Function& function) const
+  {
+    const bool is_subdivided = is_subdivided_member(key);
+    if (key.lod == lod) {
+      if (!is_subdivided) { function(key); }
+      return;
+    }
+    if (!is_subdivided) { return; }
+    for (int i = 0; i < 8; ++i) { visit_members(key.child(i), lod, function); }
+  }
+};
+
+// Calls `function(key)` for each chunk drawn by `layout` but not by
+// `excluded`. Levels whose drawn chunks cannot differ are skipped, and when
+// only the region of the top level moved, only the columns of the difference
+// of the regions are walked
+template <typename Function>
+void for_each_chunk_in_difference(const ChunkLodLayout& layout,
+                                  const ChunkLodLayout& excluded,
+                                  Function&& function)
+{
+  const auto visit_if_excluded_does_not_draw = [&](ChunkKey key) {
+    if (!excluded.contains(key)) { function(key); }
+  };
+
+  const auto same_region = [&](int lod) {
+    const auto index = static_cast<std::size_t>(lod);
+    return lod < 0 || layout.regions[index] == excluded.regions[index];
+  };
+
+  for (int lod = 0; lod < layout.lod_count; ++lod) {
+    // The drawn chunks of a level depend on the regions from the level below
+    // it up to the top
+    bool same_other_regions =
+        layout.lod_count == excluded.lod_count && same_region(lod - 1);
+    for (int level = lod + 1; level < layout.lod_count; ++level) {
+      same_other_regions = same_other_regions && same_region(level);
+    }
+
+    if (!same_other_regions) {
+      layout.for_each_chunk(lod, visit_if_excluded_does_not_draw);
+    } else if (same_region(lod)) {
+      continue;
+    } else if (lod != layout.top_lod()) {
+      // Which chunks of the level above are subdivided changed too
+      layout.for_each_chunk(lod, visit_if_excluded_does_not_draw);
+    } else {
+      // Which chunks of the top level are subdivided did not change
+      const auto index = static_cast<std::size_t>(lod);
+      for_each_chunk_in_difference(
+          layout.regions[index], excluded.regions[index],
+          [&](beyond::IVec3 position) {
+            const ChunkKey key{.position = position, .lod = lod};
+            if (layout.contains(key)) { visit_if_excluded_does_not_draw(key); }
+          });
+    }
+  }
+}
+
+#endif // VOXEL_GAME_TERRAIN_CHUNK_LOD_LAYOUT_HPP
@@ -3,38 +3,223 @@
 
 #include "../vertex.hpp"
 #include "../vulkan_helpers/commands.hpp"
+#include "../vulkan_helpers/compute_pipeline.hpp"
 #include "../vulkan_helpers/debug_utils.hpp"
 #include "../vulkan_helpers/descriptor_pool.hpp"
-#include "../vulkan_helpers/shader_module.hpp"
+#include "../vulkan_helpers/query_pool.hpp"
 #include "../vulkan_helpers/sync.hpp"
 
-#include <beyond/coroutine/generator.hpp>
 #include <beyond/math/serial.hpp>
 #include <beyond/utils/size.hpp>
 #include <beyond/utils/to_pointer.hpp>
 
 #include <imgui.h>
 
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
 namespace {
 
-struct TerrainReducedBuffer {
-  uint32_t vertex_count = 0;
+constexpr std::uint32_t meshing_local_size = 4;
+// Cells one past the max faces of a chunk own the vertices of its boundary
+// edges, see terrain_common.glsl
+constexpr std::uint32_t owner_cells_per_axis = ChunkManager::chunk_dimension + 1;
+static_assert(ChunkDensityField::chunk_dimension ==
+              ChunkManager::chunk_dimension);
+constexpr std::uint32_t owner_cells_per_chunk =
+    owner_cells_per_axis * owner_cells_per_axis * owner_cells_per_axis;
+constexpr std::uint32_t meshing_workgroups_per_chunk_axis =
+    (owner_cells_per_axis + meshing_local_size - 1) / meshing_local_size;
+// Corners of the owner cells plus one point of halo on each side, see
+// terrain_common.glsl
+constexpr std::uint32_t density_points_per_axis = owner_cells_per_axis + 3;
+constexpr std::uint32_t density_points_per_chunk =
+    density_points_per_axis * density_points_per_axis * density_points_per_axis;
+// The density and the cell passes share the dispatch size
+static_assert(meshing_workgroups_per_chunk_axis * meshing_local_size ==
+              density_points_per_axis);
+
+// Measured on the generated terrain with the default view settings, where about
+// one chunk of the layout in six has a mesh. Filling the draw buffers with
+// such chunks fits in the heaps
+constexpr std::uint32_t mean_vertices_per_layout_chunk = 211;
+constexpr std::uint32_t mean_indices_per_layout_chunk = 1180;
+static_assert(ChunkManager::max_draw_count * mean_vertices_per_layout_chunk <=
+              ChunkManager::vertex_heap_capacity);
+static_assert(ChunkManager::max_draw_count * mean_indices_per_layout_chunk <=
+              ChunkManager::index_heap_capacity);
+
+// Needs to match skipped_chunk in terrain_meshing.comp.glsl
+constexpr std::uint32_t skipped_chunk_first_vertex = ~0u;
+
+// Vertex and index counts or offsets, matches an uvec2 in the shaders
+struct VertexIndexPair {
+  std::uint32_t vertex = 0;
+  std::uint32_t index = 0;
 };
+static_assert(sizeof(VertexIndexPair) == 2 * sizeof(std::uint32_t));
+
+// Timestamps written by each meshing job. The first four are written by the
+// counting submission, the last two by the emitting one
+enum MeshingTimestamp : std::uint32_t {
+  density_begin_timestamp,
+  density_end_timestamp,
+  count_end_timestamp,
+  scan_end_timestamp,
+  emit_begin_timestamp,
+  emit_end_timestamp,
+  meshing_timestamp_count,
+};
+
+// No-op if the compute queue does not support timestamps, in which case the
+// jobs have no query pool
+void write_timestamp(VkCommandBuffer command_buffer, VkQueryPool query_pool,
+                     MeshingTimestamp timestamp)
+{
+  if (query_pool == VK_NULL_HANDLE) { return; }
+  vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                      query_pool, timestamp);
+}
+
+void compute_to_compute_barrier(VkCommandBuffer command_buffer)
+{
+  static constexpr VkMemoryBarrier barrier{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+                       nullptr, 0, nullptr);
+}
+
+// Remeshes the dirty bricks of an edited chunk when `meshed` has a layout to
+// patch, or else meshes it whole, in bricks if it has no transition faces
+void mesh_edited_chunk(const TerrainEdits& edits, MeshBrickMask dirty_bricks,
+                       CpuMeshedChunk& meshed)
+{
+  const ChunkKey chunk = meshed.key;
+  if (meshed.patched_layout != nullptr) {
+    ChunkDensityField field;
+    generate_brick_densities(chunk, dirty_bricks, field);
+    edits.add_deltas(chunk, field);
+    meshed.patch = patch_bricks(field, *meshed.patched_layout, dirty_bricks);
+    if (meshed.patch) {
+      meshed.brick_layout =
+          std::make_shared<const BrickedMeshLayout>(meshed.patch->layout);
+      return;
+    }
+    meshed.patched_layout = nullptr;
+  }
+
+  ChunkDensityField field = generate_density_field(chunk);
+  edits.add_deltas(chunk, field);
+  if (meshed.transition_faces != 0) {
+    meshed.mesh = mesh_density_field(field, meshed.transition_faces);
+    return;
+  }
+  BrickedMesh bricked = mesh_in_bricks(field);
+  meshed.mesh = std::move(bricked.mesh);
+  meshed.brick_layout =
+      std::make_shared<const BrickedMeshLayout>(bricked.layout);
+}
+
+// Upper bound of the chunks drawn with the settings. Those of a level below the
+// top are children of the subdivided chunks of the level above, so they lie
+// within one chunk along each axis, and two chunks of the radii whatever the
+// shape, of the region of their level
+[[nodiscard]] auto max_drawn_chunk_count(const ChunkViewSettings& settings)
+    -> std::size_t
+{
+  const auto region_chunk_count = [&](int margin) {
+    return ChunkRegion{
+        .radius = settings.view_distance + margin,
+        .vertical_radius = settings.vertical_view_distance + margin,
+        .shape = settings.load_shape}
+        .chunk_count();
+  };
+  return region_chunk_count(0) +
+         static_cast<std::size_t>(settings.lod_count - 1) *
+             region_chunk_count(2);
+}
 
 } // anonymous namespace
 
-ChunkManager::ChunkManager(vkh::Context& context)
+ChunkManager::ChunkManager(vkh::Context& context,
+                           std::uint32_t frames_in_flight,
+                           const ChunkViewSettings& view_settings,
+                           const std::filesystem::path& chunk_store_directory)
     : context_{context},
       edge_table_buffer_{generate_edge_table_buffer(context).value()},
       triangle_table_buffer_{generate_triangle_table_buffer(context).value()},
-      vertex_caches_(context.allocator())
+      vertex_heap_buffer_{
+          vkh::create_buffer(
+              context, {.size = sizeof(Vertex) * vertex_heap_capacity,
+                        .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                 VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                        .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
+                        .debug_name = "Terrain Vertex Heap"})
+              .value()},
+      index_heap_buffer_{
+          vkh::create_buffer(
+              context,
+              {.size = sizeof(std::uint32_t) * index_heap_capacity,
+               .usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+               .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
+               .debug_name = "Terrain Index Heap"})
+              .value()},
+      vertex_heap_{vertex_heap_capacity}, index_heap_{index_heap_capacity}
 {
+  set_view_settings(view_settings);
+  if (!chunk_store_directory.empty()) {
+    chunk_store_ = std::make_unique<ChunkStore>(chunk_store_directory);
+  }
+
+  draw_frames_.resize(frames_in_flight);
+  for (std::size_t i = 0; i < draw_frames_.size(); ++i) {
+    ChunkDrawFrame& frame = draw_frames_[i];
+    frame.command_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(VkDrawIndexedIndirectCommand) * max_draw_count,
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+             .debug_name =
+                 fmt::format("Terrain Draw Command Buffer ({})", i).c_str()})
+            .value();
+    frame.transform_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(beyond::Vec4) * max_draw_count,
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+             .debug_name =
+                 fmt::format("Terrain Draw Transform Buffer ({})", i).c_str()})
+            .value();
+    frame.commands =
+        context_.map<VkDrawIndexedIndirectCommand>(frame.command_buffer)
+            .value();
+    frame.transforms =
+        context_.map<beyond::Vec4>(frame.transform_buffer).value();
+  }
+
   const VkDescriptorPoolSize pool_sizes[] = {
-      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4}};
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 10 * max_meshing_jobs_in_flight}};
 
   descriptor_pool_ =
       vkh::create_descriptor_pool(
-          context_, {.max_sets = 1,
+          context_, {.max_sets = max_meshing_jobs_in_flight,
                      .pool_sizes = pool_sizes,
                      .debug_name = "Terrain Chunk Descriptor Pool"})
           .value();
@@ -48,6 +233,18 @@ ChunkManager::ChunkManager(vkh::Context& context)
           {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
            nullptr},
           {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+           nullptr},
+          {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+           nullptr},
+          {5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+           nullptr},
+          {6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+           nullptr},
+          {7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+           nullptr},
+          {8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
+           nullptr},
+          {9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT,
            nullptr}};
 
   static constexpr VkDescriptorSetLayoutCreateInfo
@@ -60,339 +257,2026 @@ ChunkManager::ChunkManager(vkh::Context& context)
                               &descriptor_set_layout_create_info, nullptr,
                               &descriptor_set_layout_);
 
-  const VkDescriptorSetAllocateInfo descriptor_set_allocate_info = {
-      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-      .descriptorPool = descriptor_pool_,
-      .descriptorSetCount = 1,
-      .pSetLayouts = &descriptor_set_layout_,
-  };
-  descriptor_set = {};
-  VK_CHECK(vkAllocateDescriptorSets(
-      context_.device(), &descriptor_set_allocate_info, &descriptor_set));
-
-  const VkPushConstantRange push_constant_range{
-      .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
-      .offset = 0,
-      .size = sizeof(beyond::Vec4),
-  };
-
   const VkPipelineLayoutCreateInfo pipeline_layout_create_info = {
       .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
       .setLayoutCount = 1,
       .pSetLayouts = &descriptor_set_layout_,
-      .pushConstantRangeCount = 1,
-      .pPushConstantRanges = &push_constant_range,
   };
   vkCreatePipelineLayout(context_.device(), &pipeline_layout_create_info,
                          nullptr, &meshing_pipeline_layout_);
 
-  VkShaderModule meshing_shader_module =
-      vkh::load_shader_module_from_file(
-          context_, "shaders/terrain_meshing.comp.spv",
-          {.debug_name = "Terrain Meshing Compute Shader"})
-          .expect("Cannot load terrain_meshing.comp.spv");
-
-  const VkComputePipelineCreateInfo meshing_pipeline_create_info{
-      .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-      .stage =
-          VkPipelineShaderStageCreateInfo{
-              .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-              .stage = VK_SHADER_STAGE_COMPUTE_BIT,
-              .module = meshing_shader_module,
-              .pName = "main",
-          },
-      .layout = meshing_pipeline_layout_,
-  };
-  VK_CHECK(vkCreateComputePipelines(context_.device(), {}, 1,
-                                    &meshing_pipeline_create_info, nullptr,
-                                    &meshing_pipeline_));
-  VK_CHECK(vkh::set_debug_name(
-      context_, beyond::bit_cast<uint64_t>(meshing_pipeline_),
-      VK_OBJECT_TYPE_PIPELINE, "Terrian Meshing Pipeline"));
-
-  vkDestroyShaderModule(context_.device(), meshing_shader_module, nullptr);
+  density_pipeline_ =
+      vkh::create_compute_pipeline(
+          context_, {.pipeline_layout = meshing_pipeline_layout_,
+                     .shader_filename = "shaders/terrain_density.comp.spv",
+                     .debug_name = "Terrain Density Pipeline"})
+          .value();
+  count_pipeline_ =
+      vkh::create_compute_pipeline(
+          context_, {.pipeline_layout = meshing_pipeline_layout_,
+                     .shader_filename = "shaders/terrain_count.comp.spv",
+                     .debug_name = "Terrain Vertex Count Pipeline"})
+          .value();
+  scan_pipeline_ =
+      vkh::create_compute_pipeline(
+          context_, {.pipeline_layout = meshing_pipeline_layout_,
+                     .shader_filename = "shaders/terrain_scan.comp.spv",
+                     .debug_name = "Terrain Vertex Offset Scan Pipeline"})
+          .value();
+  meshing_pipeline_ =
+      vkh::create_compute_pipeline(
+          context_, {.pipeline_layout = meshing_pipeline_layout_,
+                     .shader_filename = "shaders/terrain_meshing.comp.spv",
+                     .debug_name = "Terrian Meshing Pipeline"})
+          .value();
 
   const VkCommandPoolCreateInfo compute_command_pool_create_info{
       .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+      .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
       .queueFamilyIndex = context_.compute_queue_family_index()};
   VK_CHECK(vkCreateCommandPool(context_.device(),
                                &compute_command_pool_create_info, nullptr,
                                &meshing_command_pool_));
-  meshing_fence_ =
-      vkh::create_fence(context_, {.debug_name = "Meshing Fence"}).value();
-
-  constexpr size_t max_triangles_per_cell = 5;
-  constexpr size_t vertices_per_triangle = 3;
-  constexpr size_t max_vertex_count = max_triangles_per_cell *
-                                      vertices_per_triangle * chunk_dimension *
-                                      chunk_dimension * chunk_dimension;
-  constexpr size_t vertex_buffer_size = sizeof(Vertex) * max_vertex_count;
-
-  terrain_reduced_scratch_buffer_ =
-      vkh::create_buffer_from_data(
-          context_,
-          {.size = sizeof(std::uint32_t),
-           .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-           .memory_usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
-           .debug_name = "Terrain Reduced Scratch Buffer"},
-          TerrainReducedBuffer{})
-          .value();
 
-  terrain_vertex_scratch_buffer_ =
-      vkh::create_buffer(context_,
-                         {.size = vertex_buffer_size,
-                          .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
-                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
-                          .debug_name = "Terrain Vertex Scratch Buffer"})
-          .value();
+  std::uint32_t queue_family_count = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(context_.physical_device(),
+                                           &queue_family_count, nullptr);
+  std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+  vkGetPhysicalDeviceQueueFamilyProperties(
+      context_.physical_device(), &queue_family_count, queue_families.data());
+  if (queue_families[context_.compute_queue_family_index()]
+          .timestampValidBits != 0) {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(context_.physical_device(), &properties);
+    timestamp_period_ns_ = properties.limits.timestampPeriod;
+  }
+
+  create_meshing_jobs(meshing_jobs_in_flight_, meshing_batch_size_);
+  create_cpu_mesh_upload();
+  last_throughput_sample_time_ = std::chrono::steady_clock::now();
 }
 
 ChunkManager::~ChunkManager()
 {
-  vkDestroyFence(context_.device(), meshing_fence_, nullptr);
+  wait_for_meshing_jobs();
+  destroy_meshing_jobs();
+
+  for (auto& [position, task] : cpu_meshing_in_flight_) {
+    task.cancellation.cancel();
+  }
+  thread_pool_.wait_idle();
+  if (cpu_mesh_upload_.in_flight) {
+    VK_CHECK(vkWaitForFences(context_.device(), 1, &cpu_mesh_upload_.fence,
+                             true, UINT64_MAX));
+  }
+  destroy_cpu_mesh_upload();
+
   vkDestroyCommandPool(context_.device(), meshing_command_pool_, nullptr);
   vkDestroyPipeline(context_.device(), meshing_pipeline_, nullptr);
+  vkDestroyPipeline(context_.device(), scan_pipeline_, nullptr);
+  vkDestroyPipeline(context_.device(), count_pipeline_, nullptr);
+  vkDestroyPipeline(context_.device(), density_pipeline_, nullptr);
   vkDestroyPipelineLayout(context_.device(), meshing_pipeline_layout_, nullptr);
   vkDestroyDescriptorSetLayout(context_.device(), descriptor_set_layout_,
                                nullptr);
   vkDestroyDescriptorPool(context_.device(), descriptor_pool_, nullptr);
 
-  for (auto cache : vertex_caches_.vertex_cache_pool) {
-    if (cache.vertex_count == 0) { continue; }
-    vkh::destroy_buffer(context_, cache.vertex_buffer);
+  for (ChunkDrawFrame& frame : draw_frames_) {
+    context_.unmap(frame.transform_buffer);
+    context_.unmap(frame.command_buffer);
+    vkh::destroy_buffer(context_, frame.transform_buffer);
+    vkh::destroy_buffer(context_, frame.command_buffer);
   }
-
-  vkh::destroy_buffer(context_, terrain_reduced_scratch_buffer_);
-  vkh::destroy_buffer(context_, terrain_vertex_scratch_buffer_);
+  vkh::destroy_buffer(context_, index_heap_buffer_);
+  vkh::destroy_buffer(context_, vertex_heap_buffer_);
   vkh::destroy_buffer(context_, triangle_table_buffer_);
   vkh::destroy_buffer(context_, edge_table_buffer_);
 }
 
-[[nodiscard]] auto
-ChunkManager::calculate_chunk_transform(beyond::IVec3 position) -> beyond::Vec4
+[[nodiscard]] auto ChunkManager::calculate_chunk_transform(ChunkKey chunk)
+    -> beyond::Vec4
+{
+  const int scale = chunk.scale();
+  const auto center = [scale](int chunk_coordinate) {
+    return static_cast<float>(chunk_origin(chunk_coordinate, scale) +
+                              chunk_dimension * scale / 2);
+  };
+  return beyond::Vec4{center(chunk.position.x), center(chunk.position.y),
+                      center(chunk.position.z), static_cast<float>(scale)};
+}
+
+void ChunkManager::create_meshing_jobs(int count, int batch_size)
+{
+  BEYOND_ENSURE(count > 0 && count <= max_meshing_jobs_in_flight);
+  BEYOND_ENSURE(batch_size > 0 && batch_size <= max_meshing_batch_size);
+
+  const auto batch_count = static_cast<std::size_t>(batch_size);
+
+  meshing_jobs_.resize(static_cast<std::size_t>(count));
+  for (std::size_t i = 0; i < meshing_jobs_.size(); ++i) {
+    MeshingJob& job = meshing_jobs_[i];
+    job.chunks.reserve(batch_count);
+    job.results.reserve(batch_count);
+
+    job.chunk_transform_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(beyond::Vec4) * batch_count,
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+             .debug_name =
+                 fmt::format("Terrain Chunk Transform Buffer ({})", i).c_str()})
+            .value();
+
+    job.density_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(float) * density_points_per_chunk * batch_count,
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
+             .debug_name =
+                 fmt::format("Terrain Density Buffer ({})", i).c_str()})
+            .value();
+
+    job.reduced_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(VertexIndexPair) * batch_count,
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_GPU_TO_CPU,
+             .debug_name =
+                 fmt::format("Terrain Reduced Scratch Buffer ({})", i).c_str()})
+            .value();
+
+    job.heap_offset_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(VertexIndexPair) * batch_count,
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+             .debug_name =
+                 fmt::format("Terrain Heap Offset Buffer ({})", i).c_str()})
+            .value();
+
+    job.cell_offset_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(VertexIndexPair) * owner_cells_per_chunk *
+                     batch_count,
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
+             .debug_name =
+                 fmt::format("Terrain Cell Offset Buffer ({})", i).c_str()})
+            .value();
+
+    job.cell_edge_mask_buffer =
+        vkh::create_buffer(
+            context_,
+            {.size = sizeof(std::uint32_t) * owner_cells_per_chunk * batch_count,
+             .usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+             .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
+             .debug_name =
+                 fmt::format("Terrain Cell Edge Mask Buffer ({})", i).c_str()})
+            .value();
+
+    job.command_buffer =
+        vkh::allocate_command_buffer(
+            context_,
+            {.command_pool = meshing_command_pool_,
+             .debug_name =
+                 fmt::format("Meshing Command Buffer ({})", i).c_str()})
+            .value();
+
+    job.fence = vkh::create_fence(
+                    context_,
+                    {.debug_name = fmt::format("Meshing Fence ({})", i).c_str()})
+                    .value();
+
+    if (timestamp_period_ns_ != 0) {
+      job.timestamp_query_pool =
+          vkh::create_query_pool(
+              context_,
+              {.query_type = VK_QUERY_TYPE_TIMESTAMP,
+               .query_count = meshing_timestamp_count,
+               .debug_name =
+                   fmt::format("Meshing Timestamp Query Pool ({})", i).c_str()})
+              .value();
+    }
+
+    const VkDescriptorSetAllocateInfo descriptor_set_allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = descriptor_pool_,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &descriptor_set_layout_,
+    };
+    VK_CHECK(vkAllocateDescriptorSets(context_.device(),
+                                      &descriptor_set_allocate_info,
+                                      &job.descriptor_set));
+
+    const VkDescriptorBufferInfo reduced_descriptor_buffer_info = {
+        job.reduced_buffer, 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo vertex_heap_descriptor_buffer_info = {
+        vertex_heap_buffer_, 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo edge_table_descriptor_buffer_info = {
+        edge_table_buffer_, 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo tri_table_descriptor_buffer_info = {
+        triangle_table_buffer_, 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo chunk_transform_descriptor_buffer_info = {
+        job.chunk_transform_buffer, 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo cell_offset_descriptor_buffer_info = {
+        job.cell_offset_buffer, 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo heap_offset_descriptor_buffer_info = {
+        job.heap_offset_buffer, 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo cell_edge_mask_descriptor_buffer_info = {
+        job.cell_edge_mask_buffer, 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo index_heap_descriptor_buffer_info = {
+        index_heap_buffer_, 0, VK_WHOLE_SIZE};
+    const VkDescriptorBufferInfo density_descriptor_buffer_info = {
+        job.density_buffer, 0, VK_WHOLE_SIZE};
+
+    const VkWriteDescriptorSet write_descriptor_set[] = {
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 0,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &reduced_descriptor_buffer_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 1,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &vertex_heap_descriptor_buffer_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 2,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &edge_table_descriptor_buffer_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 3,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &tri_table_descriptor_buffer_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 4,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &chunk_transform_descriptor_buffer_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 5,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &cell_offset_descriptor_buffer_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 6,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &heap_offset_descriptor_buffer_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 7,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &cell_edge_mask_descriptor_buffer_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 8,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &index_heap_descriptor_buffer_info, nullptr},
+        {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, job.descriptor_set, 9,
+         0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
+         &density_descriptor_buffer_info, nullptr}};
+    vkUpdateDescriptorSets(
+        context_.device(), beyond::size(write_descriptor_set),
+        beyond::to_pointer(write_descriptor_set), 0, nullptr);
+  }
+}
+
+void ChunkManager::destroy_meshing_jobs()
+{
+  for (MeshingJob& job : meshing_jobs_) {
+    BEYOND_ENSURE(job.stage == MeshingJob::Stage::idle);
+    vkDestroyQueryPool(context_.device(), job.timestamp_query_pool, nullptr);
+    vkDestroyFence(context_.device(), job.fence, nullptr);
+    vkFreeCommandBuffers(context_.device(), meshing_command_pool_, 1,
+                         &job.command_buffer);
+    vkh::destroy_buffer(context_, job.readback_buffer);
+    vkh::destroy_buffer(context_, job.cell_edge_mask_buffer);
+    vkh::destroy_buffer(context_, job.cell_offset_buffer);
+    vkh::destroy_buffer(context_, job.heap_offset_buffer);
+    vkh::destroy_buffer(context_, job.reduced_buffer);
+    vkh::destroy_buffer(context_, job.density_buffer);
+    vkh::destroy_buffer(context_, job.chunk_transform_buffer);
+  }
+  meshing_jobs_.clear();
+  VK_CHECK(vkResetDescriptorPool(context_.device(), descriptor_pool_, 0));
+}
+
+void ChunkManager::wait_for_meshing_jobs()
 {
-  const auto chunk_x = static_cast<float>(chunk_dimension * position.x);
-  const auto chunk_y = static_cast<float>(chunk_dimension * position.y);
-  const auto chunk_z = static_cast<float>(chunk_dimension * position.z);
+  while (wait_for_any_meshing_job()) {}
+}
 
-  return beyond::Vec4{chunk_x, chunk_y, chunk_z, 1.f};
+auto ChunkManager::wait_for_any_meshing_job() -> bool
+{
+  std::vector<VkFence> pending_fences;
+  pending_fences.reserve(meshing_jobs_.size());
+  for (const MeshingJob& job : meshing_jobs_) {
+    if (job.stage != MeshingJob::Stage::idle) {
+      pending_fences.push_back(job.fence);
+    }
+  }
+  if (pending_fences.empty()) { return false; }
+
+  VK_CHECK(vkWaitForFences(context_.device(),
+                           static_cast<std::uint32_t>(pending_fences.size()),
+                           pending_fences.data(), false, UINT64_MAX));
+  poll_meshing_jobs();
+  return true;
 }
 
-void ChunkManager::update_write_descriptor_set()
+void ChunkManager::set_meshing_jobs_in_flight(int jobs_in_flight)
 {
-  const VkDescriptorBufferInfo indirect_descriptor_buffer_info = {
-      terrain_reduced_scratch_buffer_, 0, VK_WHOLE_SIZE};
-  const VkDescriptorBufferInfo out_descriptor_buffer_info = {
-      terrain_vertex_scratch_buffer_, 0, VK_WHOLE_SIZE};
-  const VkDescriptorBufferInfo edge_table_descriptor_buffer_info = {
-      edge_table_buffer_, 0, VK_WHOLE_SIZE};
-  const VkDescriptorBufferInfo tri_table_descriptor_buffer_info = {
-      triangle_table_buffer_, 0, VK_WHOLE_SIZE};
+  jobs_in_flight = std::clamp(jobs_in_flight, 1, max_meshing_jobs_in_flight);
+  if (jobs_in_flight == static_cast<int>(meshing_jobs_.size())) { return; }
 
-  const VkWriteDescriptorSet write_descriptor_set[] = {
-      {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptor_set, 0, 0, 1,
-       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
-       &indirect_descriptor_buffer_info, nullptr},
-      {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptor_set, 1, 0, 1,
-       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &out_descriptor_buffer_info,
-       nullptr},
-      {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptor_set, 2, 0, 1,
-       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
-       &edge_table_descriptor_buffer_info, nullptr},
-      {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, descriptor_set, 3, 0, 1,
-       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr,
-       &tri_table_descriptor_buffer_info, nullptr}};
-  vkUpdateDescriptorSets(context_.device(), beyond::size(write_descriptor_set),
-                         beyond::to_pointer(write_descriptor_set), 0, nullptr);
+  wait_for_meshing_jobs();
+  destroy_meshing_jobs();
+  create_meshing_jobs(jobs_in_flight, meshing_batch_size_);
+  meshing_jobs_in_flight_ = jobs_in_flight;
 }
 
-void ChunkManager::generate_chunk_mesh(beyond::IVec3 position)
+void ChunkManager::set_meshing_batch_size(int batch_size)
 {
-  const beyond::Vec4 transform = calculate_chunk_transform(position);
+  batch_size = std::clamp(batch_size, 1, max_meshing_batch_size);
+  if (batch_size == meshing_batch_size_) { return; }
 
-  VkCommandBuffer meshing_command_buffer =
-      vkh::allocate_command_buffer(
-          context_,
-          {.command_pool = meshing_command_pool_,
-           .debug_name =
-               fmt::format("Meshing command buffer at {}", position).c_str()})
-          .value();
+  wait_for_meshing_jobs();
+  destroy_meshing_jobs();
+  create_meshing_jobs(meshing_jobs_in_flight_, batch_size);
+  meshing_batch_size_ = batch_size;
+}
+
+[[nodiscard]] auto ChunkManager::find_idle_meshing_job() -> MeshingJob*
+{
+  const auto itr =
+      std::ranges::find(meshing_jobs_, MeshingJob::Stage::idle,
+                        [](const MeshingJob& job) { return job.stage; });
+  return itr == meshing_jobs_.end() ? nullptr : &*itr;
+}
+
+void ChunkManager::submit_meshing(MeshingJob& job,
+                                  std::span<const ChunkKey> chunks,
+                                  bool is_benchmark)
+{
+  BEYOND_ENSURE(!chunks.empty() &&
+                chunks.size() <= static_cast<std::size_t>(meshing_batch_size_));
+
+  const auto chunk_count = static_cast<std::uint32_t>(chunks.size());
+
+  job.stage = MeshingJob::Stage::counting;
+  job.chunks.assign(chunks.begin(), chunks.end());
+  job.is_benchmark = is_benchmark;
+
+  auto* transforms =
+      context_.map<beyond::Vec4>(job.chunk_transform_buffer).value();
+  for (std::size_t i = 0; i < chunks.size(); ++i) {
+    transforms[i] = calculate_chunk_transform(chunks[i]);
+  }
+  context_.unmap(job.chunk_transform_buffer);
 
   static constexpr VkCommandBufferBeginInfo command_buffer_begin_info = {
       .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
       .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
   };
 
-  VK_CHECK(
-      vkBeginCommandBuffer(meshing_command_buffer, &command_buffer_begin_info));
+  VK_CHECK(vkResetCommandBuffer(job.command_buffer, 0));
+  VK_CHECK(vkBeginCommandBuffer(job.command_buffer, &command_buffer_begin_info));
+
+  vkCmdBindDescriptorSets(job.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          meshing_pipeline_layout_, 0, 1, &job.descriptor_set,
+                          0, nullptr);
+
+  if (job.timestamp_query_pool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(job.command_buffer, job.timestamp_query_pool,
+                        density_begin_timestamp, emit_begin_timestamp);
+  }
+  write_timestamp(job.command_buffer, job.timestamp_query_pool,
+                  density_begin_timestamp);
+
+  // Chunks of a batch are stacked along the z axis of the dispatch
+  vkCmdBindPipeline(job.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    density_pipeline_);
+  vkCmdDispatch(job.command_buffer, meshing_workgroups_per_chunk_axis,
+                meshing_workgroups_per_chunk_axis,
+                meshing_workgroups_per_chunk_axis * chunk_count);
+  compute_to_compute_barrier(job.command_buffer);
+  write_timestamp(job.command_buffer, job.timestamp_query_pool,
+                  density_end_timestamp);
+
+  vkCmdBindPipeline(job.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    count_pipeline_);
+  vkCmdDispatch(job.command_buffer, meshing_workgroups_per_chunk_axis,
+                meshing_workgroups_per_chunk_axis,
+                meshing_workgroups_per_chunk_axis * chunk_count);
+  compute_to_compute_barrier(job.command_buffer);
+  write_timestamp(job.command_buffer, job.timestamp_query_pool,
+                  count_end_timestamp);
 
-  vkCmdBindPipeline(meshing_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+  vkCmdBindPipeline(job.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    scan_pipeline_);
+  vkCmdDispatch(job.command_buffer, chunk_count, 1, 1);
+  write_timestamp(job.command_buffer, job.timestamp_query_pool,
+                  scan_end_timestamp);
+
+  // Make the vertex and index counts visible to the host
+  const VkMemoryBarrier readback_barrier{
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+  };
+  vkCmdPipelineBarrier(job.command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &readback_barrier, 0,
+                       nullptr, 0, nullptr);
+  VK_CHECK(vkEndCommandBuffer(job.command_buffer));
+
+  const VkSubmitInfo count_submit_info{
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &job.command_buffer,
+  };
+  VK_CHECK(vkQueueSubmit(context_.compute_queue(), 1, &count_submit_info,
+                         job.fence));
+}
+
+auto ChunkManager::submit_emit(MeshingJob& job) -> bool
+{
+  VK_CHECK(vmaInvalidateAllocation(context_.allocator(),
+                                   job.reduced_buffer.allocation, 0,
+                                   VK_WHOLE_SIZE));
+  const auto* counts =
+      context_.map<VertexIndexPair>(job.reduced_buffer).value();
+
+  auto* heap_offsets =
+      context_.map<VertexIndexPair>(job.heap_offset_buffer).value();
+
+  // Every chunk of a batch missed the store, see start_store_lookup
+  const bool is_saved = chunk_store_ != nullptr && !job.is_benchmark;
+  std::vector<VkBufferCopy> vertex_copies;
+  std::vector<VkBufferCopy> index_copies;
+  std::size_t readback_size = 0;
+
+  bool has_vertices = false;
+  job.results.clear();
+  job.readbacks.clear();
+  for (std::size_t i = 0; i < job.chunks.size(); ++i) {
+    const ChunkKey chunk = job.chunks[i];
+    const auto [vertex_count, index_count] = counts[i];
+
+    if (index_count == 0) {
+      heap_offsets[i] = {.vertex = skipped_chunk_first_vertex};
+      job.results.push_back({.key = chunk});
+      if (is_saved) { job.readbacks.push_back({.key = chunk}); }
+      continue;
+    }
+
+    // A chunk that does not fit is left empty rather than retried, otherwise
+    // it would be remeshed every frame until something is unloaded
+    const auto first_vertex = vertex_heap_.allocate(vertex_count);
+    const auto first_index = index_heap_.allocate(index_count);
+    if (!first_vertex || !first_index) {
+      if (first_vertex) { vertex_heap_.free(*first_vertex, vertex_count); }
+      if (first_index) { index_heap_.free(*first_index, index_count); }
+      heap_offsets[i] = {.vertex = skipped_chunk_first_vertex};
+      ++heap_allocation_failures_;
+      job.results.push_back({.key = chunk});
+      continue;
+    }
+
+    heap_offsets[i] = {.vertex = *first_vertex, .index = *first_index};
+    has_vertices = true;
+    if (is_saved) {
+      const MeshReadback readback{
+          .key = chunk,
+          .vertex_offset = readback_size,
+          .vertex_count = vertex_count,
+          .index_offset = readback_size + sizeof(Vertex) * vertex_count,
+          .index_count = index_count,
+      };
+      vertex_copies.push_back({.srcOffset = sizeof(Vertex) * *first_vertex,
+                               .dstOffset = readback.vertex_offset,
+                               .size = sizeof(Vertex) * vertex_count});
+      index_copies.push_back(
+          {.srcOffset = sizeof(std::uint32_t) * *first_index,
+           .dstOffset = readback.index_offset,
+           .size = sizeof(std::uint32_t) * index_count});
+      readback_size =
+          readback.index_offset + sizeof(std::uint32_t) * index_count;
+      job.readbacks.push_back(readback);
+    }
+    job.results.push_back(
+        {.key = chunk,
+         .vertex_cache = ChunkVertexCache{
+             .first_vertex = *first_vertex,
+             .vertex_count = vertex_count,
+             .first_index = *first_index,
+             .index_count = index_count,
+             .transform = calculate_chunk_transform(chunk),
+         }});
+  }
+  context_.unmap(job.heap_offset_buffer);
+  context_.unmap(job.reduced_buffer);
+
+  if (!has_vertices) { return false; }
+
+  static constexpr VkCommandBufferBeginInfo command_buffer_begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+
+  VK_CHECK(vkResetCommandBuffer(job.command_buffer, 0));
+  VK_CHECK(vkBeginCommandBuffer(job.command_buffer, &command_buffer_begin_info));
+  vkCmdBindDescriptorSets(job.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          meshing_pipeline_layout_, 0, 1, &job.descriptor_set,
+                          0, nullptr);
+  if (job.timestamp_query_pool != VK_NULL_HANDLE) {
+    vkCmdResetQueryPool(job.command_buffer, job.timestamp_query_pool,
+                        emit_begin_timestamp,
+                        meshing_timestamp_count - emit_begin_timestamp);
+  }
+  write_timestamp(job.command_buffer, job.timestamp_query_pool,
+                  emit_begin_timestamp);
+  vkCmdBindPipeline(job.command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
                     meshing_pipeline_);
-  vkCmdBindDescriptorSets(
-      meshing_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
-      meshing_pipeline_layout_, 0, 1, &descriptor_set, 0, nullptr);
-  vkCmdPushConstants(meshing_command_buffer, meshing_pipeline_layout_,
-                     VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(beyond::Vec4),
-                     &transform);
-
-  constexpr std::uint32_t local_size = 4;
-  constexpr auto dispatch_size = chunk_dimension / local_size;
-  vkCmdDispatch(meshing_command_buffer, dispatch_size, dispatch_size,
-                dispatch_size);
-  VK_CHECK(vkEndCommandBuffer(meshing_command_buffer));
-
-  const VkSubmitInfo meshing_submit_info{
+  const auto chunk_count = static_cast<std::uint32_t>(job.chunks.size());
+  vkCmdDispatch(job.command_buffer, meshing_workgroups_per_chunk_axis,
+                meshing_workgroups_per_chunk_axis,
+                meshing_workgroups_per_chunk_axis * chunk_count);
+  write_timestamp(job.command_buffer, job.timestamp_query_pool,
+                  emit_end_timestamp);
+  if (!vertex_copies.empty()) {
+    job.readback_buffer =
+        vkh::create_buffer(context_,
+                           {.size = readback_size,
+                            .usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                            .memory_usage = VMA_MEMORY_USAGE_GPU_TO_CPU,
+                            .debug_name = "Terrain Mesh Readback Buffer"})
+            .value();
+    static constexpr VkMemoryBarrier emit_barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+    };
+    vkCmdPipelineBarrier(job.command_buffer,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &emit_barrier, 0,
+                         nullptr, 0, nullptr);
+    vkCmdCopyBuffer(job.command_buffer, vertex_heap_buffer_,
+                    job.readback_buffer,
+                    static_cast<std::uint32_t>(vertex_copies.size()),
+                    vertex_copies.data());
+    vkCmdCopyBuffer(job.command_buffer, index_heap_buffer_,
+                    job.readback_buffer,
+                    static_cast<std::uint32_t>(index_copies.size()),
+                    index_copies.data());
+    static constexpr VkMemoryBarrier readback_barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+    };
+    vkCmdPipelineBarrier(job.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &readback_barrier,
+                         0, nullptr, 0, nullptr);
+  }
+  VK_CHECK(vkEndCommandBuffer(job.command_buffer));
+
+  job.stage = MeshingJob::Stage::emitting;
+  const VkSubmitInfo emit_submit_info{
       .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
       .commandBufferCount = 1,
-      .pCommandBuffers = &meshing_command_buffer,
+      .pCommandBuffers = &job.command_buffer,
   };
-  VK_CHECK(vkQueueSubmit(context_.compute_queue(), 1, &meshing_submit_info,
-                         meshing_fence_));
+  VK_CHECK(vkQueueSubmit(context_.compute_queue(), 1, &emit_submit_info,
+                         job.fence));
+  return true;
+}
+
+void ChunkManager::read_meshing_timestamps(const MeshingJob& job)
+{
+  if (job.timestamp_query_pool == VK_NULL_HANDLE) { return; }
+
+  const bool is_counting = job.stage == MeshingJob::Stage::counting;
+  const std::uint32_t first_query =
+      is_counting ? density_begin_timestamp : emit_begin_timestamp;
+  const std::uint32_t query_count =
+      is_counting ? emit_begin_timestamp
+                  : meshing_timestamp_count - emit_begin_timestamp;
 
-  vkWaitForFences(context_.device(), 1, &meshing_fence_, true, 1e9);
-  vkResetFences(context_.device(), 1, &meshing_fence_);
+  std::uint64_t timestamps[meshing_timestamp_count] = {};
+  VK_CHECK(vkGetQueryPoolResults(
+      context_.device(), job.timestamp_query_pool, first_query, query_count,
+      query_count * sizeof(std::uint64_t), timestamps + first_query,
+      sizeof(std::uint64_t),
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
+
+  const auto elapsed_ms = [&](MeshingTimestamp begin, MeshingTimestamp end) {
+    return static_cast<double>(timestamps[end] - timestamps[begin]) *
+           timestamp_period_ns_ / 1e6;
+  };
+  if (is_counting) {
+    meshing_pass_timings_.density_ms +=
+        elapsed_ms(density_begin_timestamp, density_end_timestamp);
+    meshing_pass_timings_.count_ms +=
+        elapsed_ms(density_end_timestamp, count_end_timestamp);
+    meshing_pass_timings_.scan_ms +=
+        elapsed_ms(count_end_timestamp, scan_end_timestamp);
+    meshing_pass_timings_.chunk_count +=
+        static_cast<std::uint32_t>(job.chunks.size());
+  } else {
+    meshing_pass_timings_.emit_ms +=
+        elapsed_ms(emit_begin_timestamp, emit_end_timestamp);
+  }
+}
+
+void ChunkManager::finish_meshing_job(MeshingJob& job)
+{
+  save_gpu_meshes(job);
+  for (const MeshingResult& result : job.results) {
+    if (job.is_benchmark) {
+      if (result.vertex_cache.index_count == 0) { continue; }
+      vertex_heap_.free(result.vertex_cache.first_vertex,
+                        result.vertex_cache.vertex_count);
+      index_heap_.free(result.vertex_cache.first_index,
+                       result.vertex_cache.index_count);
+    } else {
+      add_meshed_chunk(result);
+    }
+  }
+  job.results.clear();
+  job.chunks.clear();
+  job.stage = MeshingJob::Stage::idle;
 }
 
-[[nodiscard]] auto ChunkManager::copy_mesh_from_scratch_buffer(
-    uint32_t vertex_count, beyond::IVec3 position) -> ChunkVertexCache
+void ChunkManager::save_gpu_meshes(MeshingJob& job)
 {
-  const beyond::Vec4 transform = calculate_chunk_transform(position);
+  if (job.readbacks.empty()) { return; }
 
-  const std::uint32_t vertex_buffer_size = vertex_count * sizeof(Vertex);
-  vkh::Buffer vertex_buffer =
-      vkh::create_buffer(
-          context_,
-          {.size = vertex_buffer_size,
-           .usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
-                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-           .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
-           .debug_name = fmt::format("Terrain chunk at {}", position).c_str()})
-          .value();
+  std::vector<std::pair<ChunkKey, ChunkMesh>> meshes;
+  meshes.reserve(job.readbacks.size());
+  const std::byte* data = nullptr;
+  if (job.readback_buffer.buffer != VK_NULL_HANDLE) {
+    VK_CHECK(vmaInvalidateAllocation(context_.allocator(),
+                                     job.readback_buffer.allocation, 0,
+                                     VK_WHOLE_SIZE));
+    data = context_.map<std::byte>(job.readback_buffer).value();
+  }
+  for (const MeshReadback& readback : job.readbacks) {
+    ChunkMesh mesh;
+    mesh.vertices.resize(readback.vertex_count);
+    mesh.indices.resize(readback.index_count);
+    if (readback.index_count != 0) {
+      std::memcpy(mesh.vertices.data(), data + readback.vertex_offset,
+                  sizeof(Vertex) * readback.vertex_count);
+      std::memcpy(mesh.indices.data(), data + readback.index_offset,
+                  sizeof(std::uint32_t) * readback.index_count);
+    }
+    meshes.emplace_back(readback.key, std::move(mesh));
+  }
+  if (data != nullptr) {
+    context_.unmap(job.readback_buffer);
+    vkh::destroy_buffer(context_, job.readback_buffer);
+    job.readback_buffer = {};
+  }
+  job.readbacks.clear();
 
-  VkCommandBuffer transfer_command_buffer =
+  // The chunks are already loaded, so the writes wait for the pending loads
+  thread_pool_.submit(
+      [store = chunk_store_.get(), meshes = std::move(meshes)] {
+        for (const auto& [chunk, mesh] : meshes) {
+          store->save(chunk, 0, mesh);
+        }
+      },
+      TaskPriority::low);
+}
+
+void ChunkManager::create_cpu_mesh_upload()
+{
+  cpu_mesh_upload_.staging_buffer =
+      vkh::create_buffer(context_,
+                         {.size = cpu_mesh_staging_buffer_size,
+                          .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                          .memory_usage = VMA_MEMORY_USAGE_CPU_ONLY,
+                          .debug_name = "CPU Mesh Staging Buffer"})
+          .value();
+  cpu_mesh_upload_.staging_data =
+      context_.map<std::byte>(cpu_mesh_upload_.staging_buffer).value();
+  cpu_mesh_upload_.command_buffer =
       vkh::allocate_command_buffer(
-          context_,
-          {.command_pool = meshing_command_pool_,
-           .debug_name =
-               fmt::format("Transfer command buffer at {}", position).c_str()})
+          context_, {.command_pool = meshing_command_pool_,
+                     .debug_name = "CPU Mesh Upload Command Buffer"})
           .value();
+  cpu_mesh_upload_.fence =
+      vkh::create_fence(context_, {.debug_name = "CPU Mesh Upload Fence"})
+          .value();
+}
 
-  static constexpr VkCommandBufferBeginInfo command_buffer_begin_info = {
-      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+void ChunkManager::destroy_cpu_mesh_upload()
+{
+  vkDestroyFence(context_.device(), cpu_mesh_upload_.fence, nullptr);
+  vkFreeCommandBuffers(context_.device(), meshing_command_pool_, 1,
+                       &cpu_mesh_upload_.command_buffer);
+  context_.unmap(cpu_mesh_upload_.staging_buffer);
+  vkh::destroy_buffer(context_, cpu_mesh_upload_.staging_buffer);
+}
+
+void ChunkManager::drain_completed_cpu_meshes()
+{
+  while (std::optional<CpuMeshedChunk> meshed =
+             completed_cpu_meshes_.try_pop()) {
+    // Cancelled, or replaced by the task of a later edit, after the task
+    // started
+    const auto itr = cpu_meshing_in_flight_.find(meshed->key);
+    if (itr == cpu_meshing_in_flight_.end() ||
+        itr->second.edit_version != meshed->edit_version) {
+      continue;
+    }
+    cpu_meshing_in_flight_.erase(itr);
+    if (meshed->is_store_miss) {
+      store_misses_.push_back(meshed->key);
+    } else {
+      pending_cpu_uploads_.push_back(std::move(*meshed));
+    }
+  }
+}
+
+void ChunkManager::poll_cpu_meshing()
+{
+  drain_completed_cpu_meshes();
+
+  // Edits patched by apply_edit wait for the upload in flight, then for their
+  // own, which only copies a few bricks along with the streamed meshes that
+  // fit, so that this frame draws them
+  const bool is_waiting = std::exchange(has_synchronous_edits_, false);
+  const auto finish_upload = [this](bool wait) {
+    if (wait) {
+      VK_CHECK(vkWaitForFences(context_.device(), 1, &cpu_mesh_upload_.fence,
+                               true, UINT64_MAX));
+    } else if (vkGetFenceStatus(context_.device(), cpu_mesh_upload_.fence) !=
+               VK_SUCCESS) {
+      return false;
+    }
+    VK_CHECK(vkResetFences(context_.device(), 1, &cpu_mesh_upload_.fence));
+    finish_cpu_mesh_upload();
+    return true;
   };
+  if (cpu_mesh_upload_.in_flight && !finish_upload(is_waiting)) { return; }
+
+  if (pending_cpu_uploads_.empty()) { return; }
+  // Edited chunks go ahead of the streamed ones, so that their upload does not
+  // wait behind streaming
+  std::ranges::stable_partition(
+      pending_cpu_uploads_, [this](const CpuMeshedChunk& meshed) {
+        const LoadedChunk* loaded = loaded_chunks_.find(meshed.key);
+        return loaded != nullptr && loaded->edit_time.has_value();
+      });
+  submit_cpu_mesh_upload();
+  if (is_waiting && cpu_mesh_upload_.in_flight) { finish_upload(true); }
+}
+
+void ChunkManager::submit_cpu_mesh_upload()
+{
+  CpuMeshUpload& upload = cpu_mesh_upload_;
+  std::vector<VkBufferCopy> vertex_copies;
+  std::vector<VkBufferCopy> index_copies;
+  // Previous meshes of the patched chunks, copied within the heaps before the
+  // patches are written over them
+  std::vector<VkBufferCopy> vertex_moves;
+  std::vector<VkBufferCopy> index_moves;
+  std::size_t staging_offset = 0;
+  // Chunks whose patch was made for a mesh they do not have anymore
+  std::vector<ChunkKey> dropped_patches;
+
+  std::size_t uploaded_count = 0;
+  for (; uploaded_count < pending_cpu_uploads_.size(); ++uploaded_count) {
+    const CpuMeshedChunk& meshed = pending_cpu_uploads_[uploaded_count];
+    const ChunkKey chunk = meshed.key;
+    const std::uint32_t transition_faces = meshed.transition_faces;
+    const std::uint64_t edit_version = meshed.edit_version;
+    const LoadedChunk* loaded = loaded_chunks_.find(chunk);
+    if (meshed.patch &&
+        (loaded == nullptr || !loaded->handle.is_valid() ||
+         loaded->brick_layout != meshed.patched_layout)) {
+      dropped_patches.push_back(chunk);
+      continue;
+    }
+    const ChunkMesh& mesh = meshed.patch ? meshed.patch->data : meshed.mesh;
+    const auto vertex_count = static_cast<std::uint32_t>(
+        meshed.patch ? meshed.patch->layout.vertex_count
+                     : mesh.vertices.size());
+    const auto index_count = static_cast<std::uint32_t>(
+        meshed.patch ? meshed.patch->layout.index_count : mesh.indices.size());
+    if (index_count == 0) {
+      upload.results.push_back({.key = chunk,
+                                .transition_faces = transition_faces,
+                                .edit_version = edit_version,
+                                .brick_layout = meshed.brick_layout});
+      continue;
+    }
+
+    const std::size_t vertex_bytes = mesh.vertices.size() * sizeof(Vertex);
+    const std::size_t index_bytes = mesh.indices.size() * sizeof(std::uint32_t);
+    const bool fits_in_staging = staging_offset + vertex_bytes + index_bytes <=
+                                 cpu_mesh_staging_buffer_size;
+    // The rest goes with the next upload, unless the staging buffer is too
+    // small for this mesh alone
+    if (!fits_in_staging && staging_offset != 0) { break; }
+
+    const auto first_vertex =
+        fits_in_staging ? vertex_heap_.allocate(vertex_count) : std::nullopt;
+    const auto first_index =
+        fits_in_staging ? index_heap_.allocate(index_count) : std::nullopt;
+    if (!first_vertex || !first_index) {
+      if (first_vertex) { vertex_heap_.free(*first_vertex, vertex_count); }
+      if (first_index) { index_heap_.free(*first_index, index_count); }
+      ++heap_allocation_failures_;
+      upload.results.push_back({.key = chunk,
+                                .transition_faces = transition_faces,
+                                .edit_version = edit_version});
+      continue;
+    }
 
-  VK_CHECK(vkBeginCommandBuffer(transfer_command_buffer,
-                                &command_buffer_begin_info));
+    std::memcpy(upload.staging_data + staging_offset, mesh.vertices.data(),
+                vertex_bytes);
+    const std::size_t vertex_staging_offset = staging_offset;
+    staging_offset += vertex_bytes;
+    std::memcpy(upload.staging_data + staging_offset, mesh.indices.data(),
+                index_bytes);
+    const std::size_t index_staging_offset = staging_offset;
+    staging_offset += index_bytes;
+    // Patches write over copies of the previous meshes, which the frames in
+    // flight may still draw
+    if (meshed.patch) {
+      const ChunkVertexCache previous = chunk_meshes_.get(loaded->handle);
+      vertex_moves.push_back(
+          {.srcOffset = previous.first_vertex * sizeof(Vertex),
+           .dstOffset = *first_vertex * sizeof(Vertex),
+           .size = previous.vertex_count * sizeof(Vertex)});
+      index_moves.push_back(
+          {.srcOffset = previous.first_index * sizeof(std::uint32_t),
+           .dstOffset = *first_index * sizeof(std::uint32_t),
+           .size = previous.index_count * sizeof(std::uint32_t)});
+      for (const MeshPatchCopy& copy : meshed.patch->vertex_copies) {
+        vertex_copies.push_back(
+            {.srcOffset = vertex_staging_offset + copy.source * sizeof(Vertex),
+             .dstOffset = (*first_vertex + copy.destination) * sizeof(Vertex),
+             .size = copy.count * sizeof(Vertex)});
+      }
+      for (const MeshPatchCopy& copy : meshed.patch->index_copies) {
+        index_copies.push_back(
+            {.srcOffset =
+                 index_staging_offset + copy.source * sizeof(std::uint32_t),
+             .dstOffset =
+                 (*first_index + copy.destination) * sizeof(std::uint32_t),
+             .size = copy.count * sizeof(std::uint32_t)});
+      }
+      ++brick_patch_count_;
+      patched_brick_count_ += static_cast<std::uint64_t>(
+          std::popcount(loaded->dirty_bricks));
+    } else {
+      vertex_copies.push_back({.srcOffset = vertex_staging_offset,
+                               .dstOffset = *first_vertex * sizeof(Vertex),
+                               .size = vertex_bytes});
+      index_copies.push_back(
+          {.srcOffset = index_staging_offset,
+           .dstOffset = *first_index * sizeof(std::uint32_t),
+           .size = index_bytes});
+      if (meshed.brick_layout != nullptr) { ++bricked_mesh_count_; }
+    }
 
-  const VkBufferCopy buffer_copy{
-      .srcOffset = 0,
-      .dstOffset = 0,
-      .size = vertex_buffer_size,
+    upload.results.push_back(
+        {.key = chunk,
+         .vertex_cache = ChunkVertexCache{
+             .first_vertex = *first_vertex,
+             .vertex_count = vertex_count,
+             .first_index = *first_index,
+             .index_count = index_count,
+             .transform = calculate_chunk_transform(chunk),
+         },
+         .transition_faces = transition_faces,
+         .edit_version = edit_version,
+         .brick_layout = meshed.brick_layout});
+  }
+  pending_cpu_uploads_.erase(
+      pending_cpu_uploads_.begin(),
+      pending_cpu_uploads_.begin() +
+          static_cast<std::ptrdiff_t>(uploaded_count));
+
+  // Meshed again whole from the next update
+  for (const ChunkKey chunk : dropped_patches) {
+    ++dropped_patch_count_;
+    LoadedChunk* loaded = loaded_chunks_.find(chunk);
+    if (loaded == nullptr || !lod_layout_.contains(chunk)) { continue; }
+    loaded->brick_layout = nullptr;
+    start_cpu_meshing({.key = chunk,
+                       .enqueue_time = std::chrono::steady_clock::now()},
+                      TaskPriority::high);
+  }
+
+  if (vertex_copies.empty() && index_copies.empty() && vertex_moves.empty()) {
+    finish_cpu_mesh_upload();
+    return;
+  }
+
+  VK_CHECK(vmaFlushAllocation(context_.allocator(),
+                              upload.staging_buffer.allocation, 0,
+                              staging_offset));
+
+  static constexpr VkCommandBufferBeginInfo command_buffer_begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
   };
-  vkCmdCopyBuffer(transfer_command_buffer, terrain_vertex_scratch_buffer_,
-                  vertex_buffer, 1, &buffer_copy);
-  VK_CHECK(vkEndCommandBuffer(transfer_command_buffer));
+  VK_CHECK(vkResetCommandBuffer(upload.command_buffer, 0));
+  VK_CHECK(
+      vkBeginCommandBuffer(upload.command_buffer, &command_buffer_begin_info));
+  // Patched ranges are written only once the previous meshes are copied
+  if (!vertex_moves.empty()) {
+    vkCmdCopyBuffer(upload.command_buffer, vertex_heap_buffer_,
+                    vertex_heap_buffer_,
+                    static_cast<std::uint32_t>(vertex_moves.size()),
+                    vertex_moves.data());
+    vkCmdCopyBuffer(upload.command_buffer, index_heap_buffer_,
+                    index_heap_buffer_,
+                    static_cast<std::uint32_t>(index_moves.size()),
+                    index_moves.data());
+    static constexpr VkMemoryBarrier move_barrier{
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(upload.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &move_barrier,
+                         0, nullptr, 0, nullptr);
+  }
+  if (!vertex_copies.empty()) {
+    vkCmdCopyBuffer(upload.command_buffer, upload.staging_buffer,
+                    vertex_heap_buffer_,
+                    static_cast<std::uint32_t>(vertex_copies.size()),
+                    vertex_copies.data());
+  }
+  if (!index_copies.empty()) {
+    vkCmdCopyBuffer(upload.command_buffer, upload.staging_buffer,
+                    index_heap_buffer_,
+                    static_cast<std::uint32_t>(index_copies.size()),
+                    index_copies.data());
+  }
+  VK_CHECK(vkEndCommandBuffer(upload.command_buffer));
 
-  const VkSubmitInfo transfer_submit_info{
+  const VkSubmitInfo submit_info{
       .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
       .commandBufferCount = 1,
-      .pCommandBuffers = &transfer_command_buffer,
+      .pCommandBuffers = &upload.command_buffer,
   };
-  VK_CHECK(vkQueueSubmit(context_.compute_queue(), 1, &transfer_submit_info,
-                         meshing_fence_));
+  VK_CHECK(vkQueueSubmit(context_.compute_queue(), 1, &submit_info,
+                         upload.fence));
+  upload.in_flight = true;
+}
 
-  vkWaitForFences(context_.device(), 1, &meshing_fence_, true, 1e9);
-  vkResetFences(context_.device(), 1, &meshing_fence_);
+void ChunkManager::finish_cpu_mesh_upload()
+{
+  for (const MeshingResult& result : cpu_mesh_upload_.results) {
+    add_meshed_chunk(result);
+  }
+  meshed_chunks_since_last_sample_ +=
+      static_cast<std::uint32_t>(cpu_mesh_upload_.results.size());
+  streamed_chunk_count_ += cpu_mesh_upload_.results.size();
+  cpu_mesh_upload_.results.clear();
+  cpu_mesh_upload_.in_flight = false;
+}
+
+auto ChunkManager::write_draws(std::uint32_t frame_index) -> std::uint32_t
+{
+  const ChunkDrawFrame& frame = draw_frames_[frame_index];
+  const auto draw_count = static_cast<std::uint32_t>(
+      std::min(chunk_meshes_.size(), std::size_t{max_draw_count}));
+  skipped_draw_count_ = chunk_meshes_.size() - draw_count;
 
-  return ChunkVertexCache{
-      .vertex_buffer = vertex_buffer,
-      .vertex_count = vertex_count,
-      .transform = transform,
+  const std::span first_vertices = chunk_meshes_.first_vertices();
+  const std::span first_indices = chunk_meshes_.first_indices();
+  const std::span index_counts = chunk_meshes_.index_counts();
+  for (std::uint32_t i = 0; i < draw_count; ++i) {
+    frame.commands[i] = VkDrawIndexedIndirectCommand{
+        .indexCount = index_counts[i],
+        .instanceCount = 1,
+        .firstIndex = first_indices[i],
+        .vertexOffset = static_cast<std::int32_t>(first_vertices[i]),
+        .firstInstance = i,
+    };
+  }
+  std::copy_n(chunk_meshes_.transforms().begin(), draw_count,
+              frame.transforms);
+  return draw_count;
+}
+
+auto ChunkManager::poll_meshing_jobs() -> std::uint32_t
+{
+  std::uint32_t completed_jobs = 0;
+  for (MeshingJob& job : meshing_jobs_) {
+    if (job.stage == MeshingJob::Stage::idle ||
+        vkGetFenceStatus(context_.device(), job.fence) != VK_SUCCESS) {
+      continue;
+    }
+    VK_CHECK(vkResetFences(context_.device(), 1, &job.fence));
+    read_meshing_timestamps(job);
+
+    // Empty chunks are done here, others still need to write their vertices
+    if (job.stage == MeshingJob::Stage::counting && submit_emit(job)) {
+      continue;
+    }
+
+    if (!job.is_benchmark) {
+      meshed_chunks_since_last_sample_ +=
+          static_cast<std::uint32_t>(job.results.size());
+      streamed_chunk_count_ += job.results.size();
+    }
+    finish_meshing_job(job);
+    ++completed_jobs;
+  }
+  return completed_jobs;
+}
+
+void ChunkManager::update_meshing_throughput()
+{
+  const auto now = std::chrono::steady_clock::now();
+  const std::chrono::duration<double> elapsed =
+      now - last_throughput_sample_time_;
+  if (elapsed.count() >= 1.0) {
+    meshing_throughput_ = meshed_chunks_since_last_sample_ / elapsed.count();
+    meshed_chunks_since_last_sample_ = 0;
+    last_throughput_sample_time_ = now;
+  }
+}
+
+auto ChunkManager::streaming_stats() const -> ChunkStreamingStats
+{
+  return ChunkStreamingStats{
+      .layout_chunk_count = std::reduce(lod_chunk_counts_.begin(),
+                                        lod_chunk_counts_.end()),
+      .tracked_chunk_count = loaded_chunks_.size(),
+      .meshed_chunk_count = chunk_meshes_.size(),
+      .queued_chunk_count = load_queue_.size(),
+      .unloaded_chunk_count = unloaded_chunk_count_,
+      .streamed_chunk_count = streamed_chunk_count_,
+      .skipped_chunk_count = skipped_chunk_count_,
+      .startup_load_ms = startup_load_ms_.value_or(0),
+      .vertex_count = vertex_heap_.used(),
+      .index_count = index_heap_.used(),
+      .meshing_throughput = meshing_throughput_,
   };
 }
 
-[[nodiscard]] auto ChunkManager::get_vertex_count() -> uint32_t
+void ChunkManager::run_meshing_benchmark()
 {
-  auto* indirect_buffer_data =
-      context_.map<TerrainReducedBuffer>(terrain_reduced_scratch_buffer_)
-          .value();
-  std::uint32_t count = indirect_buffer_data->vertex_count;
-  indirect_buffer_data->vertex_count = 0;
-  context_.unmap(terrain_reduced_scratch_buffer_);
-  return count;
+  wait_for_meshing_jobs();
+  const int original_batch_size = meshing_batch_size_;
+  const MeshingPassTimings original_pass_timings = meshing_pass_timings_;
+
+  std::vector<ChunkKey> chunks;
+  for (int x = -4; x <= 4; ++x) {
+    for (int y = -4; y <= 4; ++y) {
+      for (int z = -4; z <= 4; ++z) {
+        chunks.push_back({.position = {x, y, z}});
+      }
+    }
+  }
+
+  meshing_benchmark_results_.clear();
+  for (int batch_size = 1; batch_size <= max_meshing_batch_size;
+       batch_size *= 2) {
+    set_meshing_batch_size(batch_size);
+    meshing_pass_timings_ = {};
+
+    const auto start = std::chrono::steady_clock::now();
+    std::span<const ChunkKey> remaining = chunks;
+    do {
+      while (!remaining.empty()) {
+        MeshingJob* job = find_idle_meshing_job();
+        if (job == nullptr) { break; }
+
+        const std::size_t count =
+            std::min(remaining.size(), static_cast<std::size_t>(batch_size));
+        submit_meshing(*job, remaining.first(count), true);
+        remaining = remaining.subspan(count);
+      }
+    } while (wait_for_any_meshing_job());
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    meshing_benchmark_results_.push_back(
+        {.batch_size = batch_size,
+         .chunks_per_second =
+             static_cast<double>(chunks.size()) / elapsed.count(),
+         .pass_timings = meshing_pass_timings_});
+  }
+
+  set_meshing_batch_size(original_batch_size);
+  meshing_pass_timings_ = original_pass_timings;
+
+  // Baseline: the same pipeline on one CPU thread, over the central chunks
+  std::size_t cpu_chunk_count = 0;
+  const auto cpu_start = std::chrono::steady_clock::now();
+  for (const ChunkKey& chunk : chunks) {
+    if (std::abs(chunk.position.x) > 1 || std::abs(chunk.position.y) > 1 ||
+        std::abs(chunk.position.z) > 1) {
+      continue;
+    }
+    [[maybe_unused]] const ChunkMesh mesh = mesh_chunk_on_cpu(chunk);
+    ++cpu_chunk_count;
+  }
+  const std::chrono::duration<double> cpu_elapsed =
+      std::chrono::steady_clock::now() - cpu_start;
+  cpu_chunks_per_second_ =
+      static_cast<double>(cpu_chunk_count) / cpu_elapsed.count();
+}
+
+// The chunks drawn by the previous layout are already loaded, queued or being
+// meshed, since the queue only drops the requests that leave the layout
+void ChunkManager::request_entering_chunks(const ChunkLodLayout& previous,
+                                           const ChunkLodLayout& current)
+{
+  for_each_chunk_in_difference(current, previous, [this](ChunkKey chunk) {
+    if (loaded_chunks_.contains(chunk)) { return; }
+    // Back in the layout before the chunks that replaced it were all meshed
+    if (const LoadedChunk* retired = retired_chunks_.find(chunk)) {
+      loaded_chunks_.try_emplace(chunk, *retired);
+      retired_chunks_.erase(chunk);
+      return;
+    }
+    load_queue_.push(chunk);
+  });
+}
+
+// Chunks being meshed are in loaded_chunks_ without a mesh, so they are not
+// requested twice
+void ChunkManager::start_loading(const ChunkLoadRequest& request)
+{
+  loaded_chunks_.try_emplace(request.key);
+  request_times_[request.key] = request.enqueue_time;
+}
+
+auto ChunkManager::pop_chunk_to_mesh(
+    std::chrono::steady_clock::time_point classification_deadline)
+    -> std::optional<ChunkLoadRequest>
+{
+  while (true) {
+    std::optional<ChunkLoadRequest> request = load_queue_.pop();
+    if (!request || !skipping_uniform_chunks_ ||
+        terrain_edits_.is_edited(request->key) ||
+        std::chrono::steady_clock::now() >= classification_deadline) {
+      return request;
+    }
+    if (classify_chunk(request->key) == ChunkContents::mixed) {
+      return request;
+    }
+    start_loading(*request);
+    add_meshed_chunk(MeshingResult{
+        .key = request->key,
+        .transition_faces = lod_layout_.transition_faces(request->key),
+    });
+    ++skipped_chunk_count_;
+  }
+}
+
+void ChunkManager::add_meshed_chunk(const MeshingResult& result)
+{
+  // Meshed before an edit of the chunk, whose own mesh is on its way
+  if (const LoadedChunk* loaded = loaded_chunks_.find(result.key);
+      loaded != nullptr && result.edit_version < loaded->edit_version) {
+    if (result.vertex_cache.index_count != 0) {
+      release_vertex_cache(result.vertex_cache);
+    }
+    return;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (const auto itr = request_times_.find(result.key);
+      itr != request_times_.end()) {
+    load_latencies_.record(now - itr->second);
+    request_times_.erase(itr);
+  }
+
+  // The camera moved away while the chunk was being meshed. Nothing draws it
+  // yet, so its mesh can be freed right away
+  if (!lod_layout_.contains(result.key)) {
+    if (result.vertex_cache.index_count != 0) {
+      release_vertex_cache(result.vertex_cache);
+    }
+    loaded_chunks_.erase(result.key);
+    ++discarded_chunk_count_;
+    return;
+  }
+
+  LoadedChunk& loaded = loaded_chunks_[result.key];
+  // The chunk was remeshed for other transition faces
+  if (loaded.handle.is_valid()) {
+    replaced_meshes_.push_back(chunk_meshes_.remove(loaded.handle));
+  }
+  loaded.transition_faces = result.transition_faces;
+  loaded.brick_layout = result.brick_layout;
+  loaded.dirty_bricks = 0;
+  if (loaded.edit_time) {
+    edit_latencies_.record(now - *loaded.edit_time);
+    loaded.edit_time.reset();
+  }
+  // Empty chunks stay in loaded_chunks_ without a mesh
+  if (result.vertex_cache.index_count == 0) {
+    loaded.handle = {};
+    return;
+  }
+  loaded.handle = chunk_meshes_.insert(result.vertex_cache);
+  // Chunks of another level appeared or disappeared across its faces while it
+  // was being meshed
+  remesh_if_transitions_changed(result.key);
+
+  if (teleport_time_) {
+    time_to_first_mesh_ms_ =
+        std::chrono::duration<double, std::milli>(now - *teleport_time_)
+            .count();
+    teleport_time_.reset();
+  }
+}
+
+void ChunkManager::schedule_gpu_meshing()
+{
+  int budget = max_chunk_requests_per_frame_;
+  const auto classification_deadline =
+      std::chrono::steady_clock::now() + max_classification_time_per_frame_;
+  std::vector<ChunkKey> batch;
+  batch.reserve(static_cast<std::size_t>(meshing_batch_size_));
+  while (!store_misses_.empty() || (budget > 0 && !load_queue_.empty())) {
+    MeshingJob* job = find_idle_meshing_job();
+    if (job == nullptr) { return; }
+
+    batch.clear();
+    // Already loading, and counted in the budget when they were popped
+    while (!store_misses_.empty() &&
+           batch.size() < static_cast<std::size_t>(meshing_batch_size_)) {
+      const ChunkKey chunk = store_misses_.back();
+      store_misses_.pop_back();
+      // Edited, or given transition faces, during the lookup
+      if (cpu_meshing_in_flight_.contains(chunk)) { continue; }
+      if (lod_layout_.transition_faces(chunk) != 0 ||
+          terrain_edits_.is_edited(chunk)) {
+        start_cpu_meshing(
+            {.key = chunk, .enqueue_time = request_times_[chunk]});
+        continue;
+      }
+      batch.push_back(chunk);
+    }
+    while (budget > 0 &&
+           batch.size() < static_cast<std::size_t>(meshing_batch_size_)) {
+      const std::optional<ChunkLoadRequest> request =
+          pop_chunk_to_mesh(classification_deadline);
+      if (!request) { break; }
+      --budget;
+      // The shaders do not know the edits
+      if (lod_layout_.transition_faces(request->key) != 0 ||
+          terrain_edits_.is_edited(request->key)) {
+        start_cpu_meshing(*request);
+        continue;
+      }
+      if (chunk_store_ != nullptr) {
+        start_store_lookup(*request);
+        continue;
+      }
+      start_loading(*request);
+      batch.push_back(request->key);
+    }
+    if (!batch.empty()) { submit_meshing(*job, batch); }
+  }
 }
 
-using ChunkMap = std::unordered_map<beyond::IVec3, ChunkVertexCache*>;
+void ChunkManager::schedule_cpu_meshing()
+{
+  // Left by the GPU backend
+  for (const ChunkKey chunk : std::exchange(store_misses_, {})) {
+    if (cpu_meshing_in_flight_.contains(chunk)) { continue; }
+    start_cpu_meshing({.key = chunk, .enqueue_time = request_times_[chunk]});
+  }
+  int budget = max_chunk_requests_per_frame_;
+  const auto classification_deadline =
+      std::chrono::steady_clock::now() + max_classification_time_per_frame_;
+  while (budget > 0 &&
+         cpu_meshing_in_flight_.size() < max_cpu_meshing_tasks_in_flight) {
+    const std::optional<ChunkLoadRequest> request =
+        pop_chunk_to_mesh(classification_deadline);
+    if (!request) { return; }
+    start_cpu_meshing(*request);
+    --budget;
+  }
+}
 
-auto chunks_to_load(const ChunkMap& loaded_chunks, beyond::IVec3 center)
-    -> beyond::Generator<beyond::IVec3>
+void ChunkManager::start_cpu_meshing(const ChunkLoadRequest& request,
+                                     TaskPriority priority)
 {
-  for (int radius = 0; radius < 5; ++radius) {
-    for (int x = -radius; x <= radius; ++x) {
-      for (int y = -radius; y <= radius; ++y) {
-        for (int z = -radius; z <= radius; ++z) {
-          if (std::abs(x) < radius && std::abs(y) < radius &&
-              std::abs(z) < radius) {
-            continue;
+  start_loading(request);
+
+  const ChunkKey chunk = request.key;
+  const std::uint32_t transition_faces = lod_layout_.transition_faces(chunk);
+  const LoadedChunk& loaded = loaded_chunks_[chunk];
+  const std::uint64_t edit_version = loaded.edit_version;
+  // The store does not know the edits
+  const TerrainEdits* edits =
+      terrain_edits_.is_edited(chunk) ? &terrain_edits_ : nullptr;
+  ChunkStore* store = edits == nullptr ? chunk_store_.get() : nullptr;
+  const bool is_patched = edits != nullptr && is_patchable(chunk);
+  CpuMeshedChunk meshed{
+      .key = chunk,
+      .transition_faces = transition_faces,
+      .edit_version = edit_version,
+      .patched_layout = is_patched ? loaded.brick_layout : nullptr,
+  };
+  const MeshBrickMask dirty_bricks = is_patched ? loaded.dirty_bricks : 0;
+  CancellationSource cancellation;
+  thread_pool_.submit(
+      [queue = &completed_cpu_meshes_, store, edits, dirty_bricks,
+       meshed = std::move(meshed)]() mutable {
+        if (edits != nullptr) {
+          mesh_edited_chunk(*edits, dirty_bricks, meshed);
+          queue->push(std::move(meshed));
+          return;
+        }
+        std::optional<ChunkMesh> mesh;
+        if (store != nullptr) {
+          mesh = store->load(meshed.key, meshed.transition_faces);
+        }
+        if (!mesh) {
+          mesh = mesh_density_field(generate_density_field(meshed.key),
+                                    meshed.transition_faces);
+          if (store != nullptr) {
+            store->save(meshed.key, meshed.transition_faces, *mesh);
           }
+        }
+        meshed.mesh = std::move(*mesh);
+        queue->push(std::move(meshed));
+      },
+      priority, cancellation.token());
+  track_cpu_meshing(chunk, edit_version, std::move(cancellation));
+}
+
+auto ChunkManager::is_patchable(ChunkKey chunk) const -> bool
+{
+  // Only a mesh in the heaps can be patched
+  const LoadedChunk* loaded = loaded_chunks_.find(chunk);
+  return loaded != nullptr && lod_layout_.transition_faces(chunk) == 0 &&
+         loaded->handle.is_valid() && loaded->brick_layout != nullptr &&
+         loaded->dirty_bricks != 0;
+}
+
+void ChunkManager::patch_edited_chunk(const ChunkLoadRequest& request)
+{
+  start_loading(request);
+
+  const ChunkKey chunk = request.key;
+  // Results of the tasks of earlier edits are dropped once they are done
+  if (const auto itr = cpu_meshing_in_flight_.find(chunk);
+      itr != cpu_meshing_in_flight_.end()) {
+    itr->second.cancellation.cancel();
+    cpu_meshing_in_flight_.erase(itr);
+  }
+  const LoadedChunk& loaded = loaded_chunks_[chunk];
+  CpuMeshedChunk meshed{
+      .key = chunk,
+      .edit_version = loaded.edit_version,
+      .patched_layout = loaded.brick_layout,
+  };
+  mesh_edited_chunk(terrain_edits_, loaded.dirty_bricks, meshed);
+  pending_cpu_uploads_.push_back(std::move(meshed));
+}
+
+void ChunkManager::start_store_lookup(const ChunkLoadRequest& request)
+{
+  start_loading(request);
+
+  const ChunkKey chunk = request.key;
+  const std::uint64_t edit_version = loaded_chunks_[chunk].edit_version;
+  CancellationSource cancellation;
+  thread_pool_.submit(
+      [queue = &completed_cpu_meshes_, store = chunk_store_.get(), chunk,
+       edit_version] {
+        std::optional<ChunkMesh> mesh = store->load(chunk, 0);
+        queue->push(CpuMeshedChunk{
+            .key = chunk,
+            .edit_version = edit_version,
+            .mesh = mesh ? std::move(*mesh) : ChunkMesh{},
+            .is_store_miss = !mesh,
+        });
+      },
+      TaskPriority::normal, cancellation.token());
+  track_cpu_meshing(chunk, edit_version, std::move(cancellation));
+}
+
+void ChunkManager::track_cpu_meshing(ChunkKey chunk,
+                                     std::uint64_t edit_version,
+                                     CancellationSource cancellation)
+{
+  CpuMeshingTask& task = cpu_meshing_in_flight_[chunk];
+  task.cancellation.cancel();
+  task = CpuMeshingTask{.cancellation = std::move(cancellation),
+                        .edit_version = edit_version};
+}
 
-          const auto chunk_coord = beyond::IVec3{x, y, z} + center;
-          if (!loaded_chunks.contains(chunk_coord)) { co_yield chunk_coord; }
+// GPU batches cannot be cancelled once submitted, but are small enough to not
+// matter
+void ChunkManager::cancel_out_of_range_cpu_meshing()
+{
+  const auto cancel = [this](ChunkKey chunk) {
+    if (load_queue_.is_in_range(chunk)) { return false; }
+    // A chunk being remeshed still has its previous mesh, which
+    // unload_leaving_chunks unloads
+    if (const LoadedChunk* loaded = loaded_chunks_.find(chunk);
+        loaded != nullptr && !loaded->handle.is_valid()) {
+      loaded_chunks_.erase(chunk);
+    }
+    request_times_.erase(chunk);
+    ++cancelled_request_count_;
+    return true;
+  };
+  std::erase_if(cpu_meshing_in_flight_, [&](auto& in_flight) {
+    auto& [chunk, task] = in_flight;
+    if (!cancel(chunk)) { return false; }
+    task.cancellation.cancel();
+    return true;
+  });
+  std::erase_if(store_misses_, cancel);
+}
+
+void ChunkManager::unload_mesh(ChunkHandle handle,
+                               vkh::DeletionQueue& deletion_queue)
+{
+  // Later frames stop drawing the chunk right away, but frames in flight may
+  // still read its vertices and indices
+  deletion_queue.push(
+      [this, cache = chunk_meshes_.remove(handle)](vkh::Context&) {
+        release_vertex_cache(cache);
+      });
+  ++unloaded_chunk_count_;
+}
+
+void ChunkManager::unload_leaving_chunks(const ChunkLodLayout& previous,
+                                         const ChunkLodLayout& current,
+                                         vkh::DeletionQueue& deletion_queue)
+{
+  for_each_chunk_in_difference(previous, current, [&](ChunkKey chunk) {
+    LoadedChunk* loaded = loaded_chunks_.find(chunk);
+    if (loaded == nullptr) { return; }
+
+    if (loaded->handle.is_valid()) {
+      // A chunk replaced by chunks of another level stays drawn for now, as
+      // long as it fits in the half of the draws left to retired chunks
+      if (current.covers(chunk) &&
+          retired_chunks_.size() < max_retired_chunk_count) {
+        retired_chunks_.try_emplace(chunk, *loaded);
+      } else {
+        unload_mesh(loaded->handle, deletion_queue);
+      }
+    }
+    // Chunks being meshed are dropped once they are done, see add_meshed_chunk
+    if (request_times_.contains(chunk)) {
+      loaded->handle = {};
+      return;
+    }
+    loaded_chunks_.erase(chunk);
+  });
+}
+
+void ChunkManager::release_retired_chunks(vkh::DeletionQueue& deletion_queue)
+{
+  retired_chunks_.erase_if([&](ChunkKey chunk, const LoadedChunk& retired) {
+    if (lod_layout_.covers(chunk) && !is_replaced(chunk)) { return false; }
+    unload_mesh(retired.handle, deletion_queue);
+    return true;
+  });
+}
+
+auto ChunkManager::is_replaced(ChunkKey chunk) const -> bool
+{
+  // Chunks being remeshed are still drawn with their previous mesh
+  const auto is_loaded = [this](ChunkKey key) {
+    const LoadedChunk* loaded = loaded_chunks_.find(key);
+    return loaded != nullptr &&
+           (loaded->handle.is_valid() || !request_times_.contains(key));
+  };
+
+  for (ChunkKey ancestor = chunk; ancestor.lod < lod_layout_.top_lod();) {
+    ancestor = ancestor.parent();
+    if (lod_layout_.contains(ancestor)) { return is_loaded(ancestor); }
+  }
+  // Otherwise the layout draws descendants of the chunk, except where the
+  // chunk sticks out of the region of the top level
+  const auto are_descendants_loaded = [&](const auto& self,
+                                          ChunkKey parent) -> bool {
+    if (parent.lod == 0) { return false; }
+    for (int i = 0; i < 8; ++i) {
+      const ChunkKey child = parent.child(i);
+      if (!lod_layout_.covers(child)) { continue; }
+      if (lod_layout_.contains(child) ? !is_loaded(child)
+                                      : !self(self, child)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  return are_descendants_loaded(are_descendants_loaded, chunk);
+}
+
+void ChunkManager::request_transition_remeshing(const ChunkLodLayout& previous,
+                                                const ChunkLodLayout& current)
+{
+  const auto remesh_around = [this](ChunkKey changed) {
+    // Chunks revived from retirement were meshed for another layout
+    remesh_if_transitions_changed(changed);
+    for (int face = 0; face < chunk_face_count; ++face) {
+      remesh_if_transitions_changed(changed.neighbor(face));
+      if (changed.lod == 0) { continue; }
+      // The chunks of the level below across the face
+      for (int i = 0; i < 8; ++i) {
+        if (((i >> (face / 2)) & 1) == face % 2) {
+          remesh_if_transitions_changed(changed.child(i).neighbor(face));
         }
       }
     }
+  };
+  for_each_chunk_in_difference(current, previous, remesh_around);
+  for_each_chunk_in_difference(previous, current, remesh_around);
+}
+
+void ChunkManager::remesh_if_transitions_changed(ChunkKey chunk)
+{
+  const LoadedChunk* loaded = loaded_chunks_.find(chunk);
+  // Empty chunks stay empty, and chunks being meshed are checked once done
+  if (loaded == nullptr || !loaded->handle.is_valid() ||
+      request_times_.contains(chunk) || load_queue_.contains(chunk)) {
+    return;
+  }
+  if (loaded->transition_faces != lod_layout_.transition_faces(chunk)) {
+    load_queue_.push(chunk);
+    ++transition_remesh_count_;
   }
 }
 
-void ChunkManager::update(beyond::Point3 position)
+void ChunkManager::apply_edit(const Brush& brush)
 {
-  if (!generating_terrain_) { return; }
+  const auto edit_time = std::chrono::steady_clock::now();
+  const GridBox points = terrain_edits_.apply(brush);
+  if (points.is_empty()) { return; }
+  const std::uint64_t edit_version = terrain_edits_.edit_count();
 
-  const int x =
-      (static_cast<int>(position.x) + chunk_dimension / 2) / chunk_dimension;
-  const int y =
-      (static_cast<int>(position.y) + chunk_dimension / 2) / chunk_dimension;
-  const int z =
-      (static_cast<int>(position.z) + chunk_dimension / 2) / chunk_dimension;
+  // Chunks that are not loaded yet read the deltas when they are meshed
+  std::vector<ChunkKey> edited_chunks;
+  bool are_patchable = true;
+  int dirty_brick_count = 0;
+  for (int lod = 0; lod < lod_layout_.lod_count; ++lod) {
+    const GridBox chunks = chunks_reading(points, lod);
+    for (int z = chunks.min.z; z <= chunks.max.z; ++z) {
+      for (int y = chunks.min.y; y <= chunks.max.y; ++y) {
+        for (int x = chunks.min.x; x <= chunks.max.x; ++x) {
+          const ChunkKey chunk{.position = {x, y, z}, .lod = lod};
+          // Coarser lattices may fall between the changed points
+          const GridBox changed = lattice_points_in(chunk, points);
+          if (changed.is_empty()) { continue; }
+          // Retired chunks would keep drawing the terrain from before the
+          // edit until their replacements are loaded
+          if (const LoadedChunk* retired = retired_chunks_.find(chunk)) {
+            replaced_meshes_.push_back(chunk_meshes_.remove(retired->handle));
+            retired_chunks_.erase(chunk);
+            ++unloaded_chunk_count_;
+          }
+          LoadedChunk* loaded = loaded_chunks_.find(chunk);
+          if (loaded == nullptr || !lod_layout_.contains(chunk)) { continue; }
+          loaded->edit_version = edit_version;
+          if (!loaded->edit_time) { loaded->edit_time = edit_time; }
+          loaded->dirty_bricks |= mesh_bricks_reading(
+              {changed.min.x, changed.min.y, changed.min.z},
+              {changed.max.x, changed.max.y, changed.max.z});
+          edited_chunks.push_back(chunk);
+          are_patchable = are_patchable && is_patchable(chunk);
+          dirty_brick_count += std::popcount(loaded->dirty_bricks);
+        }
+      }
+    }
+  }
 
-  for (beyond::IVec3 chunk_coord :
-       chunks_to_load(loaded_chunks_, beyond::IVec3{x, y, z})) {
-    loaded_chunks_.emplace(chunk_coord, load_chunk(chunk_coord));
+  if (edited_chunks.empty()) { return; }
+  if (are_patchable && dirty_brick_count <= max_synchronous_edit_bricks) {
+    for (const ChunkKey chunk : edited_chunks) {
+      patch_edited_chunk({.key = chunk, .enqueue_time = edit_time});
+    }
+    has_synchronous_edits_ = true;
+    ++synchronous_edit_count_;
+    return;
+  }
+  for (const ChunkKey chunk : edited_chunks) {
+    start_cpu_meshing({.key = chunk, .enqueue_time = edit_time},
+                      TaskPriority::high);
   }
+}
 
-  //  for (auto [chunk_coord, vertex_cache_ptr] : loaded_chunks_) {
-  //    if (chunk_coord.x < -5 + x || chunk_coord.x > 5 + x ||
-  //        chunk_coord.y < -5 + y || chunk_coord.y > 5 + y ||
-  //        chunk_coord.z < -5 + z || chunk_coord.z > 5 + z) {
-  //      if (vertex_cache_ptr != nullptr) {
-  //        vertex_caches_.remove(*vertex_cache_ptr);
-  //      }
-  //    }
-  //  }
+void ChunkManager::apply_brush_along_ray(beyond::Point3 origin,
+                                         beyond::Vec3 direction)
+{
+  const std::optional<beyond::Point3> hit =
+      terrain_edits_.raycast(origin, direction, max_edit_distance);
+  if (!hit) { return; }
+  Brush brush = brush_;
+  brush.center = *hit;
+  apply_edit(brush);
 }
 
-[[nodiscard]] auto ChunkManager::load_chunk(beyond::IVec3 position)
-    -> ChunkVertexCache*
+auto ChunkManager::lod_layout_around(beyond::Point3 position) const
+    -> ChunkLodLayout
 {
-  update_write_descriptor_set();
+  ChunkLodLayout layout{.lod_count = view_settings_.lod_count};
+  for (int lod = 0; lod < layout.lod_count; ++lod) {
+    // In chunks of the level, from the first corner of its chunk 0
+    const auto chunk_extent = static_cast<float>(chunk_dimension << lod);
+    const auto to_chunks = [chunk_extent](float coordinate) {
+      return (coordinate + static_cast<float>(chunk_dimension / 2)) /
+             chunk_extent;
+    };
+    const beyond::Vec3 camera{to_chunks(position.x), to_chunks(position.y),
+                              to_chunks(position.z)};
+    const auto index = static_cast<std::size_t>(lod);
+
+    beyond::IVec3 center{static_cast<int>(std::floor(camera.x)),
+                         static_cast<int>(std::floor(camera.y)),
+                         static_cast<int>(std::floor(camera.z))};
+    if (lod < lod_layout_.lod_count) {
+      const beyond::IVec3 previous = lod_layout_.regions[index].center;
+      const auto is_near = [](float camera_coordinate, int chunk_coordinate) {
+        const auto first = static_cast<float>(chunk_coordinate);
+        return camera_coordinate >= first - lod_hysteresis &&
+               camera_coordinate < first + 1 + lod_hysteresis;
+      };
+      if (is_near(camera.x, previous.x) && is_near(camera.y, previous.y) &&
+          is_near(camera.z, previous.z)) {
+        center = previous;
+      }
+    }
+
+    layout.regions[index] =
+        ChunkRegion{.center = center,
+                    .radius = view_settings_.view_distance,
+                    .vertical_radius = view_settings_.vertical_view_distance,
+                    .shape = view_settings_.load_shape};
+  }
+  return layout;
+}
 
-  generate_chunk_mesh(position);
+void ChunkManager::set_view_settings(const ChunkViewSettings& settings)
+{
+  ChunkViewSettings clamped{
+      .view_distance = std::clamp(settings.view_distance, 1, max_view_distance),
+      .vertical_view_distance =
+          std::clamp(settings.vertical_view_distance, 1, max_view_distance),
+      .load_shape = settings.load_shape,
+      .lod_count = std::clamp(settings.lod_count, 1, max_chunk_lod_count),
+  };
+  const auto fits_in_draws = [](const ChunkViewSettings& candidate) {
+    return 2 * max_drawn_chunk_count(candidate) <= max_draw_count;
+  };
+  while (!fits_in_draws(clamped) &&
+         (clamped.view_distance > 1 || clamped.vertical_view_distance > 1)) {
+    int& distance =
+        clamped.view_distance >= clamped.vertical_view_distance
+            ? clamped.view_distance
+            : clamped.vertical_view_distance;
+    --distance;
+  }
+  BEYOND_ENSURE(fits_in_draws(clamped));
+  view_settings_ = clamped;
+}
 
-  const uint32_t vertex_count = get_vertex_count();
-  const bool is_empty_chunk = vertex_count == 0;
+auto ChunkManager::draw_distance() const -> float
+{
+  // Chunks of the top level extend up to one chunk past their coordinates, and
+  // the center of its region lags up to lod_hysteresis behind the camera
+  const auto top_chunk_extent =
+      static_cast<float>(chunk_dimension << (view_settings_.lod_count - 1));
+  const float margin = 1 + lod_hysteresis;
+  const float horizontal =
+      (static_cast<float>(view_settings_.view_distance) + margin) *
+      top_chunk_extent;
+  const float vertical =
+      (static_cast<float>(view_settings_.vertical_view_distance) + margin) *
+      top_chunk_extent;
+  switch (view_settings_.load_shape) {
+  case LoadShape::cube:
+    return std::sqrt(2 * horizontal * horizontal + vertical * vertical);
+  case LoadShape::sphere: return std::max(horizontal, vertical);
+  case LoadShape::cylinder:
+    return std::sqrt(horizontal * horizontal + vertical * vertical);
+  }
+  return std::sqrt(2 * horizontal * horizontal + vertical * vertical);
+}
 
-  if (is_empty_chunk) { return nullptr; }
+void ChunkManager::update_view_distance_sample()
+{
+  if (!view_distance_sample_pending_ || !load_queue_.empty() ||
+      !request_times_.empty()) {
+    return;
+  }
+  view_distance_sample_pending_ = false;
 
-  ChunkVertexCache vertex_cache =
-      copy_mesh_from_scratch_buffer(vertex_count, position);
-  vkResetCommandPool(context_.device(), meshing_command_pool_, 0);
-  return &vertex_caches_.add(vertex_cache);
+  const ViewDistanceSample sample{
+      .settings = view_settings_,
+      .layout_chunk_count = std::reduce(lod_chunk_counts_.begin(),
+                                        lod_chunk_counts_.end()),
+      .meshed_chunk_count = chunk_meshes_.size(),
+      .vertex_count = vertex_heap_.used(),
+      .index_count = index_heap_.used(),
+  };
+  const auto itr =
+      std::ranges::find_if(view_distance_samples_, [&](const auto& existing) {
+        return existing.settings == sample.settings;
+      });
+  if (itr != view_distance_samples_.end()) {
+    *itr = sample;
+  } else {
+    view_distance_samples_.push_back(sample);
+  }
 }
 
+void ChunkManager::release_vertex_cache(const ChunkVertexCache& cache)
+{
+  vertex_heap_.free(cache.first_vertex, cache.vertex_count);
+  index_heap_.free(cache.first_index, cache.index_count);
+}
+
+void ChunkManager::update(beyond::Point3 position, beyond::Vec3 view_direction,
+                          vkh::DeletionQueue& deletion_queue)
+{
+  completed_meshing_jobs_ = poll_meshing_jobs();
+  poll_cpu_meshing();
+  update_meshing_throughput();
+  for (const ChunkVertexCache& cache : replaced_meshes_) {
+    deletion_queue.push(
+        [this, cache](vkh::Context&) { release_vertex_cache(cache); });
+  }
+  replaced_meshes_.clear();
+
+  if (!generating_terrain_) { return; }
+  const auto now = std::chrono::steady_clock::now();
+  if (!first_update_time_) { first_update_time_ = now; }
+
+  const ChunkLodLayout layout = lod_layout_around(position);
+  load_queue_.set_focus(layout, view_direction);
+  // Only the chunks that enter or leave the layout are visited, and only when
+  // the region of a level moves or the view settings change
+  if (layout != lod_layout_) {
+    const beyond::IVec3 center = layout.regions[0].center;
+    if (last_center_) {
+      const beyond::IVec3 offset = center - *last_center_;
+      if (std::abs(offset.x) > 1 || std::abs(offset.y) > 1 ||
+          std::abs(offset.z) > 1) {
+        teleport_time_ = now;
+      }
+    }
+    last_center_ = center;
+    cancel_out_of_range_cpu_meshing();
+    unload_leaving_chunks(lod_layout_, layout, deletion_queue);
+    request_entering_chunks(lod_layout_, layout);
+    const ChunkLodLayout previous = std::exchange(lod_layout_, layout);
+    request_transition_remeshing(previous, layout);
+    for (std::size_t lod = 0; lod < lod_chunk_counts_.size(); ++lod) {
+      lod_chunk_counts_[lod] = layout.chunk_count(static_cast<int>(lod));
+    }
+    view_distance_sample_pending_ = true;
+  }
+  // Once their replacements are drawn, in the same frame
+  if (!retired_chunks_.empty()) { release_retired_chunks(deletion_queue); }
+
+  if (meshing_backend_ == MeshingBackend::cpu) {
+    schedule_cpu_meshing();
+  } else {
+    schedule_gpu_meshing();
+  }
+  update_view_distance_sample();
+  if (!startup_load_ms_ && load_queue_.empty() && request_times_.empty()) {
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - *first_update_time_;
+    startup_load_ms_ = elapsed.count();
+  }
+}
+
+namespace {
+
+void draw_latency_histogram(const char* label,
+                            const LatencyHistogram& histogram)
+{
+  ImGui::Text("%s: %llu chunks, mean %.1f ms", label,
+              static_cast<unsigned long long>(histogram.sample_count()),
+              histogram.mean_ms());
+  const auto& buckets = histogram.buckets();
+  ImGui::PlotHistogram(
+      fmt::format("##{}", label).c_str(), buckets.data(),
+      static_cast<int>(buckets.size()), 0,
+      fmt::format("1, 2, 4 ... {:.0f}+ ms",
+                  LatencyHistogram::bucket_upper_bound_ms(buckets.size() - 2))
+          .c_str(),
+      0, FLT_MAX, ImVec2(0, 60));
+}
+
+[[nodiscard]] auto geometry_mebibytes(std::uint32_t vertex_count,
+                                      std::uint32_t index_count) -> double
+{
+  constexpr double mebibyte = 1024.0 * 1024.0;
+  return static_cast<double>(vertex_count * sizeof(Vertex) +
+                             index_count * sizeof(std::uint32_t)) /
+         mebibyte;
+}
+
+void draw_meshing_pass_timings(const MeshingPassTimings& timings)
+{
+  if (timings.chunk_count == 0) { return; }
+
+  // Microseconds per chunk
+  const double scale = 1000.0 / timings.chunk_count;
+  ImGui::Text("GPU per chunk: density %.1f us, count %.1f us, scan %.1f us, "
+              "emit %.1f us",
+              timings.density_ms * scale, timings.count_ms * scale,
+              timings.scan_ms * scale, timings.emit_ms * scale);
+}
+
+} // anonymous namespace
+
 void ChunkManager::draw_gui()
 {
   ImGui::Text("Terrain Generation");
   ImGui::Checkbox("Generating", &generating_terrain_);
+
+  int jobs_in_flight = meshing_jobs_in_flight_;
+  if (ImGui::SliderInt("Meshing jobs in flight", &jobs_in_flight, 1,
+                       max_meshing_jobs_in_flight)) {
+    set_meshing_jobs_in_flight(jobs_in_flight);
+  }
+  int batch_size = meshing_batch_size_;
+  if (ImGui::SliderInt("Meshing batch size", &batch_size, 1,
+                       max_meshing_batch_size)) {
+    set_meshing_batch_size(batch_size);
+  }
+  int backend = static_cast<int>(meshing_backend_);
+  ImGui::RadioButton("GPU meshing", &backend,
+                     static_cast<int>(MeshingBackend::gpu));
+  ImGui::SameLine();
+  ImGui::RadioButton("CPU meshing", &backend,
+                     static_cast<int>(MeshingBackend::cpu));
+  set_meshing_backend(static_cast<MeshingBackend>(backend));
+  ImGui::Text("CPU meshing: %zu threads, %zu chunks in flight, %zu waiting "
+              "for upload",
+              thread_pool_.thread_count(), cpu_meshing_in_flight_.size(),
+              pending_cpu_uploads_.size());
+  ImGui::SliderInt("Chunk requests per frame", &max_chunk_requests_per_frame_,
+                   1, 256);
+  if (chunk_store_ != nullptr) {
+    const ChunkStoreStats stats = chunk_store_->stats();
+    ImGui::Text("Chunk store: %llu hits, %llu misses, %llu saved (%.1f MiB), "
+                "%llu compactions",
+                static_cast<unsigned long long>(stats.hit_count),
+                static_cast<unsigned long long>(stats.miss_count),
+                static_cast<unsigned long long>(stats.saved_count),
+                static_cast<double>(stats.written_bytes) / (1024.0 * 1024.0),
+                static_cast<unsigned long long>(stats.compaction_count));
+    if (stats.failure_count != 0) {
+      ImGui::Text("Chunk store failures: %llu",
+                  static_cast<unsigned long long>(stats.failure_count));
+    }
+  }
+
+  ChunkViewSettings view_settings = view_settings_;
+  bool view_settings_changed =
+      ImGui::SliderInt("View distance", &view_settings.view_distance, 1,
+                       max_view_distance);
+  view_settings_changed |= ImGui::SliderInt(
+      "Vertical view distance", &view_settings.vertical_view_distance, 1,
+      max_view_distance);
+  int load_shape = static_cast<int>(view_settings.load_shape);
+  for (const LoadShape shape :
+       {LoadShape::cube, LoadShape::sphere, LoadShape::cylinder}) {
+    if (shape != LoadShape::cube) { ImGui::SameLine(); }
+    view_settings_changed |= ImGui::RadioButton(
+        load_shape_name(shape), &load_shape, static_cast<int>(shape));
+  }
+  view_settings.load_shape = static_cast<LoadShape>(load_shape);
+  view_settings_changed |=
+      ImGui::SliderInt("Levels of detail", &view_settings.lod_count, 1,
+                       max_chunk_lod_count);
+  if (view_settings_changed) { set_view_settings(view_settings); }
+  for (int lod = 0; lod < lod_layout_.lod_count; ++lod) {
+    ImGui::BulletText("LOD %d (%dx): %zu chunks", lod, 1 << lod,
+                      lod_chunk_counts_[static_cast<std::size_t>(lod)]);
+  }
+  ImGui::Text("Retired chunks still drawn: %zu", retired_chunks_.size());
+  ImGui::Text("Remeshed for LOD transitions: %llu",
+              static_cast<unsigned long long>(transition_remesh_count_));
+  ImGui::Text("Draw distance: %.0f", static_cast<double>(draw_distance()));
+  if (!view_distance_samples_.empty()) {
+    ImGui::Text("Footprint once loaded (shape, distances, levels: layout "
+                "chunks, meshed chunks, geometry):");
+    for (const ViewDistanceSample& sample : view_distance_samples_) {
+      ImGui::BulletText(
+          "%s %d/%d, %d: %zu, %zu, %.1f MiB",
+          load_shape_name(sample.settings.load_shape),
+          sample.settings.view_distance, sample.settings.vertical_view_distance,
+          sample.settings.lod_count, sample.layout_chunk_count,
+          sample.meshed_chunk_count,
+          geometry_mebibytes(sample.vertex_count, sample.index_count));
+    }
+  }
+  ImGui::Text("Loaded chunks: %zu, unloaded: %llu, discarded: %llu",
+              loaded_chunks_.size(),
+              static_cast<unsigned long long>(unloaded_chunk_count_),
+              static_cast<unsigned long long>(discarded_chunk_count_));
+  ImGui::Text("Meshed chunks: %zu, not drawn: %zu", chunk_meshes_.size(),
+              skipped_draw_count_);
+  ImGui::Checkbox("Skip all-air and all-solid chunks",
+                  &skipping_uniform_chunks_);
+  ImGui::Text("Skipped without meshing: %llu, meshed: %llu",
+              static_cast<unsigned long long>(skipped_chunk_count_),
+              static_cast<unsigned long long>(streamed_chunk_count_));
+  if (startup_load_ms_) {
+    ImGui::Text("Chunks in view at startup loaded in %.0f ms",
+                *startup_load_ms_);
+  }
+  ImGui::Text("Load queue: %zu chunks, %llu dropped, %llu cancelled",
+              load_queue_.size(),
+              static_cast<unsigned long long>(
+                  load_queue_.dropped_request_count()),
+              static_cast<unsigned long long>(cancelled_request_count_));
+  draw_latency_histogram("Queue wait", load_queue_.wait_times());
+  draw_latency_histogram("Load latency", load_latencies_);
+  if (ImGui::Button("Reset load histograms")) {
+    load_queue_.reset_wait_times();
+    load_latencies_.reset();
+  }
+
+  ImGui::Text("Terrain editing (E to apply the brush)");
+  int brush_shape = static_cast<int>(brush_.shape);
+  ImGui::RadioButton("Sphere", &brush_shape,
+                     static_cast<int>(BrushShape::sphere));
+  ImGui::SameLine();
+  ImGui::RadioButton("Box", &brush_shape, static_cast<int>(BrushShape::box));
+  brush_.shape = static_cast<BrushShape>(brush_shape);
+  int brush_mode = static_cast<int>(brush_.mode);
+  ImGui::RadioButton("Add", &brush_mode, static_cast<int>(BrushMode::add));
+  ImGui::SameLine();
+  ImGui::RadioButton("Subtract", &brush_mode,
+                     static_cast<int>(BrushMode::subtract));
+  ImGui::SameLine();
+  ImGui::RadioButton("Smooth", &brush_mode,
+                     static_cast<int>(BrushMode::smooth));
+  brush_.mode = static_cast<BrushMode>(brush_mode);
+  ImGui::SliderFloat("Brush radius", &brush_.radius, 1.f,
+                     TerrainEdits::max_brush_radius);
+  ImGui::SliderFloat("Brush strength", &brush_.strength, 0.f, 1.f);
+  ImGui::Text("Edits: %llu, %zu bricks (%.2f MiB)",
+              static_cast<unsigned long long>(terrain_edits_.edit_count()),
+              terrain_edits_.brick_count(),
+              static_cast<double>(terrain_edits_.memory_bytes()) /
+                  (1024.0 * 1024.0));
+  ImGui::Text("Edited chunks patched: %llu (%.1f bricks each), meshed whole: "
+              "%llu, patches dropped: %llu",
+              static_cast<unsigned long long>(brick_patch_count_),
+              brick_patch_count_ == 0
+                  ? 0.0
+                  : static_cast<double>(patched_brick_count_) /
+                        static_cast<double>(brick_patch_count_),
+              static_cast<unsigned long long>(bricked_mesh_count_),
+              static_cast<unsigned long long>(dropped_patch_count_));
+  ImGui::Text("Edits patched within the frame: %llu of %llu",
+              static_cast<unsigned long long>(synchronous_edit_count_),
+              static_cast<unsigned long long>(terrain_edits_.edit_count()));
+  draw_latency_histogram("Edit latency", edit_latencies_);
+  if (ImGui::Button("Reset edit histogram")) { edit_latencies_.reset(); }
+
+  if (time_to_first_mesh_ms_ != 0) {
+    ImGui::Text("First chunk meshed %.1f ms after the last teleport",
+                time_to_first_mesh_ms_);
+  }
+  ImGui::Text("Meshing jobs completed this frame: %u", completed_meshing_jobs_);
+  ImGui::Text("Meshing throughput: %.1f chunks/s", meshing_throughput_);
+  draw_meshing_pass_timings(meshing_pass_timings_);
+  if (ImGui::Button("Reset meshing timings")) { meshing_pass_timings_ = {}; }
+
+  constexpr double mebibyte = 1024.0 * 1024.0;
+  ImGui::Text("Vertex heap: %.1f / %.1f MiB",
+              vertex_heap_.used() * sizeof(Vertex) / mebibyte,
+              vertex_heap_.capacity() * sizeof(Vertex) / mebibyte);
+  ImGui::Text("Vertex heap free blocks: %zu (largest %.1f MiB)",
+              vertex_heap_.free_block_count(),
+              vertex_heap_.largest_free_block() * sizeof(Vertex) / mebibyte);
+  ImGui::Text("Index heap: %.1f / %.1f MiB",
+              index_heap_.used() * sizeof(std::uint32_t) / mebibyte,
+              index_heap_.capacity() * sizeof(std::uint32_t) / mebibyte);
+  ImGui::Text("Index heap free blocks: %zu (largest %.1f MiB)",
+              index_heap_.free_block_count(),
+              index_heap_.largest_free_block() * sizeof(std::uint32_t) /
+                  mebibyte);
+  ImGui::Text("Loaded vertices: %u, triangles: %u", vertex_heap_.used(),
+              index_heap_.used() / 3);
+  if (heap_allocation_failures_ != 0) {
+    ImGui::Text("Chunks that did not fit in the heaps: %u",
+                heap_allocation_failures_);
+  }
+
+  if (ImGui::Button("Run meshing benchmark")) { run_meshing_benchmark(); }
+  for (const MeshingBenchmarkResult& result : meshing_benchmark_results_) {
+    ImGui::Text("Batch size %2d: %.1f chunks/s", result.batch_size,
+                result.chunks_per_second);
+    ImGui::Indent();
+    draw_meshing_pass_timings(result.pass_timings);
+    ImGui::Unindent();
+  }
+  if (cpu_chunks_per_second_ != 0) {
+    ImGui::Text("CPU reference mesher (%s): %.1f chunks/s",
+                density_instruction_set(), cpu_chunks_per_second_);
+  }
 }
\ No newline at end of file
@@ -1,56 +1,199 @@
 #ifndef VOXEL_GAME_TERRAIN_CHUNK_MANAGER_HPP
 #define VOXEL_GAME_TERRAIN_CHUNK_MANAGER_HPP
 
+#include "../concurrency/mpsc_queue.hpp"
+#include "../concurrency/thread_pool.hpp"
 #include "../vulkan_helpers/buffer.hpp"
 #include "../vulkan_helpers/context.hpp"
+#include "../vulkan_helpers/deletion_queue.hpp"
+#include "bricked_mesh.hpp"
+#include "chunk_key.hpp"
+#include "chunk_load_queue.hpp"
+#include "chunk_lod_layout.hpp"
+#include "chunk_map.hpp"
+#include "chunk_mesh_store.hpp"
+#include "chunk_region.hpp"
+#include "chunk_store.hpp"
+#include "cpu_mesher.hpp"
+#include "free_list_allocator.hpp"
+#include "terrain_edits.hpp"
 
 #include <beyond/math/point.hpp>
 #include <beyond/math/vector.hpp>
 
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
 #include <span>
 #include <unordered_map>
+#include <vector>
 
-struct ChunkVertexCache {
-  vkh::Buffer vertex_buffer{};
+struct MeshingResult {
+  ChunkKey key;
+  ChunkVertexCache vertex_cache{}; // Empty for chunks without any triangle
+  std::uint32_t transition_faces = 0; // See mesh_density_field
+  // Edit count of the terrain when the meshing started. Always zero for the
+  // GPU backend, which never meshes edited chunks
+  std::uint64_t edit_version = 0;
+  // Layout of the mesh if it is made of bricks, see bricked_mesh.hpp
+  std::shared_ptr<const BrickedMeshLayout> brick_layout{};
+};
+
+struct LoadedChunk {
+  ChunkHandle handle; // Invalid without triangles or while being meshed
+  std::uint32_t transition_faces = 0; // Those of its mesh
+  // Edit count of the last edit that changed the chunk. Older meshes are
+  // dropped when they are done
+  std::uint64_t edit_version = 0;
+  // Of the last edit, until the mesh that includes it is loaded
+  std::optional<std::chrono::steady_clock::time_point> edit_time;
+  // Null unless its mesh is made of bricks. Shared with the retired chunks and
+  // the tasks patching the mesh
+  std::shared_ptr<const BrickedMeshLayout> brick_layout;
+  // Bricks read by the edits since the mesh was made
+  MeshBrickMask dirty_bricks = 0;
+};
+
+// Where the mesh of a chunk of a meshing job lands in its readback buffer
+struct MeshReadback {
+  ChunkKey key;
+  std::size_t vertex_offset = 0; // In bytes
   std::uint32_t vertex_count = 0;
-  beyond::Vec4 transform; // x, y, z for translation, w for scaling
-  ChunkVertexCache* next = nullptr;
+  std::size_t index_offset = 0; // In bytes
+  std::uint32_t index_count = 0;
 };
 
-struct VertexCachePool {
-  static constexpr std::size_t vertex_cache_pool_size = 3000;
+// A meshing job owns everything needed to mesh a batch of chunks without
+// touching the resources of other jobs, so several of them can be in flight at
+// once
+struct MeshingJob {
+  enum class Stage {
+    idle,
+    counting, // Waiting for the vertex and index counts of the chunks
+    emitting, // Waiting for the vertices and indices to be written
+  };
 
-  VmaAllocator allocator = VK_NULL_HANDLE;
-  ChunkVertexCache vertex_cache_pool[vertex_cache_pool_size];
-  ChunkVertexCache* vertex_cache_pool_first_available = vertex_cache_pool;
+  Stage stage = Stage::idle;
+  std::vector<ChunkKey> chunks;
+  // Results of benchmark runs are thrown away instead of being loaded
+  bool is_benchmark = false;
 
-  explicit VertexCachePool(VmaAllocator a) : allocator{a}
-  {
-    for (std::size_t i = 0; i < vertex_cache_pool_size - 1; ++i) {
-      vertex_cache_pool[i].next = &vertex_cache_pool[i + 1];
-    }
-    // Next pointer of the last element will be nullptr
-  }
+  vkh::Buffer chunk_transform_buffer{};
+  vkh::Buffer density_buffer{}; // Density field of each chunk
+  vkh::Buffer cell_offset_buffer{}; // Vertex and index offsets of each cell
+  vkh::Buffer cell_edge_mask_buffer{}; // Intersected edges owned by each cell
+  vkh::Buffer reduced_buffer{};     // Vertex and index counts of each chunk
+  vkh::Buffer heap_offset_buffer{}; // Vertex and index heap offsets of each chunk
+  VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+  VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+  VkFence fence = VK_NULL_HANDLE;
+  VkQueryPool timestamp_query_pool = VK_NULL_HANDLE;
 
-  auto add(ChunkVertexCache cache_to_add) -> ChunkVertexCache&
-  {
-    // When we exhaust the pool
-    BEYOND_ENSURE(vertex_cache_pool_first_available != nullptr);
-    ChunkVertexCache& cache = *vertex_cache_pool_first_available;
-    vertex_cache_pool_first_available = cache.next;
-    cache = cache_to_add;
-    return cache;
-  }
+  std::vector<MeshingResult> results;
+  // Copies of the meshes of the batch, to save in the chunk store. Allocated
+  // for each batch, only with a store
+  vkh::Buffer readback_buffer{};
+  std::vector<MeshReadback> readbacks;
+};
 
-  void remove(ChunkVertexCache& reference)
-  {
-    // TODO: Find a way to gracefully delete buffers
-    vmaDestroyBuffer(allocator, reference.vertex_buffer.buffer,
-                     reference.vertex_buffer.allocation);
-    reference = ChunkVertexCache{};
-    reference.next = vertex_cache_pool_first_available;
-    vertex_cache_pool_first_available = &reference;
-  }
+// Where new chunks are meshed
+enum class MeshingBackend {
+  gpu, // Compute shaders, see MeshingJob
+  cpu, // cpu_mesher on the thread pool
+};
+
+struct CpuMeshedChunk {
+  ChunkKey key;
+  std::uint32_t transition_faces = 0;
+  std::uint64_t edit_version = 0; // See MeshingResult
+  ChunkMesh mesh{}; // Empty for patches
+  std::shared_ptr<const BrickedMeshLayout> brick_layout{}; // See MeshingResult
+  // Of the mesh the patch applies to, which is dropped if the chunk has
+  // another mesh by the time it is uploaded
+  std::shared_ptr<const BrickedMeshLayout> patched_layout{};
+  std::optional<BrickedMeshPatch> patch{};
+  // Not in the store, to be meshed on the GPU. See start_store_lookup
+  bool is_store_miss = false;
+};
+
+struct CpuMeshingTask {
+  CancellationSource cancellation;
+  std::uint64_t edit_version = 0; // See MeshingResult
+};
+
+// Copies the meshes of the CPU backend from a staging buffer into the heaps
+struct CpuMeshUpload {
+  vkh::Buffer staging_buffer{};
+  std::byte* staging_data = nullptr; // Persistently mapped
+  VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+  VkFence fence = VK_NULL_HANDLE;
+  bool in_flight = false;
+  std::vector<MeshingResult> results;
+};
+
+// GPU time spent in each meshing pass, summed over `chunk_count` chunks
+struct MeshingPassTimings {
+  double density_ms = 0;
+  double count_ms = 0;
+  double scan_ms = 0;
+  double emit_ms = 0;
+  std::uint32_t chunk_count = 0;
+};
+
+struct MeshingBenchmarkResult {
+  int batch_size = 0;
+  double chunks_per_second = 0;
+  MeshingPassTimings pass_timings;
+};
+
+// Indirect draws of the meshed chunks, rewritten every frame. Each frame in
+// flight has its own, so that the CPU never writes a draw the GPU may read
+struct ChunkDrawFrame {
+  vkh::Buffer command_buffer{};
+  vkh::Buffer transform_buffer{};
+  // Persistently mapped
+  VkDrawIndexedIndirectCommand* commands = nullptr;
+  beyond::Vec4* transforms = nullptr;
+};
+
+// Which chunks around the camera are loaded. Distances are the radii of the
+// region of each level of detail, in chunks of that level, see ChunkLodLayout.
+// Each level doubles the view distance with the same number of chunks
+struct ChunkViewSettings {
+  int view_distance = 4;          // Horizontal
+  int vertical_view_distance = 4;
+  LoadShape load_shape = LoadShape::cube;
+  int lod_count = max_chunk_lod_count;
+
+  friend auto operator==(const ChunkViewSettings&, const ChunkViewSettings&)
+      -> bool = default;
+};
+
+// Footprint of some view settings once every chunk in range is loaded
+struct ViewDistanceSample {
+  ChunkViewSettings settings;
+  std::size_t layout_chunk_count = 0;
+  std::size_t meshed_chunk_count = 0;
+  std::uint32_t vertex_count = 0;
+  std::uint32_t index_count = 0;
+};
+
+struct ChunkStreamingStats {
+  std::size_t layout_chunk_count = 0;  // Drawn by the LOD layout
+  std::size_t tracked_chunk_count = 0; // Loaded or being meshed, empty or not
+  std::size_t meshed_chunk_count = 0;  // With a mesh in the heaps
+  std::size_t queued_chunk_count = 0;  // Waiting in the load queue
+  std::uint64_t unloaded_chunk_count = 0; // Unloaded since the start
+  std::uint64_t streamed_chunk_count = 0; // Meshed since the start
+  // Found all air or all solid by classify_chunk, and loaded without meshing
+  std::uint64_t skipped_chunk_count = 0;
+  // From the first update until nothing was left to load, zero before
+  double startup_load_ms = 0;
+  std::uint32_t vertex_count = 0;
+  std::uint32_t index_count = 0;
+  double meshing_throughput = 0; // Chunks per second
 };
 
 class ChunkManager {
@@ -58,38 +201,214 @@ class ChunkManager {
 
   VkDescriptorPool descriptor_pool_ = VK_NULL_HANDLE;
   VkDescriptorSetLayout descriptor_set_layout_ = VK_NULL_HANDLE;
-  VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
   VkPipelineLayout meshing_pipeline_layout_ = VK_NULL_HANDLE;
+  VkPipeline density_pipeline_ = VK_NULL_HANDLE;
+  VkPipeline count_pipeline_ = VK_NULL_HANDLE;
+  VkPipeline scan_pipeline_ = VK_NULL_HANDLE;
   VkPipeline meshing_pipeline_ = VK_NULL_HANDLE;
   VkCommandPool meshing_command_pool_ = VK_NULL_HANDLE;
-  VkFence meshing_fence_ = VK_NULL_HANDLE;
 
   vkh::Buffer edge_table_buffer_;
   vkh::Buffer triangle_table_buffer_;
 
-  vkh::Buffer terrain_vertex_scratch_buffer_;
-  vkh::Buffer terrain_reduced_scratch_buffer_;
+  // Vertices and 32-bit indices of all the loaded chunks live in these
+  // buffers. Indices are relative to the first vertex of their chunk
+  vkh::Buffer vertex_heap_buffer_;
+  vkh::Buffer index_heap_buffer_;
+  FreeListAllocator vertex_heap_;
+  FreeListAllocator index_heap_;
+  std::uint32_t heap_allocation_failures_ = 0;
+
+  std::vector<ChunkDrawFrame> draw_frames_;
+  // Meshed chunks that did not fit in the draw buffers during last frame
+  std::size_t skipped_draw_count_ = 0;
+
+  std::vector<MeshingJob> meshing_jobs_;
+  int meshing_jobs_in_flight_ = 4;
+  int meshing_batch_size_ = 16;
+  std::uint32_t completed_meshing_jobs_ = 0; // Completed during last update
+
+  // Chunks per second, measured over roughly one second
+  double meshing_throughput_ = 0;
+  std::uint32_t meshed_chunks_since_last_sample_ = 0;
+  std::uint64_t streamed_chunk_count_ = 0;
+  // Chunks that classify_chunk finds all air or all solid are loaded as empty
+  // without being meshed
+  bool skipping_uniform_chunks_ = true;
+  std::uint64_t skipped_chunk_count_ = 0;
+  std::optional<std::chrono::steady_clock::time_point> first_update_time_;
+  std::optional<double> startup_load_ms_;
+  std::chrono::steady_clock::time_point last_throughput_sample_time_{};
+  std::vector<MeshingBenchmarkResult> meshing_benchmark_results_;
+  double cpu_chunks_per_second_ = 0; // Single-threaded CPU reference mesher
+
+  // Zero if the compute queue does not support timestamps
+  double timestamp_period_ns_ = 0;
+  MeshingPassTimings meshing_pass_timings_;
+
+  // Chunks being remeshed keep their previous mesh until the new one is loaded
+  ChunkMap<LoadedChunk> loaded_chunks_;
+  ChunkMeshStore chunk_meshes_;
+  // Chunks that left the layout but whose area is still in view. They are
+  // still drawn until the chunks of the other level that replace them are
+  // meshed, rather than leaving holes. At most max_retired_chunk_count, the
+  // others are unloaded right away
+  ChunkMap<LoadedChunk> retired_chunks_;
+  // Meshes replaced by the ones of remeshed chunks. Not drawn anymore, and
+  // freed through the deletion queue of the next update
+  std::vector<ChunkVertexCache> replaced_meshes_;
+  // Remeshed because chunks of another level appeared or disappeared across
+  // their faces
+  std::uint64_t transition_remesh_count_ = 0;
+
+  ChunkViewSettings view_settings_;
+  // Layout around the camera during the last update
+  ChunkLodLayout lod_layout_;
+  std::array<std::size_t, max_chunk_lod_count> lod_chunk_counts_{};
+  // Recorded once streaming settles after the layout changes
+  std::vector<ViewDistanceSample> view_distance_samples_;
+  bool view_distance_sample_pending_ = false;
+
+  ChunkLoadQueue load_queue_;
+  int max_chunk_requests_per_frame_ = 64;
+  // Spent classifying chunks per frame, at 10 to 20 us a chunk
+  std::chrono::microseconds max_classification_time_per_frame_{1000};
+  std::optional<beyond::IVec3> last_center_; // Of level 0
+  // When the chunks being meshed were requested
+  std::unordered_map<ChunkKey, std::chrono::steady_clock::time_point>
+      request_times_;
+  LatencyHistogram load_latencies_; // From request to mesh in the heaps
+  std::uint64_t cancelled_request_count_ = 0;
+  std::uint64_t unloaded_chunk_count_ = 0;
+  // Meshed after they left the layout
+  std::uint64_t discarded_chunk_count_ = 0;
+  // Set when the camera jumps by more than one chunk, until the first chunk
+  // with triangles is loaded
+  std::optional<std::chrono::steady_clock::time_point> teleport_time_;
+  double time_to_first_mesh_ms_ = 0; // After the last teleport
+
+  // Read by the tasks of the pool
+  TerrainEdits terrain_edits_;
+  Brush brush_; // Applied by apply_brush_along_ray, set in the GUI
+  // From the edit to its meshes in the heaps
+  LatencyHistogram edit_latencies_;
+  // Edits patched right away by apply_edit, whose upload the next update waits
+  // for so that they are drawn in the same frame
+  bool has_synchronous_edits_ = false;
+  std::uint64_t synchronous_edit_count_ = 0;
+  // Meshes of edited chunks uploaded as patches of their dirty bricks, or
+  // whole
+  std::uint64_t brick_patch_count_ = 0;
+  std::uint64_t patched_brick_count_ = 0;
+  std::uint64_t bricked_mesh_count_ = 0;
+  // Patches of meshes that were replaced before they were uploaded
+  std::uint64_t dropped_patch_count_ = 0;
 
-  std::unordered_map<beyond::IVec3, ChunkVertexCache*> loaded_chunks_;
-  VertexCachePool vertex_caches_;
+  // CPU backend. Workers push finished meshes into the queue, which is drained
+  // by update(). The pool is declared last so that its workers are joined
+  // before anything they use is destroyed
+  MeshingBackend meshing_backend_ = MeshingBackend::gpu;
+  MpscQueue<CpuMeshedChunk> completed_cpu_meshes_;
+  // Chunks whose task has not been popped from the queue. Results of chunks
+  // that are not in there anymore, or of another edit version, were cancelled
+  std::unordered_map<ChunkKey, CpuMeshingTask> cpu_meshing_in_flight_;
+  std::vector<CpuMeshedChunk> pending_cpu_uploads_;
+  // Chunks the GPU backend looked up in the store in vain, still being loaded
+  std::vector<ChunkKey> store_misses_;
+  CpuMeshUpload cpu_mesh_upload_;
+  // Null without a store directory. Only used by the tasks of the pool. The
+  // meshes of the GPU backend are read back and saved by save_gpu_meshes
+  std::unique_ptr<ChunkStore> chunk_store_;
+  ThreadPool thread_pool_;
 
   bool generating_terrain_ = true;
 
 public:
   static constexpr int chunk_dimension = 32;
+  // The distances are lowered further until the chunks they draw fit in the
+  // draw buffers, see set_view_settings
+  static constexpr int max_view_distance = 32;
+  // How far past the boundary of the chunk of the camera, in chunks of each
+  // level, the camera moves before the region of the level follows it. Keeps
+  // chunks from switching back and forth between levels of detail
+  static constexpr float lod_hysteresis = 0.25f;
+  static constexpr std::uint32_t vertex_heap_capacity = 4 * 1024 * 1024;
+  // Welded meshes reference each vertex about six times
+  static constexpr std::uint32_t index_heap_capacity = 24 * 1024 * 1024;
+  static constexpr int max_meshing_jobs_in_flight = 16;
+  static constexpr int max_meshing_batch_size = 64;
+  static constexpr std::uint32_t max_cpu_meshing_tasks_in_flight = 256;
+  static constexpr std::size_t cpu_mesh_staging_buffer_size = 16 * 1024 * 1024;
+  // Capacity of the draw buffers. Half of it is for the chunks of the layout,
+  // and half for the retired chunks that are still drawn, so every loaded
+  // chunk is drawn
+  static constexpr std::uint32_t max_draw_count = 16384;
+  static constexpr std::size_t max_retired_chunk_count = max_draw_count / 2;
+  // How far apply_brush_along_ray looks for the terrain
+  static constexpr float max_edit_distance = 256;
+  // Edits whose chunks all have a bricked mesh and that dirty at most this
+  // many bricks over every level are patched on the calling thread, in about
+  // 4 ms at the 99th percentile, see brick_patch_benchmark
+  static constexpr int max_synchronous_edit_bricks = 16;
 
-  explicit ChunkManager(vkh::Context& context);
+  // Meshes are kept in a ChunkStore in `chunk_store_directory`, unless it is
+  // empty
+  ChunkManager(vkh::Context& context, std::uint32_t frames_in_flight,
+               const ChunkViewSettings& view_settings = {},
+               const std::filesystem::path& chunk_store_directory = {});
   ~ChunkManager();
   ChunkManager(const ChunkManager&) = delete;
   auto operator=(const ChunkManager&) & -> ChunkManager& = delete;
   ChunkManager(ChunkManager&&) noexcept = delete;
   auto operator=(ChunkManager&&) & noexcept -> ChunkManager& = delete;
 
-  void update(beyond::Point3 position);
+  // `view_direction` needs to be normalized. Unloaded chunks are released by
+  // `deletion_queue`, which needs to be flushed only once the frames that are
+  // in flight are finished
+  void update(beyond::Point3 position, beyond::Vec3 view_direction,
+              vkh::DeletionQueue& deletion_queue);
 
-  [[nodiscard]] auto vertex_caches() -> std::span<ChunkVertexCache>
+  [[nodiscard]] auto vertex_buffer() const -> VkBuffer
   {
-    return vertex_caches_.vertex_cache_pool;
+    return vertex_heap_buffer_.buffer;
+  }
+  // Holds uint32 indices
+  [[nodiscard]] auto index_buffer() const -> VkBuffer
+  {
+    return index_heap_buffer_.buffer;
+  }
+  // Holds up to `max_draw_count` VkDrawIndexedIndirectCommand
+  [[nodiscard]] auto draw_command_buffer(std::uint32_t frame_index) const
+      -> VkBuffer
+  {
+    return draw_frames_[frame_index].command_buffer.buffer;
+  }
+  // Transform of each draw, indexed by the instance index
+  [[nodiscard]] auto draw_transform_buffer(std::uint32_t frame_index) const
+      -> VkBuffer
+  {
+    return draw_frames_[frame_index].transform_buffer.buffer;
+  }
+  // Writes one draw per meshed chunk into the draw buffers of the frame, which
+  // the GPU must not be using anymore. Returns the draw count
+  auto write_draws(std::uint32_t frame_index) -> std::uint32_t;
+
+  [[nodiscard]] auto view_settings() const -> const ChunkViewSettings&
+  {
+    return view_settings_;
+  }
+  // Distances are clamped to [1, max_view_distance] and the level count to
+  // [1, max_chunk_lod_count], then the larger distance is lowered until the
+  // layout draws at most half of max_draw_count chunks. The chunks that enter
+  // or leave the view are loaded or unloaded from the next update
+  void set_view_settings(const ChunkViewSettings& settings);
+  // Distance from the camera within which every loaded chunk lies, suitable for
+  // the far plane
+  [[nodiscard]] auto draw_distance() const -> float;
+  [[nodiscard]] auto view_distance_samples() const
+      -> std::span<const ViewDistanceSample>
+  {
+    return view_distance_samples_;
   }
 
   [[nodiscard]] auto is_generating_terrain() -> bool
@@ -100,18 +419,172 @@ public:
   {
     generating_terrain_ = is_generating_Terrain;
   }
+  [[nodiscard]] auto meshing_jobs_in_flight() const -> int
+  {
+    return meshing_jobs_in_flight_;
+  }
+  // Blocks until all in-flight jobs finish before resizing the job ring
+  void set_meshing_jobs_in_flight(int jobs_in_flight);
+
+  [[nodiscard]] auto meshing_batch_size() const -> int
+  {
+    return meshing_batch_size_;
+  }
+  // Blocks until all in-flight jobs finish before resizing the job buffers
+  void set_meshing_batch_size(int batch_size);
+
+  [[nodiscard]] auto meshing_backend() const -> MeshingBackend
+  {
+    return meshing_backend_;
+  }
+  // Chunks already being meshed finish on their original backend
+  void set_meshing_backend(MeshingBackend backend)
+  {
+    meshing_backend_ = backend;
+  }
+
+  [[nodiscard]] auto is_skipping_uniform_chunks() const -> bool
+  {
+    return skipping_uniform_chunks_;
+  }
+  void set_skipping_uniform_chunks(bool skipping_uniform_chunks)
+  {
+    skipping_uniform_chunks_ = skipping_uniform_chunks;
+  }
+
+  [[nodiscard]] auto streaming_stats() const -> ChunkStreamingStats;
+  // Null without a store directory
+  [[nodiscard]] auto chunk_store() const -> const ChunkStore*
+  {
+    return chunk_store_.get();
+  }
+
+  // Changes the terrain, then remeshes the loaded chunks that read the changed
+  // densities. Small edits patch the dirty bricks of the chunks right away,
+  // and the next update uploads them before the frame draws. Larger ones are
+  // remeshed on the thread pool, ahead of streaming, and uploaded ahead of the
+  // streamed chunks by the update after they are done. Retired chunks that
+  // read the changed densities are released rather than remeshed
+  void apply_edit(const Brush& brush);
+  // Applies the brush of the GUI where the ray first meets the terrain, if it
+  // does within max_edit_distance. `direction` needs to be normalized
+  void apply_brush_along_ray(beyond::Point3 origin, beyond::Vec3 direction);
+  [[nodiscard]] auto terrain_edits() const -> const TerrainEdits&
+  {
+    return terrain_edits_;
+  }
+  [[nodiscard]] auto edit_latencies() const -> const LatencyHistogram&
+  {
+    return edit_latencies_;
+  }
+
+  // Meshes the chunks around the origin with every power-of-two batch size and
+  // records the throughput of each. Blocks until done
+  void run_meshing_benchmark();
+
   void draw_gui();
 
 private:
-  [[nodiscard]] auto load_chunk(beyond::IVec3 position) -> ChunkVertexCache*;
-
-  static auto calculate_chunk_transform(beyond::IVec3 position) -> beyond::Vec4;
-  void update_write_descriptor_set();
-  void generate_chunk_mesh(beyond::IVec3 position);
-  auto get_vertex_count() -> uint32_t;
-  auto copy_mesh_from_scratch_buffer(uint32_t vertex_count,
-                                     beyond::IVec3 position)
-      -> ChunkVertexCache;
+  static auto calculate_chunk_transform(ChunkKey chunk) -> beyond::Vec4;
+
+  void create_meshing_jobs(int count, int batch_size);
+  void destroy_meshing_jobs();
+  void wait_for_meshing_jobs();
+  // Returns false if there is no job to wait for
+  auto wait_for_any_meshing_job() -> bool;
+
+  [[nodiscard]] auto find_idle_meshing_job() -> MeshingJob*;
+  // Returns the number of jobs that are completed
+  auto poll_meshing_jobs() -> std::uint32_t;
+
+  void submit_meshing(MeshingJob& job, std::span<const ChunkKey> chunks,
+                      bool is_benchmark = false);
+  // Returns false if none of the chunks in the batch has any triangle
+  auto submit_emit(MeshingJob& job) -> bool;
+  void finish_meshing_job(MeshingJob& job);
+  // Copies the meshes of the job out of its readback buffer, and saves them in
+  // the chunk store on the thread pool
+  void save_gpu_meshes(MeshingJob& job);
+  // Adds the GPU time of the stage that just completed to the pass timings
+  void read_meshing_timestamps(const MeshingJob& job);
+
+  void create_cpu_mesh_upload();
+  void destroy_cpu_mesh_upload();
+  void request_entering_chunks(const ChunkLodLayout& previous,
+                               const ChunkLodLayout& current);
+  // Marks the chunk as being meshed
+  void start_loading(const ChunkLoadRequest& request);
+  // Pops the next chunk that needs meshing. Until `classification_deadline`,
+  // the chunks that classify_chunk finds all air or all solid are loaded as
+  // empty on the way
+  [[nodiscard]] auto pop_chunk_to_mesh(
+      std::chrono::steady_clock::time_point classification_deadline)
+      -> std::optional<ChunkLoadRequest>;
+  // Adds a chunk whose meshing finished
+  void add_meshed_chunk(const MeshingResult& result);
+  // Chunks with transition cells are meshed on the CPU even with the GPU
+  // backend, whose shaders only generate regular cells. Chunks are looked up
+  // in the store on the CPU first, and only meshed on the GPU if they are not
+  // in there, then saved
+  void schedule_gpu_meshing();
+  void schedule_cpu_meshing();
+  // Starts loading the chunk on the thread pool, from the store if it is in
+  // there, or else by meshing it and saving its mesh into the store. Edited
+  // chunks are always meshed, and never saved. Those without transition faces
+  // are meshed in bricks, and only their dirty bricks are remeshed once they
+  // have such a mesh. Replaces the task of the chunk if it is already being
+  // meshed
+  void start_cpu_meshing(const ChunkLoadRequest& request,
+                         TaskPriority priority = TaskPriority::normal);
+  // Whether only the dirty bricks of the chunk need remeshing
+  [[nodiscard]] auto is_patchable(ChunkKey chunk) const -> bool;
+  // Patches the dirty bricks of the chunk on the calling thread, and queues
+  // the patch for upload. Replaces the task of the chunk if it is being meshed
+  void patch_edited_chunk(const ChunkLoadRequest& request);
+  // Starts loading the chunk from the store on the thread pool, for the GPU
+  // backend. Misses end up in store_misses_
+  void start_store_lookup(const ChunkLoadRequest& request);
+  // Replaces the task of the chunk, if any
+  void track_cpu_meshing(ChunkKey chunk, std::uint64_t edit_version,
+                         CancellationSource cancellation);
+  void cancel_out_of_range_cpu_meshing();
+  void unload_leaving_chunks(const ChunkLodLayout& previous,
+                             const ChunkLodLayout& current,
+                             vkh::DeletionQueue& deletion_queue);
+  // The transition faces of a chunk change when a face neighbor, or the
+  // parent of one, enters or leaves the layout. Needs lod_layout_ to be the
+  // current layout already
+  void request_transition_remeshing(const ChunkLodLayout& previous,
+                                    const ChunkLodLayout& current);
+  // Queues a loaded chunk whose mesh does not have the transition faces of the
+  // current layout
+  void remesh_if_transitions_changed(ChunkKey chunk);
+  // Releases the retired chunks that are out of view, or whose replacements
+  // are loaded
+  void release_retired_chunks(vkh::DeletionQueue& deletion_queue);
+  // Whether the chunks of the layout that overlap the chunk all have their
+  // mesh, or are loaded as empty
+  [[nodiscard]] auto is_replaced(ChunkKey chunk) const -> bool;
+  // Keeps the region of each level of the current layout centered where it is
+  // until the camera moves `lod_hysteresis` past the chunk of its center
+  [[nodiscard]] auto lod_layout_around(beyond::Point3 position) const
+      -> ChunkLodLayout;
+  // Records the footprint of the view settings once nothing is left to load
+  void update_view_distance_sample();
+  // Frees the vertices and indices of an unloaded chunk
+  void release_vertex_cache(const ChunkVertexCache& cache);
+  // Stops drawing the chunk, and frees its mesh once the frames in flight are
+  // done with it
+  void unload_mesh(ChunkHandle handle, vkh::DeletionQueue& deletion_queue);
+  // Drains the completed CPU meshes and uploads them
+  void poll_cpu_meshing();
+  // Moves the completed CPU meshes that were not cancelled to the pending
+  // uploads
+  void drain_completed_cpu_meshes();
+  void submit_cpu_mesh_upload();
+  void finish_cpu_mesh_upload();
+
+  void update_meshing_throughput();
 };
 
 #endif // VOXEL_GAME_TERRAIN_CHUNK_MANAGER_HPP
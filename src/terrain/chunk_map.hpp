@@ -0,0 +1,221 @@
+#ifndef VOXEL_GAME_TERRAIN_CHUNK_MAP_HPP
+#define VOXEL_GAME_TERRAIN_CHUNK_MAP_HPP
+
+#include "chunk_key.hpp"
+#include "morton.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hash map from chunk keys to `T`, with open addressing and linear probing over
+// flat arrays. Keys are Morton codes, and each aligned 2x2x2 block of chunks of
+// a level of detail hashes to eight consecutive slots, so that looking up the
+// neighbors of a chunk mostly hits the same cache lines. Erasing shifts the
+// following entries back instead of leaving tombstones
+template <typename T> class ChunkMap {
+  static constexpr std::uint64_t empty_key = ~std::uint64_t{0};
+  static constexpr std::size_t not_found = ~std::size_t{0};
+  static constexpr std::size_t min_capacity = 64;
+
+  std::vector<std::uint64_t> keys_; // Probed without touching the values
+  std::vector<T> values_;
+  std::size_t size_ = 0;
+  std::size_t mask_ = 0;
+  int block_shift_ = 64; // Turns the hash of a block into its first slot
+
+public:
+  // Face neighbors in the order -x, +x, -y, +y, -z, +z
+  using Neighbors = std::array<T*, 6>;
+
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return size_;
+  }
+  [[nodiscard]] auto empty() const -> bool
+  {
+    return size_ == 0;
+  }
+  [[nodiscard]] auto capacity() const -> std::size_t
+  {
+    return keys_.size();
+  }
+
+  void clear()
+  {
+    keys_.clear();
+    values_.clear();
+    size_ = 0;
+    mask_ = 0;
+    block_shift_ = 64;
+  }
+
+  // Makes room for `count` entries without rehashing
+  void reserve(std::size_t count)
+  {
+    if (2 * count > capacity()) {
+      rehash(std::max(min_capacity, std::bit_ceil(2 * count)));
+    }
+  }
+
+  [[nodiscard]] auto find(ChunkKey key) -> T*
+  {
+    return value_at(find_slot(chunk_key_encode(key)));
+  }
+  [[nodiscard]] auto find(ChunkKey key) const -> const T*
+  {
+    const std::size_t slot = find_slot(chunk_key_encode(key));
+    return slot == not_found ? nullptr : &values_[slot];
+  }
+  [[nodiscard]] auto contains(ChunkKey key) const -> bool
+  {
+    return find_slot(chunk_key_encode(key)) != not_found;
+  }
+
+  // Inserts `value` unless the chunk is already in the map. Returns the value
+  // of the chunk and whether it was inserted. Pointers to values are
+  // invalidated by any insertion or erasure
+  auto try_emplace(ChunkKey key, T value = T{})
+      -> std::pair<T*, bool>
+  {
+    const std::uint64_t code = chunk_key_encode(key);
+    if (const std::size_t slot = find_slot(code); slot != not_found) {
+      return {&values_[slot], false};
+    }
+
+    if (2 * (size_ + 1) > capacity()) {
+      rehash(std::max(min_capacity, 2 * capacity()));
+    }
+    std::size_t slot = home_slot(code);
+    while (keys_[slot] != empty_key) { slot = (slot + 1) & mask_; }
+    keys_[slot] = code;
+    values_[slot] = std::move(value);
+    ++size_;
+    return {&values_[slot], true};
+  }
+
+  auto operator[](ChunkKey key) -> T&
+  {
+    return *try_emplace(key).first;
+  }
+
+  // Returns false if the chunk is not in the map
+  auto erase(ChunkKey key) -> bool
+  {
+    const std::size_t slot = find_slot(chunk_key_encode(key));
+    if (slot == not_found) { return false; }
+    erase_slot(slot);
+    return true;
+  }
+
+  // Erases the entries for which `predicate(key, value)` returns true.
+  // Visits each entry once
+  template <typename Predicate> void erase_if(Predicate&& predicate)
+  {
+    if (empty()) { return; }
+    // Starting right after an empty slot, no entry is shifted back across the
+    // start, so entries shifted into the current slot have not been visited
+    std::size_t start = 0;
+    while (keys_[start] != empty_key) { ++start; }
+    for (std::size_t i = 1; i <= capacity(); ++i) {
+      const std::size_t slot = (start + i) & mask_;
+      while (keys_[slot] != empty_key &&
+             predicate(chunk_key_decode(keys_[slot]), values_[slot])) {
+        erase_slot(slot);
+      }
+    }
+  }
+
+  // Calls `function(key, value)` for each entry
+  template <typename Function> void for_each(Function&& function)
+  {
+    for (std::size_t slot = 0; slot < capacity(); ++slot) {
+      if (keys_[slot] != empty_key) {
+        function(chunk_key_decode(keys_[slot]), values_[slot]);
+      }
+    }
+  }
+
+  // Neighbors of the same level of detail, null for the ones that are not in
+  // the map. Steps between neighbors in Morton space, without decoding and
+  // re-encoding the coordinates
+  [[nodiscard]] auto neighbors(ChunkKey key) -> Neighbors
+  {
+    const std::uint64_t code = chunk_key_encode(key);
+    return Neighbors{
+        value_at(find_slot(morton_decrement(code, morton_x_mask))),
+        value_at(find_slot(morton_increment(code, morton_x_mask))),
+        value_at(find_slot(morton_decrement(code, morton_y_mask))),
+        value_at(find_slot(morton_increment(code, morton_y_mask))),
+        value_at(find_slot(morton_decrement(code, morton_z_mask))),
+        value_at(find_slot(morton_increment(code, morton_z_mask))),
+    };
+  }
+
+private:
+  [[nodiscard]] auto home_slot(std::uint64_t code) const -> std::size_t
+  {
+    // Fibonacci hashing of the block, the low bits pick the slot in the block
+    const std::uint64_t block_hash =
+        (code >> 3) * 0x9e3779b97f4a7c15 >> block_shift_;
+    return (block_hash << 3 | (code & 7)) & mask_;
+  }
+
+  // Returns `not_found` if the code is not in the map
+  [[nodiscard]] auto find_slot(std::uint64_t code) const -> std::size_t
+  {
+    if (empty()) { return not_found; }
+    for (std::size_t slot = home_slot(code);; slot = (slot + 1) & mask_) {
+      if (keys_[slot] == code) { return slot; }
+      if (keys_[slot] == empty_key) { return not_found; }
+    }
+  }
+  [[nodiscard]] auto value_at(std::size_t slot) -> T*
+  {
+    return slot == not_found ? nullptr : &values_[slot];
+  }
+
+  // Moves back the following entries of the probe sequence that would not be
+  // found anymore once `slot` is empty
+  void erase_slot(std::size_t slot)
+  {
+    std::size_t hole = slot;
+    for (std::size_t next = (slot + 1) & mask_; keys_[next] != empty_key;
+         next = (next + 1) & mask_) {
+      const std::size_t home = home_slot(keys_[next]);
+      // The entry can fill the hole if the hole is between its home and it
+      if (((next - home) & mask_) >= ((next - hole) & mask_)) {
+        keys_[hole] = keys_[next];
+        values_[hole] = std::move(values_[next]);
+        hole = next;
+      }
+    }
+    keys_[hole] = empty_key;
+    values_[hole] = T{};
+    --size_;
+  }
+
+  void rehash(std::size_t new_capacity)
+  {
+    std::vector<std::uint64_t> old_keys = std::exchange(
+        keys_, std::vector<std::uint64_t>(new_capacity, empty_key));
+    std::vector<T> old_values =
+        std::exchange(values_, std::vector<T>(new_capacity));
+    mask_ = new_capacity - 1;
+    block_shift_ = 64 - (std::countr_zero(new_capacity) - 3);
+
+    for (std::size_t i = 0; i < old_keys.size(); ++i) {
+      if (old_keys[i] == empty_key) { continue; }
+      std::size_t slot = home_slot(old_keys[i]);
+      while (keys_[slot] != empty_key) { slot = (slot + 1) & mask_; }
+      keys_[slot] = old_keys[i];
+      values_[slot] = std::move(old_values[i]);
+    }
+  }
+};
+
+#endif // VOXEL_GAME_TERRAIN_CHUNK_MAP_HPP
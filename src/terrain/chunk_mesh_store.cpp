@@ -0,0 +1,77 @@
+#include "chunk_mesh_store.hpp"
+
+#include <beyond/utils/assert.hpp>
+
+auto ChunkMeshStore::insert(const ChunkVertexCache& cache) -> ChunkHandle
+{
+  const auto dense_index = static_cast<std::uint32_t>(transforms_.size());
+  transforms_.push_back(cache.transform);
+  first_vertices_.push_back(cache.first_vertex);
+  vertex_counts_.push_back(cache.vertex_count);
+  first_indices_.push_back(cache.first_index);
+  index_counts_.push_back(cache.index_count);
+
+  std::uint32_t slot_index = first_free_slot_;
+  if (slot_index == ChunkHandle::invalid_index) {
+    slot_index = static_cast<std::uint32_t>(slots_.size());
+    slots_.emplace_back();
+  } else {
+    first_free_slot_ = slots_[slot_index].dense_index;
+  }
+  slot_indices_.push_back(slot_index);
+
+  Slot& slot = slots_[slot_index];
+  slot.dense_index = dense_index;
+  return ChunkHandle{.index = slot_index, .generation = slot.generation};
+}
+
+auto ChunkMeshStore::remove(ChunkHandle handle) -> ChunkVertexCache
+{
+  BEYOND_ENSURE(contains(handle));
+  const ChunkVertexCache removed = get(handle);
+
+  Slot& slot = slots_[handle.index];
+  const std::uint32_t dense_index = slot.dense_index;
+  const std::uint32_t last_index =
+      static_cast<std::uint32_t>(transforms_.size()) - 1;
+  if (dense_index != last_index) {
+    transforms_[dense_index] = transforms_[last_index];
+    first_vertices_[dense_index] = first_vertices_[last_index];
+    vertex_counts_[dense_index] = vertex_counts_[last_index];
+    first_indices_[dense_index] = first_indices_[last_index];
+    index_counts_[dense_index] = index_counts_[last_index];
+    slot_indices_[dense_index] = slot_indices_[last_index];
+    slots_[slot_indices_[dense_index]].dense_index = dense_index;
+  }
+  transforms_.pop_back();
+  first_vertices_.pop_back();
+  vertex_counts_.pop_back();
+  first_indices_.pop_back();
+  index_counts_.pop_back();
+  slot_indices_.pop_back();
+
+  // Invalidates every handle to the slot
+  ++slot.generation;
+  slot.dense_index = first_free_slot_;
+  first_free_slot_ = handle.index;
+  return removed;
+}
+
+auto ChunkMeshStore::contains(ChunkHandle handle) const -> bool
+{
+  if (handle.index >= slots_.size()) { return false; }
+  // Freeing a slot bumps its generation past every handle given out for it
+  return slots_[handle.index].generation == handle.generation;
+}
+
+auto ChunkMeshStore::get(ChunkHandle handle) const -> ChunkVertexCache
+{
+  const std::uint32_t dense_index = slots_[handle.index].dense_index;
+  return ChunkVertexCache{
+      .first_vertex = first_vertices_[dense_index],
+      .vertex_count = vertex_counts_[dense_index],
+      .first_index = first_indices_[dense_index],
+      .index_count = index_counts_[dense_index],
+      .transform = transforms_[dense_index],
+  };
+}
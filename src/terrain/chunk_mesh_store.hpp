@@ -0,0 +1,96 @@
+#ifndef VOXEL_GAME_TERRAIN_CHUNK_MESH_STORE_HPP
+#define VOXEL_GAME_TERRAIN_CHUNK_MESH_STORE_HPP
+
+#include <beyond/math/vector.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+struct ChunkVertexCache {
+  std::uint32_t first_vertex = 0; // Offset into the vertex heap
+  std::uint32_t vertex_count = 0;
+  std::uint32_t first_index = 0; // Offset into the index heap
+  std::uint32_t index_count = 0;
+  // x, y, z for the center of the chunk, w for the size of its cells, 2^lod
+  beyond::Vec4 transform;
+};
+
+// Refers to a chunk of a ChunkMeshStore. The generation tells apart the
+// chunks that successively use the same slot
+struct ChunkHandle {
+  static constexpr std::uint32_t invalid_index = ~0u;
+
+  std::uint32_t index = invalid_index;
+  std::uint32_t generation = 0;
+
+  [[nodiscard]] auto is_valid() const -> bool
+  {
+    return index != invalid_index;
+  }
+  friend auto operator==(ChunkHandle, ChunkHandle) -> bool = default;
+};
+
+// Slot map of the chunks that have a mesh in the heaps. Live chunks are packed
+// at the front of each array, in no particular order, so walking them touches
+// nothing else. Insertion and removal are O(1): removal moves the last chunk
+// into the hole and patches its slot
+class ChunkMeshStore {
+  struct Slot {
+    std::uint32_t dense_index = 0; // Next free slot while the slot is free
+    std::uint32_t generation = 0;
+  };
+
+  std::vector<Slot> slots_;
+  std::uint32_t first_free_slot_ = ChunkHandle::invalid_index;
+
+  // Indexed by dense index
+  std::vector<beyond::Vec4> transforms_;
+  std::vector<std::uint32_t> first_vertices_;
+  std::vector<std::uint32_t> vertex_counts_;
+  std::vector<std::uint32_t> first_indices_;
+  std::vector<std::uint32_t> index_counts_;
+  std::vector<std::uint32_t> slot_indices_;
+
+public:
+  [[nodiscard]] auto insert(const ChunkVertexCache& cache) -> ChunkHandle;
+  // `handle` needs to be alive. Returns the removed chunk, whose vertices and
+  // indices still need to be freed from the heaps
+  auto remove(ChunkHandle handle) -> ChunkVertexCache;
+
+  [[nodiscard]] auto contains(ChunkHandle handle) const -> bool;
+  // `handle` needs to be alive
+  [[nodiscard]] auto get(ChunkHandle handle) const -> ChunkVertexCache;
+
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return transforms_.size();
+  }
+  [[nodiscard]] auto empty() const -> bool
+  {
+    return transforms_.empty();
+  }
+
+  [[nodiscard]] auto transforms() const -> std::span<const beyond::Vec4>
+  {
+    return transforms_;
+  }
+  [[nodiscard]] auto first_vertices() const -> std::span<const std::uint32_t>
+  {
+    return first_vertices_;
+  }
+  [[nodiscard]] auto vertex_counts() const -> std::span<const std::uint32_t>
+  {
+    return vertex_counts_;
+  }
+  [[nodiscard]] auto first_indices() const -> std::span<const std::uint32_t>
+  {
+    return first_indices_;
+  }
+  [[nodiscard]] auto index_counts() const -> std::span<const std::uint32_t>
+  {
+    return index_counts_;
+  }
+};
+
+#endif // VOXEL_GAME_TERRAIN_CHUNK_MESH_STORE_HPP
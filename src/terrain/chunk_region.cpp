@@ -0,0 +1,77 @@
+#include "chunk_region.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+namespace {
+
+// Largest integer whose square is at most `value`
+[[nodiscard]] auto integer_sqrt(std::int64_t value) -> int
+{
+  auto root =
+      static_cast<std::int64_t>(std::sqrt(static_cast<double>(value)));
+  while (root * root > value) { --root; }
+  while ((root + 1) * (root + 1) <= value) { ++root; }
+  return static_cast<int>(root);
+}
+
+} // anonymous namespace
+
+auto load_shape_name(LoadShape shape) -> const char*
+{
+  switch (shape) {
+  case LoadShape::cube: return "cube";
+  case LoadShape::sphere: return "sphere";
+  case LoadShape::cylinder: return "cylinder";
+  }
+  return "unknown";
+}
+
+auto ChunkRegion::column(int x, int y) const -> ChunkSpan
+{
+  const int dx = std::abs(x - center.x);
+  const int dy = std::abs(y - center.y);
+  if (radius < 0 || vertical_radius < 0 || dx > radius ||
+      dy > vertical_radius) {
+    return {};
+  }
+
+  int half_extent = radius;
+  switch (shape) {
+  case LoadShape::cube: break;
+  case LoadShape::sphere: {
+    if (vertical_radius == 0) {
+      half_extent = integer_sqrt(std::int64_t{radius} * radius - dx * dx);
+      break;
+    }
+    // (dx^2 + dz^2) / radius^2 + dy^2 / vertical_radius^2 <= 1
+    const std::int64_t r2 = std::int64_t{radius} * radius;
+    const std::int64_t vr2 = std::int64_t{vertical_radius} * vertical_radius;
+    const std::int64_t scaled_dz2 =
+        r2 * vr2 - std::int64_t{dy} * dy * r2 - std::int64_t{dx} * dx * vr2;
+    if (scaled_dz2 < 0) { return {}; }
+    half_extent = integer_sqrt(scaled_dz2 / vr2);
+    break;
+  }
+  case LoadShape::cylinder:
+    half_extent = integer_sqrt(std::int64_t{radius} * radius - dx * dx);
+    break;
+  }
+  return {center.z - half_extent, center.z + half_extent};
+}
+
+auto ChunkRegion::chunk_count() const -> std::size_t
+{
+  std::size_t count = 0;
+  for (int x = center.x - radius; x <= center.x + radius; ++x) {
+    for (int y = center.y - vertical_radius; y <= center.y + vertical_radius;
+         ++y) {
+      const ChunkSpan span = column(x, y);
+      if (!span.empty()) {
+        count += static_cast<std::size_t>(span.last - span.first + 1);
+      }
+    }
+  }
+  return count;
+}
@@ -0,0 +1,83 @@
+#ifndef VOXEL_GAME_TERRAIN_CHUNK_REGION_HPP
+#define VOXEL_GAME_TERRAIN_CHUNK_REGION_HPP
+
+#include <beyond/math/vector.hpp>
+
+#include <cstddef>
+
+// Inclusive range of chunk coordinates, empty if `first > last`
+struct ChunkSpan {
+  int first = 0;
+  int last = -1;
+
+  [[nodiscard]] auto empty() const -> bool
+  {
+    return first > last;
+  }
+};
+
+enum class LoadShape {
+  cube,
+  sphere,   // An ellipsoid if the vertical radius differs
+  cylinder, // Vertical axis
+};
+
+[[nodiscard]] auto load_shape_name(LoadShape shape) -> const char*;
+
+// The chunks within `radius` chunks of the center horizontally and within
+// `vertical_radius` chunks vertically, in the given shape. Empty if a radius is
+// negative
+struct ChunkRegion {
+  beyond::IVec3 center{};
+  int radius = -1;
+  int vertical_radius = -1;
+  LoadShape shape = LoadShape::cube;
+
+  friend auto operator==(const ChunkRegion&, const ChunkRegion&)
+      -> bool = default;
+
+  // Chunks of the region in the column of chunks at (x, y). Every shape is
+  // convex, so a column holds a single span
+  [[nodiscard]] auto column(int x, int y) const -> ChunkSpan;
+
+  [[nodiscard]] auto contains(beyond::IVec3 position) const -> bool
+  {
+    const ChunkSpan span = column(position.x, position.y);
+    return span.first <= position.z && position.z <= span.last;
+  }
+
+  [[nodiscard]] auto chunk_count() const -> std::size_t;
+};
+
+// Calls `function(position)` for each chunk of `region` that is not in
+// `excluded`. Walks the columns of `region` and only touches the chunks of the
+// difference, so moving a region by one chunk costs O(radius^2)
+template <typename Function>
+void for_each_chunk_in_difference(const ChunkRegion& region,
+                                  const ChunkRegion& excluded,
+                                  Function&& function)
+{
+  const auto visit = [&](int x, int y, ChunkSpan span) {
+    for (int z = span.first; z <= span.last; ++z) {
+      function(beyond::IVec3{x, y, z});
+    }
+  };
+
+  for (int x = region.center.x - region.radius;
+       x <= region.center.x + region.radius; ++x) {
+    for (int y = region.center.y - region.vertical_radius;
+         y <= region.center.y + region.vertical_radius; ++y) {
+      const ChunkSpan span = region.column(x, y);
+      const ChunkSpan excluded_span = excluded.column(x, y);
+      if (excluded_span.empty() || excluded_span.last < span.first ||
+          excluded_span.first > span.last) {
+        visit(x, y, span);
+      } else {
+        visit(x, y, {span.first, excluded_span.first - 1});
+        visit(x, y, {excluded_span.last + 1, span.last});
+      }
+    }
+  }
+}
+
+#endif // VOXEL_GAME_TERRAIN_CHUNK_REGION_HPP
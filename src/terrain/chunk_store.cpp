@@ -0,0 +1,673 @@
+#include "chunk_store.hpp"
+
+#include <beyond/utils/panic.hpp>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <shared_mutex>
+#include <system_error>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Region files are written in the byte order of the host, which is little
+// endian on every platform the game runs on
+
+namespace {
+
+constexpr int region_dimension_log2 = 4;
+static_assert(1 << region_dimension_log2 == ChunkStore::region_dimension);
+constexpr std::size_t chunks_per_region =
+    ChunkStore::region_dimension * ChunkStore::region_dimension *
+    ChunkStore::region_dimension;
+
+constexpr std::array<char, 4> region_magic = {'V', 'X', 'R', 'G'};
+
+struct RegionEntry {
+  std::uint64_t offset = 0; // Zero if the chunk is not stored
+  std::uint32_t size = 0;
+  std::uint32_t transition_faces = 0;
+};
+static_assert(sizeof(RegionEntry) == 16);
+using RegionEntries = std::array<RegionEntry, chunks_per_region>;
+
+// The magic and the version, then the entries
+constexpr std::size_t region_entries_offset =
+    sizeof(region_magic) + sizeof(std::uint32_t);
+constexpr std::size_t region_header_size =
+    region_entries_offset + sizeof(RegionEntries);
+
+// Stale payloads below this are never worth compacting
+constexpr std::uint64_t min_compacted_bytes = 1024 * 1024;
+
+[[nodiscard]] auto region_of(ChunkKey chunk) -> ChunkKey
+{
+  return ChunkKey{.position = {chunk.position.x >> region_dimension_log2,
+                               chunk.position.y >> region_dimension_log2,
+                               chunk.position.z >> region_dimension_log2},
+                  .lod = chunk.lod};
+}
+
+[[nodiscard]] auto entry_index_of(ChunkKey chunk) -> std::size_t
+{
+  constexpr int mask = ChunkStore::region_dimension - 1;
+  return static_cast<std::size_t>(
+      ((chunk.position.z & mask) << (2 * region_dimension_log2)) |
+      ((chunk.position.y & mask) << region_dimension_log2) |
+      (chunk.position.x & mask));
+}
+
+[[nodiscard]] auto region_filename(ChunkKey region) -> std::string
+{
+  return fmt::format("{}.{}.{}.{}.region", region.lod, region.position.x,
+                     region.position.y, region.position.z);
+}
+
+[[nodiscard]] constexpr auto zigzag_encode(std::int32_t value) -> std::uint32_t
+{
+  return (static_cast<std::uint32_t>(value) << 1) ^
+         static_cast<std::uint32_t>(value >> 31);
+}
+
+[[nodiscard]] constexpr auto zigzag_decode(std::uint32_t value) -> std::int32_t
+{
+  return static_cast<std::int32_t>(value >> 1) ^
+         -static_cast<std::int32_t>(value & 1);
+}
+static_assert(zigzag_decode(zigzag_encode(-3)) == -3);
+static_assert(zigzag_encode(-1) == 1 && zigzag_encode(1) == 2);
+
+void write_varint(std::vector<std::byte>& bytes, std::uint32_t value)
+{
+  while (value >= 0x80) {
+    bytes.push_back(static_cast<std::byte>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  bytes.push_back(static_cast<std::byte>(value));
+}
+
+class VarintReader {
+  std::span<const std::byte> bytes_;
+  std::size_t position_ = 0;
+
+public:
+  explicit VarintReader(std::span<const std::byte> bytes) : bytes_{bytes} {}
+
+  [[nodiscard]] auto at_end() const -> bool
+  {
+    return position_ == bytes_.size();
+  }
+
+  // Returns nothing past the end or on an overlong encoding
+  [[nodiscard]] auto read() -> std::optional<std::uint32_t>
+  {
+    std::uint32_t value = 0;
+    for (int shift = 0; shift < 32; shift += 7) {
+      if (position_ == bytes_.size()) { return std::nullopt; }
+      const auto byte = static_cast<std::uint32_t>(bytes_[position_++]);
+      value |= (byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) { return value; }
+    }
+    return std::nullopt;
+  }
+};
+
+// A file read through a read-only memory mapping of all of it, and written
+// with positioned writes. The mapping only covers what the file held during
+// the last call to map()
+class MappedFile {
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int file_ = -1;
+#endif
+  const std::byte* data_ = nullptr;
+  std::size_t mapped_size_ = 0;
+  std::size_t size_ = 0;
+
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+  MappedFile(const MappedFile&) = delete;
+  auto operator=(const MappedFile&) & -> MappedFile& = delete;
+  MappedFile(MappedFile&&) noexcept = delete;
+  auto operator=(MappedFile&&) & noexcept -> MappedFile& = delete;
+
+  [[nodiscard]] auto size() const -> std::size_t
+  {
+    return size_;
+  }
+  [[nodiscard]] auto bytes() const -> std::span<const std::byte>
+  {
+    return {data_, mapped_size_};
+  }
+
+  // Creates the file if it does not exist
+  [[nodiscard]] auto open(const std::filesystem::path& path) -> bool;
+  void close();
+  [[nodiscard]] auto map() -> bool;
+  [[nodiscard]] auto write(std::size_t offset, std::span<const std::byte> bytes)
+      -> bool;
+
+private:
+  void unmap();
+};
+
+#ifdef _WIN32
+
+auto MappedFile::open(const std::filesystem::path& path) -> bool
+{
+  close();
+  file_ = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                      FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                      FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) { return false; }
+  LARGE_INTEGER size{};
+  if (!GetFileSizeEx(file_, &size)) {
+    close();
+    return false;
+  }
+  size_ = static_cast<std::size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::unmap()
+{
+  if (data_ != nullptr) { UnmapViewOfFile(data_); }
+  if (mapping_ != nullptr) { CloseHandle(mapping_); }
+  data_ = nullptr;
+  mapping_ = nullptr;
+  mapped_size_ = 0;
+}
+
+void MappedFile::close()
+{
+  unmap();
+  if (file_ != INVALID_HANDLE_VALUE) { CloseHandle(file_); }
+  file_ = INVALID_HANDLE_VALUE;
+  size_ = 0;
+}
+
+auto MappedFile::map() -> bool
+{
+  if (data_ != nullptr && mapped_size_ == size_) { return true; }
+  unmap();
+  if (size_ == 0) { return true; }
+  mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping_ == nullptr) { return false; }
+  data_ = static_cast<const std::byte*>(
+      MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+  if (data_ == nullptr) {
+    unmap();
+    return false;
+  }
+  mapped_size_ = size_;
+  return true;
+}
+
+auto MappedFile::write(std::size_t offset, std::span<const std::byte> bytes)
+    -> bool
+{
+  while (!bytes.empty()) {
+    OVERLAPPED overlapped{};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(
+        static_cast<std::uint64_t>(offset) >> 32);
+    const auto chunk_size = static_cast<DWORD>(
+        std::min<std::size_t>(bytes.size(), 1u << 30));
+    DWORD written = 0;
+    if (!WriteFile(file_, bytes.data(), chunk_size, &written, &overlapped) ||
+        written == 0) {
+      return false;
+    }
+    bytes = bytes.subspan(written);
+    offset += written;
+    size_ = std::max(size_, offset);
+  }
+  return true;
+}
+
+#else
+
+auto MappedFile::open(const std::filesystem::path& path) -> bool
+{
+  close();
+  file_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (file_ < 0) { return false; }
+  struct stat status {};
+  if (fstat(file_, &status) != 0) {
+    close();
+    return false;
+  }
+  size_ = static_cast<std::size_t>(status.st_size);
+  return true;
+}
+
+void MappedFile::unmap()
+{
+  if (data_ != nullptr) {
+    munmap(const_cast<std::byte*>(data_), mapped_size_);
+  }
+  data_ = nullptr;
+  mapped_size_ = 0;
+}
+
+void MappedFile::close()
+{
+  unmap();
+  if (file_ >= 0) { ::close(file_); }
+  file_ = -1;
+  size_ = 0;
+}
+
+auto MappedFile::map() -> bool
+{
+  if (data_ != nullptr && mapped_size_ == size_) { return true; }
+  unmap();
+  if (size_ == 0) { return true; }
+  void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_, 0);
+  if (data == MAP_FAILED) { return false; }
+  data_ = static_cast<const std::byte*>(data);
+  mapped_size_ = size_;
+  return true;
+}
+
+auto MappedFile::write(std::size_t offset, std::span<const std::byte> bytes)
+    -> bool
+{
+  while (!bytes.empty()) {
+    const ssize_t written = pwrite(file_, bytes.data(), bytes.size(),
+                                   static_cast<off_t>(offset));
+    if (written < 0 && errno == EINTR) { continue; }
+    if (written <= 0) { return false; }
+    bytes = bytes.subspan(static_cast<std::size_t>(written));
+    offset += static_cast<std::size_t>(written);
+    size_ = std::max(size_, offset);
+  }
+  return true;
+}
+
+#endif
+
+template <typename T>
+[[nodiscard]] auto as_bytes_of(const T& value) -> std::span<const std::byte>
+{
+  return std::as_bytes(std::span{&value, 1});
+}
+
+[[nodiscard]] auto entry_file_offset(std::size_t index) -> std::size_t
+{
+  return region_entries_offset + index * sizeof(RegionEntry);
+}
+
+} // anonymous namespace
+
+auto encode_chunk_mesh(const ChunkMesh& mesh) -> std::vector<std::byte>
+{
+  std::vector<std::byte> bytes;
+  // Most components differ by less than 2^13 from the previous vertex, and
+  // most indices by less than 2^6 from the previous index
+  bytes.reserve(10 + 8 * mesh.vertices.size() + 2 * mesh.indices.size());
+  write_varint(bytes, static_cast<std::uint32_t>(mesh.vertices.size()));
+  write_varint(bytes, static_cast<std::uint32_t>(mesh.indices.size()));
+
+  std::array<std::int32_t, 5> previous_components{};
+  for (const Vertex& vertex : mesh.vertices) {
+    const std::array<std::int32_t, 5> components = {
+        vertex.position[0], vertex.position[1], vertex.position[2],
+        vertex.normal[0], vertex.normal[1]};
+    for (std::size_t i = 0; i < components.size(); ++i) {
+      write_varint(bytes,
+                   zigzag_encode(components[i] - previous_components[i]));
+    }
+    previous_components = components;
+  }
+
+  std::int64_t previous_index = 0;
+  for (const std::uint32_t index : mesh.indices) {
+    const std::int64_t delta = std::int64_t{index} - previous_index;
+    write_varint(bytes, zigzag_encode(static_cast<std::int32_t>(delta)));
+    previous_index = index;
+  }
+  return bytes;
+}
+
+auto decode_chunk_mesh(std::span<const std::byte> bytes)
+    -> std::optional<ChunkMesh>
+{
+  VarintReader reader{bytes};
+  const std::optional<std::uint32_t> vertex_count = reader.read();
+  const std::optional<std::uint32_t> index_count = reader.read();
+  // Every vertex and index takes at least a byte
+  if (!vertex_count || !index_count ||
+      std::size_t{*vertex_count} * 5 + *index_count > bytes.size()) {
+    return std::nullopt;
+  }
+
+  ChunkMesh mesh;
+  mesh.vertices.resize(*vertex_count);
+  std::array<std::int32_t, 5> components{};
+  for (Vertex& vertex : mesh.vertices) {
+    for (std::size_t i = 0; i < components.size(); ++i) {
+      const std::optional<std::uint32_t> delta = reader.read();
+      if (!delta) { return std::nullopt; }
+      const std::int64_t component =
+          std::int64_t{components[i]} + zigzag_decode(*delta);
+      // Positions are unorm16 and normals snorm16
+      const bool is_position = i < 3;
+      if (component < (is_position ? 0 : INT16_MIN) ||
+          component > (is_position ? UINT16_MAX : INT16_MAX)) {
+        return std::nullopt;
+      }
+      components[i] = static_cast<std::int32_t>(component);
+    }
+    vertex = Vertex{
+        .position = {static_cast<std::uint16_t>(components[0]),
+                     static_cast<std::uint16_t>(components[1]),
+                     static_cast<std::uint16_t>(components[2]), 0},
+        .normal = {static_cast<std::int16_t>(components[3]),
+                   static_cast<std::int16_t>(components[4])}};
+  }
+
+  mesh.indices.resize(*index_count);
+  std::int64_t index = 0;
+  for (std::uint32_t& decoded : mesh.indices) {
+    const std::optional<std::uint32_t> delta = reader.read();
+    if (!delta) { return std::nullopt; }
+    index += zigzag_decode(*delta);
+    if (index < 0 || index >= *vertex_count) { return std::nullopt; }
+    decoded = static_cast<std::uint32_t>(index);
+  }
+  if (!reader.at_end()) { return std::nullopt; }
+  return mesh;
+}
+
+class ChunkStore::Region {
+public:
+  std::filesystem::path path;
+  // Shared by loads, exclusive for saves, which remap the file, and while the
+  // file is being opened
+  std::shared_mutex mutex;
+  // Regions are found before their file is opened, and stay closed if it does
+  // not exist yet or cannot be opened, until a save opens it
+  bool is_open = false;
+  MappedFile file;
+  RegionEntries entries{};
+  std::uint64_t live_bytes = 0; // Sum of the sizes of the entries
+  std::uint64_t last_use = 0;   // Guarded by ChunkStore::regions_mutex_
+
+  // Reads the entries of an existing region file, or writes those of an empty
+  // one. A file of another version is started over
+  [[nodiscard]] auto open() -> bool
+  {
+    is_open = open_file();
+    return is_open;
+  }
+
+  // Appends the payload, then points the entry to it, so that a crash in
+  // between leaves the previous payload in place
+  [[nodiscard]] auto save(std::size_t index, std::uint32_t transition_faces,
+                          std::span<const std::byte> payload) -> bool
+  {
+    const RegionEntry entry{.offset = file.size(),
+                            .size = static_cast<std::uint32_t>(payload.size()),
+                            .transition_faces = transition_faces};
+    if (!file.write(entry.offset, payload) ||
+        !file.write(entry_file_offset(index), as_bytes_of(entry))) {
+      return false;
+    }
+    live_bytes -= entries[index].size;
+    live_bytes += entry.size;
+    entries[index] = entry;
+    return file.map();
+  }
+
+  [[nodiscard]] auto stale_bytes() const -> std::uint64_t
+  {
+    return file.size() - region_header_size - live_bytes;
+  }
+
+  [[nodiscard]] auto needs_compaction() const -> bool
+  {
+    const std::uint64_t stale = stale_bytes();
+    return stale >= min_compacted_bytes && stale > live_bytes;
+  }
+
+  // Rewrites the file with the live payloads only, then swaps it in
+  [[nodiscard]] auto compact() -> bool
+  {
+    const std::span<const std::byte> old_bytes = file.bytes();
+    RegionEntries new_entries = entries;
+    std::vector<std::byte> new_bytes(region_header_size);
+    new_bytes.reserve(region_header_size + live_bytes);
+    std::memcpy(new_bytes.data(), old_bytes.data(), region_entries_offset);
+    for (RegionEntry& entry : new_entries) {
+      if (entry.offset == 0) { continue; }
+      const auto payload = old_bytes.subspan(entry.offset, entry.size);
+      entry.offset = new_bytes.size();
+      new_bytes.insert(new_bytes.end(), payload.begin(), payload.end());
+    }
+    std::memcpy(new_bytes.data() + region_entries_offset, new_entries.data(),
+                sizeof(new_entries));
+
+    std::filesystem::path compacted_path = path;
+    compacted_path += ".compacting";
+    {
+      MappedFile compacted;
+      std::error_code error;
+      std::filesystem::remove(compacted_path, error);
+      if (!compacted.open(compacted_path) ||
+          !compacted.write(0, new_bytes)) {
+        compacted.close();
+        std::filesystem::remove(compacted_path, error);
+        return false;
+      }
+    }
+
+    // The file needs to be closed before being replaced on Windows
+    file.close();
+    std::error_code error;
+    std::filesystem::rename(compacted_path, path, error);
+    const bool is_renamed = !error;
+    if (is_renamed) {
+      entries = new_entries;
+    } else {
+      std::filesystem::remove(compacted_path, error);
+    }
+    // Opened again by the next save if that fails
+    is_open = file.open(path) && file.map();
+    return is_open && is_renamed;
+  }
+
+private:
+  [[nodiscard]] auto open_file() -> bool
+  {
+    if (!file.open(path)) { return false; }
+    if (file.size() != 0) {
+      if (!file.map()) { return false; }
+      if (read_header()) { return true; }
+      // Left by another version, or cut short while being created
+      file.close();
+      std::error_code error;
+      std::filesystem::remove(path, error);
+      if (error || !file.open(path)) { return false; }
+    }
+
+    entries = {};
+    live_bytes = 0;
+    const std::uint32_t version = region_format_version;
+    std::vector<std::byte> header(region_header_size);
+    std::memcpy(header.data(), region_magic.data(), sizeof(region_magic));
+    std::memcpy(header.data() + sizeof(region_magic), &version,
+                sizeof(version));
+    return file.write(0, header) && file.map();
+  }
+
+  [[nodiscard]] auto read_header() -> bool
+  {
+    const std::span<const std::byte> bytes = file.bytes();
+    std::uint32_t version = 0;
+    if (bytes.size() < region_header_size ||
+        std::memcmp(bytes.data(), region_magic.data(), sizeof(region_magic)) !=
+            0) {
+      return false;
+    }
+    std::memcpy(&version, bytes.data() + sizeof(region_magic),
+                sizeof(version));
+    if (version != region_format_version) { return false; }
+
+    std::memcpy(entries.data(), bytes.data() + region_entries_offset,
+                sizeof(entries));
+    live_bytes = 0;
+    for (RegionEntry& entry : entries) {
+      // Written past the end of the file before a crash, or corrupted. Not
+      // checked with offset + size, which a corrupted offset can wrap around
+      if (entry.offset < region_header_size || entry.offset > bytes.size() ||
+          entry.size > bytes.size() - entry.offset) {
+        entry = {};
+      }
+      live_bytes += entry.size;
+    }
+    return true;
+  }
+};
+
+ChunkStore::ChunkStore(std::filesystem::path directory)
+    : directory_{std::move(directory)}
+{
+  std::error_code error;
+  std::filesystem::create_directories(directory_, error);
+  if (error) {
+    beyond::panic(fmt::format("Cannot create the chunk store directory {}: {}",
+                              directory_.string(), error.message()));
+  }
+}
+
+ChunkStore::~ChunkStore() = default;
+
+auto ChunkStore::find_region(ChunkKey chunk) -> std::shared_ptr<Region>
+{
+  const ChunkKey region_key = region_of(chunk);
+  std::shared_ptr<Region> region;
+  // Held while the file is opened, so that other threads finding the region
+  // wait for it without holding regions_mutex_
+  std::unique_lock<std::shared_mutex> opening;
+  // Closed after regions_mutex_ is released, as that unmaps their files
+  std::vector<std::shared_ptr<Region>> closed;
+  {
+    const std::scoped_lock lock{regions_mutex_};
+    ++region_use_count_;
+    if (const auto itr = regions_.find(region_key); itr != regions_.end()) {
+      itr->second->last_use = region_use_count_;
+      return itr->second;
+    }
+
+    region = std::make_shared<Region>();
+    region->path = directory_ / region_filename(region_key);
+    region->last_use = region_use_count_;
+    opening = std::unique_lock{region->mutex};
+
+    // Only regions no thread uses are closed, so that a file is never open
+    // twice. Past the limit while they all are
+    while (regions_.size() >= max_open_region_count) {
+      auto least_recently_used = regions_.end();
+      for (auto itr = regions_.begin(); itr != regions_.end(); ++itr) {
+        if (itr->second.use_count() == 1 &&
+            (least_recently_used == regions_.end() ||
+             itr->second->last_use < least_recently_used->second->last_use)) {
+          least_recently_used = itr;
+        }
+      }
+      if (least_recently_used == regions_.end()) { break; }
+      closed.push_back(std::move(least_recently_used->second));
+      regions_.erase(least_recently_used);
+    }
+    regions_.emplace(region_key, region);
+  }
+
+  if (std::filesystem::exists(region->path) && !region->open()) {
+    ++failure_count_;
+  }
+  return region;
+}
+
+auto ChunkStore::load(ChunkKey chunk, std::uint32_t transition_faces)
+    -> std::optional<ChunkMesh>
+{
+  std::optional<ChunkMesh> mesh;
+  const std::shared_ptr<Region> region = find_region(chunk);
+  if (const std::shared_lock lock{region->mutex}; region->is_open) {
+    const RegionEntry& entry = region->entries[entry_index_of(chunk)];
+    const std::span<const std::byte> bytes = region->file.bytes();
+    // The file is not mapped anymore if remapping it failed
+    if (entry.offset != 0 && entry.transition_faces == transition_faces &&
+        entry.offset <= bytes.size() &&
+        entry.size <= bytes.size() - entry.offset) {
+      mesh = decode_chunk_mesh(bytes.subspan(entry.offset, entry.size));
+    }
+  }
+  if (mesh) {
+    ++hit_count_;
+  } else {
+    ++miss_count_;
+  }
+  return mesh;
+}
+
+void ChunkStore::save(ChunkKey chunk, std::uint32_t transition_faces,
+                      const ChunkMesh& mesh)
+{
+  const std::vector<std::byte> payload = encode_chunk_mesh(mesh);
+
+  const std::shared_ptr<Region> region = find_region(chunk);
+  const std::scoped_lock lock{region->mutex};
+  // Creates the file of a new region
+  if (!region->is_open && !region->open()) {
+    ++failure_count_;
+    return;
+  }
+  if (!region->save(entry_index_of(chunk), transition_faces, payload)) {
+    ++failure_count_;
+    return;
+  }
+  ++saved_count_;
+  written_bytes_ += payload.size();
+
+  if (region->needs_compaction()) {
+    if (region->compact()) {
+      ++compaction_count_;
+    } else {
+      ++failure_count_;
+    }
+  }
+}
+
+auto ChunkStore::stats() const -> ChunkStoreStats
+{
+  return ChunkStoreStats{
+      .hit_count = hit_count_,
+      .miss_count = miss_count_,
+      .saved_count = saved_count_,
+      .written_bytes = written_bytes_,
+      .compaction_count = compaction_count_,
+      .failure_count = failure_count_,
+  };
+}
@@ -0,0 +1,101 @@
+#ifndef VOXEL_GAME_TERRAIN_CHUNK_STORE_HPP
+#define VOXEL_GAME_TERRAIN_CHUNK_STORE_HPP
+
+#include "chunk_key.hpp"
+#include "cpu_mesher.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// Compact encoding of a chunk mesh: vertex components and indices as zigzag
+// varints of their difference with the previous ones. The unused 4th position
+// component is not stored
+[[nodiscard]] auto encode_chunk_mesh(const ChunkMesh& mesh)
+    -> std::vector<std::byte>;
+// Returns nothing if the bytes are not a valid encoding
+[[nodiscard]] auto decode_chunk_mesh(std::span<const std::byte> bytes)
+    -> std::optional<ChunkMesh>;
+
+struct ChunkStoreStats {
+  std::uint64_t hit_count = 0;
+  std::uint64_t miss_count = 0;
+  std::uint64_t saved_count = 0;
+  std::uint64_t written_bytes = 0; // Payloads, since the start
+  std::uint64_t compaction_count = 0;
+  std::uint64_t failure_count = 0; // Region files that could not be used
+};
+
+// Persistent cache of chunk meshes on disk, so that chunks seen before are
+// not generated and meshed again. The chunks of a level are grouped into
+// region files of region_dimension^3 chunks. A region file starts with a table
+// of the offset and size of the payload of each of its chunks, and payloads
+// are appended to its end. A chunk saved again gets a new payload, and the
+// region is compacted once the stale payloads take more room than the live
+// ones. Loads decode the payloads straight from a read-only memory mapping of
+// the file
+//
+// Each chunk keeps the mesh of a single set of transition faces, the last one
+// saved. The files hold the output of the current terrain and mesher, and
+// region_format_version needs to change with them
+//
+// Can be used from any thread
+class ChunkStore {
+public:
+  static constexpr int region_dimension = 16;
+  static constexpr std::uint32_t region_format_version = 1;
+  // Least recently used regions no thread uses are closed past this
+  static constexpr std::size_t max_open_region_count = 64;
+
+  class Region;
+
+private:
+  std::filesystem::path directory_;
+
+  std::mutex regions_mutex_;
+  std::unordered_map<ChunkKey, std::shared_ptr<Region>> regions_;
+  std::uint64_t region_use_count_ = 0; // Guarded by regions_mutex_
+
+  std::atomic<std::uint64_t> hit_count_ = 0;
+  std::atomic<std::uint64_t> miss_count_ = 0;
+  std::atomic<std::uint64_t> saved_count_ = 0;
+  std::atomic<std::uint64_t> written_bytes_ = 0;
+  std::atomic<std::uint64_t> compaction_count_ = 0;
+  std::atomic<std::uint64_t> failure_count_ = 0;
+
+public:
+  // Creates the directory if needed
+  explicit ChunkStore(std::filesystem::path directory);
+  ~ChunkStore();
+  ChunkStore(const ChunkStore&) = delete;
+  auto operator=(const ChunkStore&) & -> ChunkStore& = delete;
+  ChunkStore(ChunkStore&&) noexcept = delete;
+  auto operator=(ChunkStore&&) & noexcept -> ChunkStore& = delete;
+
+  [[nodiscard]] auto directory() const -> const std::filesystem::path&
+  {
+    return directory_;
+  }
+
+  [[nodiscard]] auto load(ChunkKey chunk, std::uint32_t transition_faces)
+      -> std::optional<ChunkMesh>;
+  // Replaces the stored mesh of the chunk, if any
+  void save(ChunkKey chunk, std::uint32_t transition_faces,
+            const ChunkMesh& mesh);
+
+  [[nodiscard]] auto stats() const -> ChunkStoreStats;
+
+private:
+  // The one region of the chunk, opening its file if it exists. The file is
+  // opened outside regions_mutex_, under the exclusive lock of the region
+  [[nodiscard]] auto find_region(ChunkKey chunk) -> std::shared_ptr<Region>;
+};
+
+#endif // VOXEL_GAME_TERRAIN_CHUNK_STORE_HPP
@@ -0,0 +1,301 @@
+#include "chunk_volume.hpp"
+
+#include <beyond/utils/assert.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+constexpr int points_per_axis = ChunkDensityField::points_per_axis;
+constexpr int halo = ChunkDensityField::halo;
+constexpr std::size_t word_bits = 64;
+constexpr int max_quantized_density = 127;
+constexpr auto row_length = static_cast<std::size_t>(points_per_axis);
+constexpr std::size_t row_count = ChunkDensityField::point_count / row_length;
+// Row offsets of the rows saturated on either side of the isolevel
+constexpr std::uint16_t saturated_air_row = 0xffff;
+constexpr std::uint16_t saturated_solid_row = 0xfffe;
+static_assert(row_count < saturated_solid_row);
+// Companding of the quantized densities, as in mu-law audio: the step grows
+// with the magnitude, which keeps the small densities around the isolevel, and
+// so the vertex positions, precise. It is this one over the range of the
+// densities the mesher reads, and grows with the range past them so that the
+// step around the isolevel stays the same
+constexpr float surface_companding = 4096.f;
+
+// Strides of the points along x, y and z in ChunkDensityField::densities
+constexpr std::array<std::size_t, 3> point_strides = {
+    1, points_per_axis, points_per_axis * points_per_axis};
+
+[[nodiscard]] auto point_index(int x, int y, int z) -> std::size_t
+{
+  BEYOND_ENSURE(x >= -halo && x < points_per_axis - halo && y >= -halo &&
+                y < points_per_axis - halo && z >= -halo &&
+                z < points_per_axis - halo);
+  return ChunkDensityField::index_of(x, y, z);
+}
+
+[[nodiscard]] auto is_solid(float density) -> bool
+{
+  return density < 0.f;
+}
+
+// Fewest bits, among 0, 1, 2, 4, 8 and 16, to index a palette of that size
+[[nodiscard]] auto index_bits_for(std::size_t palette_size) -> int
+{
+  int bits = 0;
+  while ((std::size_t{1} << bits) < palette_size) {
+    bits = bits == 0 ? 1 : 2 * bits;
+  }
+  return bits;
+}
+
+// The points at the ends of the edges crossing the isolevel, and their
+// neighbors along each axis
+[[nodiscard]] auto find_surface_points(const std::vector<float>& densities)
+    -> std::vector<bool>
+{
+  std::vector<bool> ends(densities.size());
+  for (int z = 0; z < points_per_axis; ++z) {
+    for (int y = 0; y < points_per_axis; ++y) {
+      for (int x = 0; x < points_per_axis; ++x) {
+        const std::array<int, 3> point = {x, y, z};
+        const std::size_t index = ChunkDensityField::index_of(
+            x - halo, y - halo, z - halo);
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+          if (point[axis] + 1 == points_per_axis) { continue; }
+          const std::size_t other = index + point_strides[axis];
+          if (is_solid(densities[index]) != is_solid(densities[other])) {
+            ends[index] = true;
+            ends[other] = true;
+          }
+        }
+      }
+    }
+  }
+
+  std::vector<bool> marks = ends;
+  for (int z = 0; z < points_per_axis; ++z) {
+    for (int y = 0; y < points_per_axis; ++y) {
+      for (int x = 0; x < points_per_axis; ++x) {
+        const std::array<int, 3> point = {x, y, z};
+        const std::size_t index = ChunkDensityField::index_of(
+            x - halo, y - halo, z - halo);
+        if (!ends[index]) { continue; }
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+          if (point[axis] > 0) { marks[index - point_strides[axis]] = true; }
+          if (point[axis] + 1 < points_per_axis) {
+            marks[index + point_strides[axis]] = true;
+          }
+        }
+      }
+    }
+  }
+  return marks;
+}
+
+[[nodiscard]] auto quantize(float density, float inverse_scale,
+                            float companding) -> std::int8_t
+{
+  constexpr auto max_level = static_cast<float>(max_quantized_density);
+  const float magnitude = std::min(std::abs(density) * inverse_scale, 1.f);
+  auto level = static_cast<int>(std::lround(
+      max_level * std::log1p(companding * magnitude) / std::log1p(companding)));
+  // Keeps the side of the isolevel, which decides the triangles of the mesh
+  if (is_solid(density)) { level = -std::max(level, 1); }
+  return static_cast<std::int8_t>(level);
+}
+
+[[nodiscard]] auto dequantize(std::int8_t level, float scale, float companding)
+    -> float
+{
+  const auto magnitude = static_cast<float>(std::abs(level)) /
+                         static_cast<float>(max_quantized_density);
+  const float density =
+      std::expm1(magnitude * std::log1p(companding)) / companding * scale;
+  return level < 0 ? -density : density;
+}
+
+} // anonymous namespace
+
+auto ChunkVolume::from_density_field(const ChunkDensityField& field)
+    -> ChunkVolume
+{
+  const std::vector<float>& densities = field.densities;
+  const bool has_air = !std::ranges::all_of(densities, is_solid);
+  const bool has_rock = std::ranges::any_of(densities, is_solid);
+
+  ChunkVolume volume;
+  if (has_air && has_rock) {
+    volume.palette_ = {air_material, rock_material};
+    volume.repack(1);
+    for (std::size_t i = 0; i < densities.size(); ++i) {
+      if (is_solid(densities[i])) { volume.set_material_index(i, 1); }
+    }
+  } else if (has_rock) {
+    volume.palette_ = {rock_material};
+  }
+
+  float max_density = 0;
+  for (const float density : densities) {
+    max_density = std::max(max_density, std::abs(density));
+  }
+  // Every point saturates, so only the side of the isolevel is left
+  const bool is_saturated = std::ranges::all_of(densities, [](float density) {
+    return std::abs(density) >= max_exact_density;
+  });
+  if (max_density == 0) {
+    volume.uniform_density_ = 0;
+    return volume;
+  }
+  if (is_saturated && !(has_air && has_rock)) {
+    volume.uniform_density_ =
+        has_rock ? uniform_solid_density : uniform_air_density;
+    return volume;
+  }
+
+  // The mesher needs the points around the surface, and edits and physics
+  // those within max_exact_density
+  float max_surface_density = 0;
+  if (has_air && has_rock) {
+    const std::vector<bool> surface_points = find_surface_points(densities);
+    for (std::size_t i = 0; i < densities.size(); ++i) {
+      if (surface_points[i]) {
+        max_surface_density =
+            std::max(max_surface_density, std::abs(densities[i]));
+      }
+    }
+  }
+  volume.density_scale_ = std::max(
+      max_surface_density, std::min(max_density, max_exact_density));
+  BEYOND_ENSURE(volume.density_scale_ > 0);
+  volume.companding_ =
+      max_surface_density == 0
+          ? surface_companding
+          : surface_companding * volume.density_scale_ / max_surface_density;
+  const float inverse_scale = 1.f / volume.density_scale_;
+  volume.row_offsets_.resize(row_count);
+  std::array<std::int8_t, row_length> row{};
+  for (std::size_t r = 0; r < row_count; ++r) {
+    for (std::size_t x = 0; x < row_length; ++x) {
+      row[x] = quantize(densities[r * row_length + x], inverse_scale,
+                        volume.companding_);
+    }
+    const auto saturated = [&](int level) {
+      return std::ranges::all_of(row, [&](int v) { return v == level; });
+    };
+    if (saturated(max_quantized_density)) {
+      volume.row_offsets_[r] = saturated_air_row;
+    } else if (saturated(-max_quantized_density)) {
+      volume.row_offsets_[r] = saturated_solid_row;
+    } else {
+      volume.row_offsets_[r] =
+          static_cast<std::uint16_t>(volume.densities_.size() / row_length);
+      volume.densities_.insert(volume.densities_.end(), row.begin(),
+                               row.end());
+    }
+  }
+  volume.densities_.shrink_to_fit();
+  return volume;
+}
+
+auto ChunkVolume::to_density_field() const -> ChunkDensityField
+{
+  ChunkDensityField field;
+  if (has_uniform_density()) {
+    std::ranges::fill(field.densities, uniform_density_);
+    return field;
+  }
+  std::array<float, 256> levels{};
+  for (int level = -128; level < 128; ++level) {
+    levels[static_cast<std::size_t>(level + 128)] = dequantize(
+        static_cast<std::int8_t>(level), density_scale_, companding_);
+  }
+  for (std::size_t i = 0; i < point_count; ++i) {
+    field.densities[i] =
+        levels[static_cast<std::size_t>(quantized_density(i) + 128)];
+  }
+  return field;
+}
+
+auto ChunkVolume::density_at(int x, int y, int z) const -> float
+{
+  if (has_uniform_density()) { return uniform_density_; }
+  return dequantize(quantized_density(point_index(x, y, z)), density_scale_,
+                    companding_);
+}
+
+auto ChunkVolume::material_at(int x, int y, int z) const -> MaterialId
+{
+  return palette_[material_index(point_index(x, y, z))];
+}
+
+void ChunkVolume::set_material(int x, int y, int z, MaterialId material)
+{
+  const std::size_t point = point_index(x, y, z);
+  auto itr = std::ranges::find(palette_, material);
+  if (itr == palette_.end()) {
+    palette_.push_back(material);
+    const int bits = index_bits_for(palette_.size());
+    if (bits != bits_per_index_) { repack(bits); }
+    itr = palette_.end() - 1;
+  }
+  set_material_index(point,
+                     static_cast<std::uint32_t>(itr - palette_.begin()));
+}
+
+auto ChunkVolume::memory_bytes() const -> std::size_t
+{
+  return sizeof(*this) + palette_.capacity() * sizeof(MaterialId) +
+         packed_indices_.capacity() * sizeof(std::uint64_t) +
+         row_offsets_.capacity() * sizeof(std::uint16_t) +
+         densities_.capacity() * sizeof(std::int8_t);
+}
+
+auto ChunkVolume::quantized_density(std::size_t point) const -> std::int8_t
+{
+  const std::uint16_t offset = row_offsets_[point / row_length];
+  if (offset == saturated_air_row) { return max_quantized_density; }
+  if (offset == saturated_solid_row) { return -max_quantized_density; }
+  return densities_[std::size_t{offset} * row_length + point % row_length];
+}
+
+auto ChunkVolume::material_index(std::size_t point) const -> std::uint32_t
+{
+  if (bits_per_index_ == 0) { return 0; }
+  const auto bits = static_cast<std::size_t>(bits_per_index_);
+  const std::size_t bit = point * bits;
+  const std::uint64_t mask = (std::uint64_t{1} << bits) - 1;
+  return static_cast<std::uint32_t>(
+      (packed_indices_[bit / word_bits] >> (bit % word_bits)) & mask);
+}
+
+void ChunkVolume::set_material_index(std::size_t point, std::uint32_t index)
+{
+  if (bits_per_index_ == 0) { return; }
+  const auto bits = static_cast<std::size_t>(bits_per_index_);
+  const std::size_t bit = point * bits;
+  const std::uint64_t mask = ((std::uint64_t{1} << bits) - 1)
+                             << (bit % word_bits);
+  std::uint64_t& word = packed_indices_[bit / word_bits];
+  word = (word & ~mask) | ((std::uint64_t{index} << (bit % word_bits)) & mask);
+}
+
+void ChunkVolume::repack(int bits_per_index)
+{
+  std::vector<std::uint32_t> indices(point_count);
+  for (std::size_t i = 0; i < point_count; ++i) {
+    indices[i] = material_index(i);
+  }
+
+  bits_per_index_ = bits_per_index;
+  const std::size_t bit_count =
+      point_count * static_cast<std::size_t>(bits_per_index);
+  packed_indices_.assign((bit_count + word_bits - 1) / word_bits, 0);
+  packed_indices_.shrink_to_fit();
+  for (std::size_t i = 0; i < point_count; ++i) {
+    set_material_index(i, indices[i]);
+  }
+}
@@ -0,0 +1,94 @@
+#ifndef VOXEL_GAME_TERRAIN_CHUNK_VOLUME_HPP
+#define VOXEL_GAME_TERRAIN_CHUNK_VOLUME_HPP
+
+#include "cpu_mesher.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using MaterialId = std::uint16_t;
+inline constexpr MaterialId air_material = 0;
+// Everything below the isolevel of the generated terrain
+inline constexpr MaterialId rock_material = 1;
+
+// Resident voxel data of a chunk, over the lattice of ChunkDensityField, in a
+// fraction of its size
+//
+// Materials are indices into a palette of the distinct materials of the chunk,
+// bit-packed with as many bits as the palette needs, rounded up to a power of
+// two so that no index straddles two words. A chunk of a single material
+// stores no index
+//
+// Densities are quantized to 8 bits, logarithmically so that the step is finer
+// near the isolevel, over a range that holds the points the mesher reads (the
+// ends of the edges crossing the isolevel and their neighbors, which give the
+// normals) and every density within max_exact_density. Farther points
+// saturate but keep their side of the isolevel, so the mesh has the same
+// triangles. Rows of points along x that all saturate to the same level are
+// not stored, and a chunk whose points all saturate on the same side of the
+// isolevel stores a single density
+class ChunkVolume {
+  std::vector<MaterialId> palette_ = {air_material};
+  int bits_per_index_ = 0;
+  std::vector<std::uint64_t> packed_indices_; // Empty with a single material
+
+  // For each row of points along x, the index of its densities in
+  // densities_ or one of the saturated rows. Empty if the density is uniform
+  std::vector<std::uint16_t> row_offsets_;
+  std::vector<std::int8_t> densities_; // Rows that are not saturated
+  float density_scale_ = 0;            // Density of the largest level
+  float companding_ = 0;               // See quantize in chunk_volume.cpp
+  float uniform_density_ = uniform_air_density;
+
+public:
+  static constexpr std::size_t point_count = ChunkDensityField::point_count;
+  // Densities up to it are kept. It is the most a brush of TerrainEdits adds
+  // or removes, so farther points stay on their side after an edit
+  static constexpr float max_exact_density = 1.f;
+  // Densities of the chunks whose points all saturate on one side
+  static constexpr float uniform_air_density = max_exact_density;
+  static constexpr float uniform_solid_density = -max_exact_density;
+
+  // An empty chunk, all air
+  ChunkVolume() = default;
+
+  // Points are air above the isolevel and rock below, the generated terrain
+  // having no other material
+  [[nodiscard]] static auto from_density_field(const ChunkDensityField& field)
+      -> ChunkVolume;
+  [[nodiscard]] auto to_density_field() const -> ChunkDensityField;
+
+  // Coordinates are those of ChunkDensityField::at. True up to the
+  // quantization within max_exact_density, and saturated past it
+  [[nodiscard]] auto density_at(int x, int y, int z) const -> float;
+  [[nodiscard]] auto material_at(int x, int y, int z) const -> MaterialId;
+  // Adds the material to the palette, widening the indices if needed. Unused
+  // materials stay in the palette
+  void set_material(int x, int y, int z, MaterialId material);
+
+  [[nodiscard]] auto has_uniform_density() const -> bool
+  {
+    return row_offsets_.empty();
+  }
+  [[nodiscard]] auto palette_size() const -> std::size_t
+  {
+    return palette_.size();
+  }
+  [[nodiscard]] auto bits_per_material() const -> int
+  {
+    return bits_per_index_;
+  }
+  // Including the object itself
+  [[nodiscard]] auto memory_bytes() const -> std::size_t;
+
+private:
+  [[nodiscard]] auto quantized_density(std::size_t point) const
+      -> std::int8_t;
+  [[nodiscard]] auto material_index(std::size_t point) const -> std::uint32_t;
+  void set_material_index(std::size_t point, std::uint32_t index);
+  // Packs the indices again with `bits_per_index` bits each
+  void repack(int bits_per_index);
+};
+
+#endif // VOXEL_GAME_TERRAIN_CHUNK_VOLUME_HPP
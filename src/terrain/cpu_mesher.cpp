@@ -0,0 +1,805 @@
+#include "cpu_mesher.hpp"
+#include "marching_cube_tables.hpp"
+#include "transition_cell_tables.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VOXEL_GAME_DENSITY_AVX2
+#define VOXEL_GAME_DENSITY_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VOXEL_GAME_DENSITY_SSE2
+#endif
+
+namespace {
+
+// Lanes of floats. The noise below is written once against this interface and
+// instantiated for plain floats and for each SIMD width
+
+[[nodiscard]] inline auto lane_floor(float v) -> float
+{
+  return std::floor(v);
+}
+
+#ifdef VOXEL_GAME_DENSITY_SSE2
+struct Sse2Floats {
+  static constexpr std::size_t width = 4;
+  __m128 v;
+
+  explicit(false) Sse2Floats(float f) : v{_mm_set1_ps(f)} {}
+  explicit Sse2Floats(__m128 m) : v{m} {}
+
+  // x, x + step, x + 2 * step, x + 3 * step
+  [[nodiscard]] static auto iota(float x, float step) -> Sse2Floats
+  {
+    return Sse2Floats{_mm_add_ps(
+        _mm_set1_ps(x),
+        _mm_mul_ps(_mm_set1_ps(step), _mm_setr_ps(0.f, 1.f, 2.f, 3.f)))};
+  }
+  void store(float* out) const
+  {
+    _mm_storeu_ps(out, v);
+  }
+
+  friend auto operator+(Sse2Floats a, Sse2Floats b) -> Sse2Floats
+  {
+    return Sse2Floats{_mm_add_ps(a.v, b.v)};
+  }
+  friend auto operator-(Sse2Floats a, Sse2Floats b) -> Sse2Floats
+  {
+    return Sse2Floats{_mm_sub_ps(a.v, b.v)};
+  }
+  friend auto operator*(Sse2Floats a, Sse2Floats b) -> Sse2Floats
+  {
+    return Sse2Floats{_mm_mul_ps(a.v, b.v)};
+  }
+  // SSE2 has no rounding instruction: truncate, then step down the negative
+  // values that were rounded up. Exact for the magnitudes of the noise inputs
+  friend auto lane_floor(Sse2Floats a) -> Sse2Floats
+  {
+    const __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    const __m128 correction =
+        _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.f));
+    return Sse2Floats{_mm_sub_ps(truncated, correction)};
+  }
+};
+#endif
+
+#ifdef VOXEL_GAME_DENSITY_AVX2
+struct Avx2Floats {
+  static constexpr std::size_t width = 8;
+  __m256 v;
+
+  explicit(false) Avx2Floats(float f) : v{_mm256_set1_ps(f)} {}
+  explicit Avx2Floats(__m256 m) : v{m} {}
+
+  [[nodiscard]] static auto iota(float x, float step) -> Avx2Floats
+  {
+    return Avx2Floats{_mm256_add_ps(
+        _mm256_set1_ps(x),
+        _mm256_mul_ps(_mm256_set1_ps(step),
+                      _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f)))};
+  }
+  void store(float* out) const
+  {
+    _mm256_storeu_ps(out, v);
+  }
+
+  friend auto operator+(Avx2Floats a, Avx2Floats b) -> Avx2Floats
+  {
+    return Avx2Floats{_mm256_add_ps(a.v, b.v)};
+  }
+  friend auto operator-(Avx2Floats a, Avx2Floats b) -> Avx2Floats
+  {
+    return Avx2Floats{_mm256_sub_ps(a.v, b.v)};
+  }
+  friend auto operator*(Avx2Floats a, Avx2Floats b) -> Avx2Floats
+  {
+    return Avx2Floats{_mm256_mul_ps(a.v, b.v)};
+  }
+  friend auto lane_floor(Avx2Floats a) -> Avx2Floats
+  {
+    return Avx2Floats{_mm256_floor_ps(a.v)};
+  }
+};
+#endif
+
+// The functions below mirror terrain_common.glsl, including the order of the
+// operations. GLSL mix(x, y, a) is x * (1 - a) + y * a
+
+template <typename F> [[nodiscard]] auto fract(F x) -> F
+{
+  return x - lane_floor(x);
+}
+
+template <typename F> [[nodiscard]] auto mix(F x, F y, F a) -> F
+{
+  return x * (F(1.f) - a) + y * a;
+}
+
+template <typename F> [[nodiscard]] auto hash(F p) -> F
+{
+  p = fract(p * F(0.011f));
+  p = p * (p + F(7.5f));
+  p = p * (p + p);
+  return fract(p);
+}
+
+template <typename F> [[nodiscard]] auto perlin(F x, F y, F z) -> F
+{
+  const F ix = lane_floor(x);
+  const F iy = lane_floor(y);
+  const F iz = lane_floor(z);
+  const F fx = x - ix;
+  const F fy = y - iy;
+  const F fz = z - iz;
+
+  // dot(i, vec3(110, 241, 171))
+  const F n = ix * F(110.f) + iy * F(241.f) + iz * F(171.f);
+
+  const F ux = fx * fx * (F(3.f) - F(2.f) * fx);
+  const F uy = fy * fy * (F(3.f) - F(2.f) * fy);
+  const F uz = fz * fz * (F(3.f) - F(2.f) * fz);
+
+  return mix(mix(mix(hash(n), hash(n + F(110.f)), ux),
+                 mix(hash(n + F(241.f)), hash(n + F(351.f)), ux), uy),
+             mix(mix(hash(n + F(171.f)), hash(n + F(281.f)), ux),
+                 mix(hash(n + F(412.f)), hash(n + F(522.f)), ux), uy),
+             uz);
+}
+
+namespace fbm {
+
+constexpr int octave_count = 6;
+constexpr float frequency = 0.02f;
+constexpr float lacunarity = 2.0f;
+constexpr float gain = 0.5f;
+constexpr float first_amplitude = 0.5f;
+
+} // namespace fbm
+
+template <typename F> [[nodiscard]] auto fbm3(F x, F y, F z) -> F
+{
+  float amplitude = fbm::first_amplitude;
+  F v = F(0.f);
+  for (int i = 0; i < fbm::octave_count; ++i) {
+    v = v + F(amplitude) * perlin(F(fbm::frequency) * x, F(fbm::frequency) * y,
+                                  F(fbm::frequency) * z);
+    x = x * F(fbm::lacunarity);
+    y = y * F(fbm::lacunarity);
+    z = z * F(fbm::lacunarity);
+    amplitude *= fbm::gain;
+  }
+  return v;
+}
+
+constexpr float density_offset = 0.5f;
+constexpr float density_slope = 0.01f; // Along y
+
+// `noise` in terrain_common.glsl
+template <typename F> [[nodiscard]] auto density(F x, F y, F z) -> F
+{
+  return fbm3(x, y, z) - F(density_offset) - y * F(density_slope);
+}
+
+struct DensityBounds {
+  float min = 0;
+  float max = 0;
+};
+
+// Value noise is trilinear in the smoothstep of the position in its lattice
+// cell, which grows with the position. Over the part of a box in one cell, it
+// is thus between its values at the corners of that part, and always between
+// the hashes of the corners of the cell. The exact bounds are used over a few
+// cells, the bounds of the hashes over a few more, and the full range of the
+// hash over larger boxes
+[[nodiscard]] auto perlin_bounds(std::array<float, 3> min,
+                                 std::array<float, 3> max) -> DensityBounds
+{
+  constexpr float max_exact_cells_per_axis = 3;
+  constexpr float max_hashed_cells_per_axis = 7;
+  std::array<float, 3> first{};
+  std::array<float, 3> last{};
+  float cells_per_axis = 0;
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    first[axis] = lane_floor(min[axis]);
+    last[axis] = lane_floor(max[axis]);
+    cells_per_axis = std::max(cells_per_axis, last[axis] - first[axis] + 1.f);
+  }
+  if (cells_per_axis > max_hashed_cells_per_axis) {
+    return {.min = 0.f, .max = 1.f};
+  }
+
+  DensityBounds bounds{.min = 1.f, .max = 0.f};
+  const auto include = [&](float value) {
+    bounds.min = std::min(bounds.min, value);
+    bounds.max = std::max(bounds.max, value);
+  };
+  if (cells_per_axis > max_exact_cells_per_axis) {
+    for (float z = first[2]; z <= last[2] + 1.f; z += 1.f) {
+      for (float y = first[1]; y <= last[1] + 1.f; y += 1.f) {
+        for (float x = first[0]; x <= last[0] + 1.f; x += 1.f) {
+          // Same as the n + offset of perlin, integers being exact in floats
+          include(hash(x * 110.f + y * 241.f + z * 171.f));
+        }
+      }
+    }
+    return bounds;
+  }
+
+  for (float z = first[2]; z <= last[2]; z += 1.f) {
+    for (float y = first[1]; y <= last[1]; y += 1.f) {
+      for (float x = first[0]; x <= last[0]; x += 1.f) {
+        const std::array<float, 3> cell = {x, y, z};
+        std::array<float, 3> part_min{};
+        std::array<float, 3> part_max{};
+        for (std::size_t axis = 0; axis < 3; ++axis) {
+          part_min[axis] = std::max(min[axis], cell[axis]);
+          // Stays in the cell, whose noise is continuous with the next one
+          part_max[axis] =
+              std::min(max[axis], std::nextafter(cell[axis] + 1.f, 0.f));
+        }
+        for (int corner = 0; corner < 8; ++corner) {
+          const auto pick = [&](std::size_t axis) {
+            return ((corner >> axis) & 1) != 0 ? part_max[axis]
+                                               : part_min[axis];
+          };
+          include(perlin(pick(0), pick(1), pick(2)));
+        }
+      }
+    }
+  }
+  return bounds;
+}
+
+// Bounds of the density over the box from `min` to `max`, from the bounds of
+// each octave of fbm3
+[[nodiscard]] auto density_bounds(std::array<float, 3> min,
+                                  std::array<float, 3> max) -> DensityBounds
+{
+  DensityBounds bounds{.min = -density_offset - max[1] * density_slope,
+                       .max = -density_offset - min[1] * density_slope};
+  float amplitude = fbm::first_amplitude;
+  for (int i = 0; i < fbm::octave_count; ++i) {
+    const auto scaled = [](std::array<float, 3> p) {
+      return std::array{fbm::frequency * p[0], fbm::frequency * p[1],
+                        fbm::frequency * p[2]};
+    };
+    const DensityBounds octave = perlin_bounds(scaled(min), scaled(max));
+    bounds.min += amplitude * octave.min;
+    bounds.max += amplitude * octave.max;
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      min[axis] *= fbm::lacunarity;
+      max[axis] *= fbm::lacunarity;
+    }
+    amplitude *= fbm::gain;
+  }
+  return bounds;
+}
+
+template <typename F>
+auto evaluate_density_lanes(float x, float y, float z, float step,
+                            std::span<float> out, std::size_t first)
+    -> std::size_t
+{
+  std::size_t i = first;
+  for (; i + F::width <= out.size(); i += F::width) {
+    density(F::iota(x + step * static_cast<float>(i), step), F(y), F(z))
+        .store(&out[i]);
+  }
+  return i;
+}
+
+// Corners of a cell in the order of the marching cubes tables
+constexpr std::array<std::array<int, 3>, 8> corner_offsets = {{
+    {0, 0, 0},
+    {1, 0, 0},
+    {1, 1, 0},
+    {0, 1, 0},
+    {0, 0, 1},
+    {1, 0, 1},
+    {1, 1, 1},
+    {0, 1, 1},
+}};
+
+// Second corner of the owned x, y and z edges. The first one is corner 0
+constexpr std::array<int, 3> owned_edge_corners = {1, 3, 4};
+
+// For each cell edge: offset of the cell owning it, then axis of the edge
+constexpr std::array<std::array<int, 4>, 12> edge_owners = {{
+    {0, 0, 0, 0},
+    {1, 0, 0, 1},
+    {0, 1, 0, 0},
+    {0, 0, 0, 1},
+    {0, 0, 1, 0},
+    {1, 0, 1, 1},
+    {0, 1, 1, 0},
+    {0, 0, 1, 1},
+    {0, 0, 0, 2},
+    {1, 0, 0, 2},
+    {1, 1, 0, 2},
+    {0, 1, 0, 2},
+}};
+
+constexpr int chunk_dimension = ChunkDensityField::chunk_dimension;
+constexpr int half_chunk_dimension = chunk_dimension / 2;
+constexpr int owner_cells_per_axis = chunk_dimension + 1;
+
+[[nodiscard]] constexpr auto linear_cell_index(int x, int y, int z)
+    -> std::size_t
+{
+  return static_cast<std::size_t>(
+      (z * owner_cells_per_axis + y) * owner_cells_per_axis + x);
+}
+
+[[nodiscard]] auto cube_index(const ChunkDensityField& field, int x, int y,
+                              int z) -> std::uint32_t
+{
+  std::uint32_t cubeindex = 0;
+  for (std::uint32_t i = 0; i < 8; ++i) {
+    const auto& offset = corner_offsets[i];
+    if (field.at(x + offset[0], y + offset[1], z + offset[2]) < 0.f) {
+      cubeindex |= 1u << i;
+    }
+  }
+  return cubeindex;
+}
+
+[[nodiscard]] auto owned_edge_mask(std::uint32_t cubeindex,
+                                   const std::array<int, 3>& cell)
+    -> std::uint32_t
+{
+  std::uint32_t mask = 0;
+  for (std::uint32_t axis = 0; axis < 3; ++axis) {
+    const auto other_corner =
+        static_cast<std::uint32_t>(owned_edge_corners[axis]);
+    const bool intersected = ((cubeindex ^ (cubeindex >> other_corner)) & 1u) != 0u;
+    if (intersected && cell[axis] < chunk_dimension) { mask |= 1u << axis; }
+  }
+  return mask;
+}
+
+[[nodiscard]] auto triangle_count(std::uint32_t cubeindex) -> std::uint32_t
+{
+  std::uint32_t count = 0;
+  while (count < 5 && tri_table[cubeindex][count * 3] != -1) { ++count; }
+  return count;
+}
+
+[[nodiscard]] auto edge_intersection(float isolevel, float valp1, float valp2)
+    -> float
+{
+  if (std::abs(isolevel - valp1) < 0.00001f) { return 0; }
+  if (std::abs(isolevel - valp2) < 0.00001f) { return 1; }
+  if (std::abs(valp1 - valp2) < 0.00001f) { return 0; }
+  return (isolevel - valp1) / (valp2 - valp1);
+}
+
+[[nodiscard]] auto density_gradient(const ChunkDensityField& field, int x,
+                                    int y, int z) -> std::array<float, 3>
+{
+  return {field.at(x + 1, y, z) - field.at(x - 1, y, z),
+          field.at(x, y + 1, z) - field.at(x, y - 1, z),
+          field.at(x, y, z + 1) - field.at(x, y, z - 1)};
+}
+
+struct EdgeVertex {
+  std::array<float, 3> position; // Relative to the center of the chunk
+  std::array<float, 3> normal;
+};
+
+// Where the surface crosses the edge between two lattice points, given the
+// value and gradient at the first one
+[[nodiscard]] auto interpolate_edge(const ChunkDensityField& field,
+                                    const std::array<int, 3>& first_corner,
+                                    float first_value,
+                                    const std::array<float, 3>& first_gradient,
+                                    const std::array<int, 3>& other_corner)
+    -> EdgeVertex
+{
+  const auto [ox, oy, oz] = other_corner;
+  const float t = edge_intersection(0.f, first_value, field.at(ox, oy, oz));
+  const auto other_gradient = density_gradient(field, ox, oy, oz);
+
+  EdgeVertex vertex{};
+  float length_squared = 0;
+  for (std::size_t i = 0; i < 3; ++i) {
+    vertex.position[i] =
+        mix(static_cast<float>(first_corner[i] - half_chunk_dimension),
+            static_cast<float>(other_corner[i] - half_chunk_dimension), t);
+    // Points away from the solid side
+    vertex.normal[i] = -mix(first_gradient[i], other_gradient[i], t);
+    length_squared += vertex.normal[i] * vertex.normal[i];
+  }
+  const float inverse_length = 1.f / std::sqrt(length_squared);
+  for (float& n : vertex.normal) { n *= inverse_length; }
+  return vertex;
+}
+
+// Squeezes the outermost cells along the faces with transition cells into
+// 1 - transition_cell_width of their width, towards the inside of the chunk
+[[nodiscard]] auto squeeze_for_transition_cells(std::array<float, 3> position,
+                                                std::uint32_t transition_faces)
+    -> std::array<float, 3>
+{
+  constexpr auto inner_extent = static_cast<float>(half_chunk_dimension - 1);
+  for (int face = 0; face < chunk_face_count; ++face) {
+    if ((transition_faces & (1u << face)) == 0u) { continue; }
+    float& coordinate = position[static_cast<std::size_t>(face / 2)];
+    const float direction = face % 2 == 0 ? -1.f : 1.f;
+    // From 0 to 1 across the outermost cell
+    const float depth = direction * coordinate - inner_extent;
+    if (depth > 0) {
+      coordinate =
+          direction * (inner_extent + depth * (1 - transition_cell_width));
+    }
+  }
+  return position;
+}
+
+// Index of the vertex of the intersected edge along `axis` from the corner 0 of
+// the owner cell `cell`
+[[nodiscard]] auto
+owned_vertex_index(std::span<const std::uint32_t> edge_masks,
+                   std::span<const std::uint32_t> vertex_offsets,
+                   const std::array<int, 3>& cell, int axis) -> std::uint32_t
+{
+  const std::size_t owner_cell = linear_cell_index(cell[0], cell[1], cell[2]);
+  const std::uint32_t preceding_edges =
+      edge_masks[owner_cell] & ((1u << static_cast<std::uint32_t>(axis)) - 1u);
+  return vertex_offsets[owner_cell] +
+         static_cast<std::uint32_t>(std::popcount(preceding_edges));
+}
+
+// Appends the transition cells along a face, which need the vertices of the
+// regular cells to be already emitted. The vertices of the transition cells on
+// the fine side are those of the regular cells, and the ones on the coarse
+// side, on the face itself, are not squeezed
+void add_transition_cells(const ChunkDensityField& field, int face,
+                          std::span<const std::uint32_t> edge_masks,
+                          std::span<const std::uint32_t> vertex_offsets,
+                          ChunkMesh& mesh)
+{
+  constexpr int cells_per_axis = chunk_dimension / 2;
+  constexpr int corners_per_axis = cells_per_axis + 1;
+  constexpr std::uint32_t no_vertex = ~0u;
+
+  const int normal_axis = face / 2;
+  const int u_axis = (normal_axis + 1) % 3;
+  const int v_axis = (normal_axis + 2) % 3;
+  // The (u, v, t) frame is mirrored on the negative faces, and so is the
+  // winding of the triangles
+  const bool is_mirrored = face % 2 == 0;
+  const int face_coordinate = is_mirrored ? 0 : chunk_dimension;
+
+  const auto& cases = transition_cell_cases();
+  // Vertex of each intersected edge of the coarse side, indexed by direction
+  // then by first corner, so that neighboring transition cells share them
+  std::vector<std::uint32_t> coarse_vertices(
+      static_cast<std::size_t>(2 * corners_per_axis * corners_per_axis),
+      no_vertex);
+
+  for (int b = 0; b < cells_per_axis; ++b) {
+    for (int a = 0; a < cells_per_axis; ++a) {
+      const auto sample_point = [&](int sample) {
+        std::array<int, 3> point{};
+        point[static_cast<std::size_t>(normal_axis)] = face_coordinate;
+        point[static_cast<std::size_t>(u_axis)] = 2 * a + sample % 3;
+        point[static_cast<std::size_t>(v_axis)] = 2 * b + sample / 3;
+        return point;
+      };
+
+      std::uint32_t case_index = 0;
+      for (int sample = 0; sample < transition_cell_sample_count; ++sample) {
+        const auto [x, y, z] = sample_point(sample);
+        if (field.at(x, y, z) < 0.f) { case_index |= 1u << sample; }
+      }
+      const TransitionCellCase& cell_case = cases[case_index];
+
+      const auto vertex_of = [&](const TransitionCellEdge& edge) {
+        const std::array<int, 3> first = sample_point(edge.first_sample);
+        const bool is_along_u = edge.second_sample - edge.first_sample ==
+                                (edge.is_coarse ? 2 : 1);
+        if (!edge.is_coarse) {
+          return owned_vertex_index(edge_masks, vertex_offsets, first,
+                                    is_along_u ? u_axis : v_axis);
+        }
+
+        const int corner_u = a + edge.first_sample % 3 / 2;
+        const int corner_v = b + edge.first_sample / 6;
+        std::uint32_t& vertex = coarse_vertices[static_cast<std::size_t>(
+            ((is_along_u ? 0 : 1) * corners_per_axis + corner_v) *
+                corners_per_axis +
+            corner_u)];
+        if (vertex == no_vertex) {
+          const auto [x, y, z] = first;
+          const auto [position, normal] = interpolate_edge(
+              field, first, field.at(x, y, z), density_gradient(field, x, y, z),
+              sample_point(edge.second_sample));
+          vertex = static_cast<std::uint32_t>(mesh.vertices.size());
+          mesh.vertices.push_back(
+              vertex_packing::pack_vertex(position, normal));
+        }
+        return vertex;
+      };
+
+      for (int i = 0; i < 3 * cell_case.triangle_count; i += 3) {
+        std::array<std::uint32_t, 3> triangle{};
+        for (std::size_t j = 0; j < 3; ++j) {
+          const std::uint8_t edge =
+              cell_case.edges[static_cast<std::size_t>(i) + j];
+          triangle[j] = vertex_of(transition_cell_edges[edge]);
+        }
+        if (is_mirrored) { std::swap(triangle[1], triangle[2]); }
+        mesh.indices.insert(mesh.indices.end(), triangle.begin(),
+                            triangle.end());
+      }
+    }
+  }
+}
+
+} // anonymous namespace
+
+auto terrain_density(float x, float y, float z) -> float
+{
+  return density(x, y, z);
+}
+
+auto classify_chunk(ChunkKey chunk) -> ChunkContents
+{
+  // The lattice points of generate_density_field
+  const int scale = chunk.scale();
+  const auto extent = [scale](int chunk_coordinate) {
+    const int first =
+        chunk_origin(chunk_coordinate, scale) - scale * ChunkDensityField::halo;
+    return std::array{static_cast<float>(first),
+                      static_cast<float>(
+                          first + scale * (ChunkDensityField::points_per_axis -
+                                           1))};
+  };
+  const auto [min_x, max_x] = extent(chunk.position.x);
+  const auto [min_y, max_y] = extent(chunk.position.y);
+  const auto [min_z, max_z] = extent(chunk.position.z);
+
+  // Covers the rounding of the noise, and the fused operations of the shaders
+  constexpr float margin = 1e-3f;
+  const DensityBounds bounds =
+      density_bounds({min_x, min_y, min_z}, {max_x, max_y, max_z});
+  if (bounds.min >= margin) { return ChunkContents::air; }
+  if (bounds.max < -margin) { return ChunkContents::solid; }
+  return ChunkContents::mixed;
+}
+
+void evaluate_density_row(float x, float y, float z, float step,
+                          std::span<float> densities)
+{
+  std::size_t i = 0;
+#ifdef VOXEL_GAME_DENSITY_AVX2
+  i = evaluate_density_lanes<Avx2Floats>(x, y, z, step, densities, i);
+#endif
+#ifdef VOXEL_GAME_DENSITY_SSE2
+  i = evaluate_density_lanes<Sse2Floats>(x, y, z, step, densities, i);
+#endif
+  for (; i < densities.size(); ++i) {
+    densities[i] = density(x + step * static_cast<float>(i), y, z);
+  }
+}
+
+auto density_instruction_set() -> const char*
+{
+#if defined(VOXEL_GAME_DENSITY_AVX2)
+  return "AVX2";
+#elif defined(VOXEL_GAME_DENSITY_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+auto generate_density_field(ChunkKey chunk) -> ChunkDensityField
+{
+  constexpr int halo = ChunkDensityField::halo;
+  constexpr int points_per_axis = ChunkDensityField::points_per_axis;
+
+  // Lattice points are one cell apart, and cells are `scale` apart
+  const int scale = chunk.scale();
+  const auto origin = [scale](int chunk_coordinate) {
+    return static_cast<float>(chunk_origin(chunk_coordinate, scale) -
+                              scale * halo);
+  };
+  const float origin_x = origin(chunk.position.x);
+  const float origin_y = origin(chunk.position.y);
+  const float origin_z = origin(chunk.position.z);
+  const auto step = static_cast<float>(scale);
+
+  ChunkDensityField field;
+  for (int z = 0; z < points_per_axis; ++z) {
+    for (int y = 0; y < points_per_axis; ++y) {
+      const std::span<float> row{
+          field.densities.data() +
+              ChunkDensityField::index_of(-halo, y - halo, z - halo),
+          static_cast<std::size_t>(points_per_axis)};
+      evaluate_density_row(origin_x, origin_y + step * static_cast<float>(y),
+                           origin_z + step * static_cast<float>(z), step, row);
+    }
+  }
+  return field;
+}
+
+auto mesh_density_field(const ChunkDensityField& field,
+                        std::uint32_t transition_faces) -> ChunkMesh
+{
+  // Count pass and scan: vertex and index offsets of each owner cell
+  constexpr std::size_t owner_cell_count = static_cast<std::size_t>(
+      owner_cells_per_axis * owner_cells_per_axis * owner_cells_per_axis);
+  std::vector<std::uint32_t> cube_indices(owner_cell_count);
+  std::vector<std::uint32_t> edge_masks(owner_cell_count);
+  std::vector<std::uint32_t> vertex_offsets(owner_cell_count);
+  std::vector<std::uint32_t> index_offsets(owner_cell_count);
+
+  std::uint32_t vertex_count = 0;
+  std::uint32_t index_count = 0;
+  for (int z = 0; z < owner_cells_per_axis; ++z) {
+    for (int y = 0; y < owner_cells_per_axis; ++y) {
+      for (int x = 0; x < owner_cells_per_axis; ++x) {
+        const std::size_t cell = linear_cell_index(x, y, z);
+        const std::uint32_t cubeindex = cube_index(field, x, y, z);
+        const bool is_inner_cell = x < chunk_dimension &&
+                                   y < chunk_dimension && z < chunk_dimension;
+
+        cube_indices[cell] = cubeindex;
+        edge_masks[cell] = owned_edge_mask(cubeindex, {x, y, z});
+        vertex_offsets[cell] = vertex_count;
+        index_offsets[cell] = index_count;
+        vertex_count +=
+            static_cast<std::uint32_t>(std::popcount(edge_masks[cell]));
+        if (is_inner_cell) { index_count += triangle_count(cubeindex) * 3; }
+      }
+    }
+  }
+
+  // Emit pass
+  ChunkMesh mesh;
+  mesh.vertices.resize(vertex_count);
+  mesh.indices.resize(index_count);
+  for (int z = 0; z < owner_cells_per_axis; ++z) {
+    for (int y = 0; y < owner_cells_per_axis; ++y) {
+      for (int x = 0; x < owner_cells_per_axis; ++x) {
+        const std::size_t cell = linear_cell_index(x, y, z);
+        const std::uint32_t edge_mask = edge_masks[cell];
+
+        std::uint32_t vertex_index = vertex_offsets[cell];
+        if (edge_mask != 0) {
+          const float first_value = field.at(x, y, z);
+          const auto first_gradient = density_gradient(field, x, y, z);
+          for (std::uint32_t axis = 0; axis < 3; ++axis) {
+            if ((edge_mask & (1u << axis)) == 0u) { continue; }
+
+            const auto& offset = corner_offsets[static_cast<std::size_t>(
+                owned_edge_corners[axis])];
+            auto [position, normal] = interpolate_edge(
+                field, {x, y, z}, first_value, first_gradient,
+                {x + offset[0], y + offset[1], z + offset[2]});
+            if (transition_faces != 0) {
+              position =
+                  squeeze_for_transition_cells(position, transition_faces);
+            }
+            mesh.vertices[vertex_index++] =
+                vertex_packing::pack_vertex(position, normal);
+          }
+        }
+
+        if (x >= chunk_dimension || y >= chunk_dimension ||
+            z >= chunk_dimension) {
+          continue;
+        }
+
+        const std::uint32_t cubeindex = cube_indices[cell];
+        const std::uint32_t first_index = index_offsets[cell];
+        for (std::uint32_t i = 0; tri_table[cubeindex][i] != -1; ++i) {
+          const auto& owner = edge_owners[static_cast<std::size_t>(
+              tri_table[cubeindex][i])];
+          mesh.indices[first_index + i] = owned_vertex_index(
+              edge_masks, vertex_offsets,
+              {x + owner[0], y + owner[1], z + owner[2]}, owner[3]);
+        }
+      }
+    }
+  }
+
+  for (int face = 0; face < chunk_face_count; ++face) {
+    if ((transition_faces & (1u << face)) != 0u) {
+      add_transition_cells(field, face, edge_masks, vertex_offsets, mesh);
+    }
+  }
+  return mesh;
+}
+
+auto mesh_density_cells(const ChunkDensityField& field,
+                        std::array<int, 3> first_cell, int cell_count)
+    -> ChunkMesh
+{
+  // Owner cells one past the box own the vertices on its max faces, but not
+  // their edges that leave the box
+  const int owner_count = cell_count + 1;
+  const auto local_index = [owner_count](int x, int y, int z) {
+    return static_cast<std::size_t>((z * owner_count + y) * owner_count + x);
+  };
+  const auto owner_cell_count = static_cast<std::size_t>(
+      owner_count * owner_count * owner_count);
+  std::vector<std::uint32_t> edge_masks(owner_cell_count);
+  std::vector<std::uint32_t> vertex_offsets(owner_cell_count);
+  std::vector<std::uint32_t> cube_indices(owner_cell_count);
+
+  ChunkMesh mesh;
+  for (int z = 0; z < owner_count; ++z) {
+    for (int y = 0; y < owner_count; ++y) {
+      for (int x = 0; x < owner_count; ++x) {
+        const std::array<int, 3> local = {x, y, z};
+        const std::array<int, 3> cell = {first_cell[0] + x,
+                                         first_cell[1] + y,
+                                         first_cell[2] + z};
+        const std::uint32_t cubeindex =
+            cube_index(field, cell[0], cell[1], cell[2]);
+        std::uint32_t edge_mask = owned_edge_mask(cubeindex, cell);
+        for (std::uint32_t axis = 0; axis < 3; ++axis) {
+          if (local[axis] == cell_count) { edge_mask &= ~(1u << axis); }
+        }
+        const std::size_t index = local_index(x, y, z);
+        cube_indices[index] = cubeindex;
+        edge_masks[index] = edge_mask;
+        vertex_offsets[index] =
+            static_cast<std::uint32_t>(mesh.vertices.size());
+        if (edge_mask == 0) { continue; }
+
+        const float first_value = field.at(cell[0], cell[1], cell[2]);
+        const auto first_gradient =
+            density_gradient(field, cell[0], cell[1], cell[2]);
+        for (std::uint32_t axis = 0; axis < 3; ++axis) {
+          if ((edge_mask & (1u << axis)) == 0u) { continue; }
+          const auto& offset = corner_offsets[static_cast<std::size_t>(
+              owned_edge_corners[axis])];
+          const auto [position, normal] = interpolate_edge(
+              field, cell, first_value, first_gradient,
+              {cell[0] + offset[0], cell[1] + offset[1], cell[2] + offset[2]});
+          mesh.vertices.push_back(
+              vertex_packing::pack_vertex(position, normal));
+        }
+      }
+    }
+  }
+
+  for (int z = 0; z < cell_count; ++z) {
+    for (int y = 0; y < cell_count; ++y) {
+      for (int x = 0; x < cell_count; ++x) {
+        const std::uint32_t cubeindex = cube_indices[local_index(x, y, z)];
+        for (std::uint32_t i = 0; tri_table[cubeindex][i] != -1; ++i) {
+          const auto& owner = edge_owners[static_cast<std::size_t>(
+              tri_table[cubeindex][i])];
+          const std::size_t owner_cell =
+              local_index(x + owner[0], y + owner[1], z + owner[2]);
+          const std::uint32_t preceding_edges =
+              edge_masks[owner_cell] &
+              ((1u << static_cast<std::uint32_t>(owner[3])) - 1u);
+          mesh.indices.push_back(
+              vertex_offsets[owner_cell] +
+              static_cast<std::uint32_t>(std::popcount(preceding_edges)));
+        }
+      }
+    }
+  }
+  return mesh;
+}
+
+auto mesh_chunk_on_cpu(ChunkKey chunk, std::uint32_t transition_faces)
+    -> ChunkMesh
+{
+  return mesh_density_field(generate_density_field(chunk), transition_faces);
+}
@@ -0,0 +1,119 @@
+#ifndef VOXEL_GAME_TERRAIN_CPU_MESHER_HPP
+#define VOXEL_GAME_TERRAIN_CPU_MESHER_HPP
+
+#include "../vertex.hpp"
+#include "chunk_key.hpp"
+
+#include <beyond/math/vector.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// CPU implementation of the meshing passes of terrain_*.comp.glsl. It performs
+// the same float operations in the same order as the shaders, so its output
+// matches the GPU one up to the precision of the GPU transcendental and fused
+// operations
+
+// Densities of the lattice points of a chunk, with the same extent and halo
+// as the density field of the density pass
+struct ChunkDensityField {
+  static constexpr int chunk_dimension = 32; // Same as ChunkManager's
+  static constexpr int halo = 1;
+  // Corners of the 33 owner cells per axis, plus the halo on each side
+  static constexpr int points_per_axis = chunk_dimension + 2 + 2 * halo;
+  static constexpr std::size_t point_count = static_cast<std::size_t>(
+      points_per_axis * points_per_axis * points_per_axis);
+
+  std::vector<float> densities = std::vector<float>(point_count);
+
+  // Coordinates are relative to the first corner of the chunk and range from
+  // -halo to points_per_axis - halo - 1
+  [[nodiscard]] static constexpr auto index_of(int x, int y, int z)
+      -> std::size_t
+  {
+    return static_cast<std::size_t>(
+        ((z + halo) * points_per_axis + (y + halo)) * points_per_axis +
+        (x + halo));
+  }
+
+  [[nodiscard]] auto at(int x, int y, int z) const -> float
+  {
+    return densities[index_of(x, y, z)];
+  }
+};
+
+// World coordinate of the first corner of a chunk along an axis. Chunks of
+// level 0 are centered on multiples of the chunk dimension, and a chunk of any
+// level starts where its first child starts. Cells are `scale` apart
+[[nodiscard]] constexpr auto chunk_origin(int chunk_coordinate, int scale)
+    -> int
+{
+  constexpr int dimension = ChunkDensityField::chunk_dimension;
+  return dimension * scale * chunk_coordinate - dimension / 2;
+}
+
+// Welded mesh of a chunk laid out exactly like the output of the meshing
+// shaders: vertices in owner cell order, indices relative to the first vertex.
+// The vertices and triangles of transition cells, which the shaders do not
+// generate, come after those of the regular cells
+struct ChunkMesh {
+  std::vector<Vertex> vertices;
+  std::vector<std::uint32_t> indices;
+};
+
+// The terrain density at a point in world space, `noise` in
+// terrain_common.glsl
+[[nodiscard]] auto terrain_density(float x, float y, float z) -> float;
+
+// Densities at (x + step * i, y, z) for every i in [0, densities.size())
+void evaluate_density_row(float x, float y, float z, float step,
+                          std::span<float> densities);
+
+// Name of the instruction set used by evaluate_density_row
+[[nodiscard]] auto density_instruction_set() -> const char*;
+
+// Chunks of every level of detail have the same lattice, with points
+// `chunk.scale()` apart in world space. Their meshes are thus in cells, and
+// scaled when drawn
+[[nodiscard]] auto generate_density_field(ChunkKey chunk) -> ChunkDensityField;
+
+// Side of the isolevel of the lattice points of a chunk
+enum class ChunkContents {
+  mixed, // May have triangles
+  air,   // No point below the isolevel
+  solid, // Every point below the isolevel
+};
+
+// Bounds the density over the chunk from the amplitude of each noise octave
+// and the hashes of its coarsest lattices, in tens of microseconds, without
+// generating the density field. Conservative: chunks near the surface may be
+// mixed without having any triangle, but air and solid chunks never have any
+[[nodiscard]] auto classify_chunk(ChunkKey chunk) -> ChunkContents;
+
+// Width of the transition cells, in cells. The cells along a face with
+// transition cells are squeezed to make room for them
+inline constexpr float transition_cell_width = 0.5f;
+
+// Bit `face` of `transition_faces` adds transition cells along that face, see
+// transition_cell_tables.hpp and ChunkLodLayout::transition_faces. Without any,
+// the mesh is the same as the one of the meshing shaders
+[[nodiscard]] auto mesh_density_field(const ChunkDensityField& field,
+                                      std::uint32_t transition_faces = 0)
+    -> ChunkMesh;
+
+// Mesh of the `cell_count`^3 cells from `first_cell`, with vertices welded
+// only within them. Has the triangles of mesh_density_field without transition
+// faces for those cells, in the same order, with indices relative to the first
+// vertex
+[[nodiscard]] auto mesh_density_cells(const ChunkDensityField& field,
+                                      std::array<int, 3> first_cell,
+                                      int cell_count) -> ChunkMesh;
+
+[[nodiscard]] auto mesh_chunk_on_cpu(ChunkKey chunk,
+                                     std::uint32_t transition_faces = 0)
+    -> ChunkMesh;
+
+#endif // VOXEL_GAME_TERRAIN_CPU_MESHER_HPP
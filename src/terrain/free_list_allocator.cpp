@@ -0,0 +1,68 @@
+#include "free_list_allocator.hpp"
+
+#include <beyond/utils/assert.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+FreeListAllocator::FreeListAllocator(std::uint32_t capacity)
+    : capacity_{capacity}
+{
+  if (capacity_ != 0) { free_blocks_.emplace(0, capacity_); }
+}
+
+auto FreeListAllocator::allocate(std::uint32_t size)
+    -> beyond::optional<std::uint32_t>
+{
+  BEYOND_ENSURE(size != 0);
+
+  const auto block = std::ranges::find_if(
+      free_blocks_, [size](const auto& block) { return block.second >= size; });
+  if (block == free_blocks_.end()) { return {}; }
+
+  const auto [offset, block_size] = *block;
+  free_blocks_.erase(block);
+  if (block_size > size) {
+    free_blocks_.emplace(offset + size, block_size - size);
+  }
+
+  used_ += size;
+  return offset;
+}
+
+void FreeListAllocator::free(std::uint32_t offset, std::uint32_t size)
+{
+  BEYOND_ENSURE(size != 0 && offset + size <= capacity_);
+  BEYOND_ENSURE(size <= used_);
+  used_ -= size;
+
+  auto next = free_blocks_.lower_bound(offset);
+  BEYOND_ENSURE(next == free_blocks_.end() || next->first >= offset + size);
+
+  // Merge with the following block
+  if (next != free_blocks_.end() && next->first == offset + size) {
+    size += next->second;
+    next = free_blocks_.erase(next);
+  }
+
+  // Merge with the preceding block
+  if (next != free_blocks_.begin()) {
+    const auto previous = std::prev(next);
+    BEYOND_ENSURE(previous->first + previous->second <= offset);
+    if (previous->first + previous->second == offset) {
+      previous->second += size;
+      return;
+    }
+  }
+
+  free_blocks_.emplace_hint(next, offset, size);
+}
+
+auto FreeListAllocator::largest_free_block() const -> std::uint32_t
+{
+  std::uint32_t largest = 0;
+  for (const auto& [offset, size] : free_blocks_) {
+    largest = std::max(largest, size);
+  }
+  return largest;
+}
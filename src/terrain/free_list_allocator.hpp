@@ -0,0 +1,44 @@
+#ifndef VOXEL_GAME_TERRAIN_FREE_LIST_ALLOCATOR_HPP
+#define VOXEL_GAME_TERRAIN_FREE_LIST_ALLOCATOR_HPP
+
+#include <cstdint>
+#include <map>
+
+#include <beyond/types/optional.hpp>
+
+// Hands out ranges of a linear address space (e.g. vertices of a large vertex
+// buffer) with a first-fit search over the free blocks. Adjacent free blocks
+// are merged whenever a range is freed, so the free list never holds two
+// neighbouring blocks
+class FreeListAllocator {
+  // Offset -> size of each free block
+  std::map<std::uint32_t, std::uint32_t> free_blocks_;
+  std::uint32_t capacity_ = 0;
+  std::uint32_t used_ = 0;
+
+public:
+  explicit FreeListAllocator(std::uint32_t capacity);
+
+  // Returns the offset of the allocated range, or nothing if no free block is
+  // large enough
+  [[nodiscard]] auto allocate(std::uint32_t size)
+      -> beyond::optional<std::uint32_t>;
+  // `size` needs to be the size passed to the `allocate` that returned `offset`
+  void free(std::uint32_t offset, std::uint32_t size);
+
+  [[nodiscard]] auto capacity() const -> std::uint32_t
+  {
+    return capacity_;
+  }
+  [[nodiscard]] auto used() const -> std::uint32_t
+  {
+    return used_;
+  }
+  [[nodiscard]] auto free_block_count() const -> std::size_t
+  {
+    return free_blocks_.size();
+  }
+  [[nodiscard]] auto largest_free_block() const -> std::uint32_t;
+};
+
+#endif // VOXEL_GAME_TERRAIN_FREE_LIST_ALLOCATOR_HPP
@@ -1,10 +1,8 @@
 #include "marching_cube_tables.hpp"
 #include <beyond/utils/to_pointer.hpp>
 
-namespace {
-
 // clang-format off
-static constexpr std::uint32_t edge_table[256] = {
+const std::uint32_t edge_table[256] = {
     0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
     0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
     0x190, 0x99 , 0x393, 0x29a, 0x596, 0x49f, 0x795, 0x69c,
@@ -37,7 +35,7 @@ static constexpr std::uint32_t edge_table[256] = {
     0x69c, 0x795, 0x49f, 0x596, 0x29a, 0x393, 0x99 , 0x190,
     0xf00, 0xe09, 0xd03, 0xc0a, 0xb06, 0xa0f, 0x905, 0x80c,
     0x70c, 0x605, 0x50f, 0x406, 0x30a, 0x203, 0x109, 0x0 };
-static constexpr std::int32_t tri_table[256][16] =
+const std::int32_t tri_table[256][16] =
     {{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
      {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
      {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
@@ -295,7 +293,6 @@ static constexpr std::int32_t tri_table[256][16] =
      {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
      {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}};
 // clang-format on
-} // anonymous namespace
 
 auto generate_edge_table_buffer(vkh::Context& context)
     -> vkh::Expected<vkh::Buffer>
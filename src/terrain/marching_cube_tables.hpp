@@ -3,6 +3,13 @@
 
 #include "../vulkan_helpers/buffer.hpp"
 
+#include <cstdint>
+
+// Intersected edges of each cube configuration, indexed by the cube index
+extern const std::uint32_t edge_table[256];
+// Edges of the triangles of each cube configuration, terminated by -1
+extern const std::int32_t tri_table[256][16];
+
 auto generate_edge_table_buffer(vkh::Context& context)
     -> vkh::Expected<vkh::Buffer>;
 
@@ -0,0 +1,81 @@
+#ifndef VOXEL_GAME_TERRAIN_MORTON_HPP
+#define VOXEL_GAME_TERRAIN_MORTON_HPP
+
+#include <beyond/math/vector.hpp>
+
+#include <cstdint>
+
+// 3D Morton codes (Z-order) of chunk coordinates. Each axis keeps 20 bits, so
+// coordinates need to be within [-2^19, 2^19). The four bits above the 60 bits
+// of the axes are left for the caller, see ChunkKey
+
+inline constexpr int morton_axis_bits = 20;
+inline constexpr std::int32_t morton_axis_bias = 1 << (morton_axis_bits - 1);
+// Bits of each axis in a code
+inline constexpr std::uint64_t morton_x_mask = 0x0249249249249249;
+inline constexpr std::uint64_t morton_y_mask = morton_x_mask << 1;
+inline constexpr std::uint64_t morton_z_mask = morton_x_mask << 2;
+
+// Spreads the 20 low bits of `value` to every third bit
+[[nodiscard]] constexpr auto morton_spread(std::uint64_t value) -> std::uint64_t
+{
+  value &= 0xfffff;
+  value = (value | value << 32) & 0x1f00000000ffff;
+  value = (value | value << 16) & 0x1f0000ff0000ff;
+  value = (value | value << 8) & 0x100f00f00f00f00f;
+  value = (value | value << 4) & 0x10c30c30c30c30c3;
+  value = (value | value << 2) & morton_x_mask;
+  return value;
+}
+
+// Inverse of morton_spread
+[[nodiscard]] constexpr auto morton_compact(std::uint64_t value)
+    -> std::uint64_t
+{
+  value &= morton_x_mask;
+  value = (value | value >> 2) & 0x10c30c30c30c30c3;
+  value = (value | value >> 4) & 0x100f00f00f00f00f;
+  value = (value | value >> 8) & 0x1f0000ff0000ff;
+  value = (value | value >> 16) & 0x1f00000000ffff;
+  value = (value | value >> 32) & 0xfffff;
+  return value;
+}
+
+[[nodiscard]] constexpr auto morton_encode(beyond::IVec3 position)
+    -> std::uint64_t
+{
+  const auto biased = [](std::int32_t coordinate) {
+    return static_cast<std::uint64_t>(coordinate + morton_axis_bias);
+  };
+  return morton_spread(biased(position.x)) |
+         morton_spread(biased(position.y)) << 1 |
+         morton_spread(biased(position.z)) << 2;
+}
+
+[[nodiscard]] constexpr auto morton_decode(std::uint64_t code) -> beyond::IVec3
+{
+  const auto unbiased = [](std::uint64_t axis) {
+    return static_cast<std::int32_t>(axis) - morton_axis_bias;
+  };
+  return beyond::IVec3{unbiased(morton_compact(code)),
+                       unbiased(morton_compact(code >> 1)),
+                       unbiased(morton_compact(code >> 2))};
+}
+
+// Steps one chunk along the axis of `axis_mask` without decoding: the bits of
+// the other axes are filled in (or cleared) so that the carry (or borrow)
+// ripples through the bits of that axis only. Bits above the axes are kept
+[[nodiscard]] constexpr auto morton_increment(std::uint64_t code,
+                                              std::uint64_t axis_mask)
+    -> std::uint64_t
+{
+  return (((code | ~axis_mask) + 1) & axis_mask) | (code & ~axis_mask);
+}
+[[nodiscard]] constexpr auto morton_decrement(std::uint64_t code,
+                                              std::uint64_t axis_mask)
+    -> std::uint64_t
+{
+  return (((code & axis_mask) - 1) & axis_mask) | (code & ~axis_mask);
+}
+
+#endif // VOXEL_GAME_TERRAIN_MORTON_HPP
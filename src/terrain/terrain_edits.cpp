@@ -0,0 +1,400 @@
+#include "terrain_edits.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+constexpr int chunk_dimension = TerrainEdits::chunk_dimension;
+constexpr int brick_dimension = TerrainEdits::brick_dimension;
+constexpr int bricks_per_axis = TerrainEdits::bricks_per_axis;
+constexpr int halo = ChunkDensityField::halo;
+constexpr int points_per_axis = ChunkDensityField::points_per_axis;
+
+// Rounds toward negative infinity, for a positive `b`
+[[nodiscard]] constexpr auto floor_div(int a, int b) -> int
+{
+  return a >= 0 ? a / b : -((b - 1 - a) / b);
+}
+
+[[nodiscard]] constexpr auto ceil_div(int a, int b) -> int
+{
+  return -floor_div(-a, b);
+}
+
+[[nodiscard]] auto to_array(beyond::IVec3 v) -> std::array<int, 3>
+{
+  return {v.x, v.y, v.z};
+}
+
+[[nodiscard]] auto to_vec(std::array<int, 3> a) -> beyond::IVec3
+{
+  return {a[0], a[1], a[2]};
+}
+
+// Chunk of level 0 that owns a coordinate, and the offset of the coordinate
+// from the first corner of that chunk
+[[nodiscard]] constexpr auto owner_chunk(int coordinate) -> int
+{
+  return floor_div(coordinate - chunk_origin(0, 1), chunk_dimension);
+}
+[[nodiscard]] constexpr auto owned_offset(int coordinate) -> int
+{
+  return coordinate - chunk_origin(owner_chunk(coordinate), 1);
+}
+
+[[nodiscard]] constexpr auto brick_index(std::array<int, 3> offset)
+    -> std::size_t
+{
+  return static_cast<std::size_t>(
+      ((offset[2] / brick_dimension) * bricks_per_axis +
+       offset[1] / brick_dimension) *
+          bricks_per_axis +
+      offset[0] / brick_dimension);
+}
+
+[[nodiscard]] constexpr auto index_in_brick(std::array<int, 3> offset)
+    -> std::size_t
+{
+  return static_cast<std::size_t>(
+      ((offset[2] % brick_dimension) * brick_dimension +
+       offset[1] % brick_dimension) *
+          brick_dimension +
+      offset[0] % brick_dimension);
+}
+
+[[nodiscard]] auto intersection(const GridBox& a, const GridBox& b) -> GridBox
+{
+  return GridBox{
+      .min = {std::max(a.min.x, b.min.x), std::max(a.min.y, b.min.y),
+              std::max(a.min.z, b.min.z)},
+      .max = {std::min(a.max.x, b.max.x), std::min(a.max.y, b.max.y),
+              std::min(a.max.z, b.max.z)},
+  };
+}
+
+// Chunks of level 0 that own the points of the box
+[[nodiscard]] auto owner_chunks(const GridBox& points) -> GridBox
+{
+  return GridBox{
+      .min = {owner_chunk(points.min.x), owner_chunk(points.min.y),
+              owner_chunk(points.min.z)},
+      .max = {owner_chunk(points.max.x), owner_chunk(points.max.y),
+              owner_chunk(points.max.z)},
+  };
+}
+
+template <typename Function>
+void for_each_position(const GridBox& box, Function&& function)
+{
+  for (int z = box.min.z; z <= box.max.z; ++z) {
+    for (int y = box.min.y; y <= box.max.y; ++y) {
+      for (int x = box.min.x; x <= box.max.x; ++x) {
+        function(beyond::IVec3{x, y, z});
+      }
+    }
+  }
+}
+
+} // anonymous namespace
+
+auto GridBox::intersects(const GridBox& other) const -> bool
+{
+  return !intersection(*this, other).is_empty();
+}
+
+auto lattice_box(ChunkKey chunk) -> GridBox
+{
+  const int scale = chunk.scale();
+  const auto first = [scale](int chunk_coordinate) {
+    return chunk_origin(chunk_coordinate, scale) - scale * halo;
+  };
+  const beyond::IVec3 min{first(chunk.position.x), first(chunk.position.y),
+                          first(chunk.position.z)};
+  const int extent = scale * (points_per_axis - 1);
+  return GridBox{.min = min,
+                 .max = {min.x + extent, min.y + extent, min.z + extent}};
+}
+
+auto chunks_reading(const GridBox& points, int lod) -> GridBox
+{
+  if (points.is_empty()) { return {}; }
+  const ChunkKey origin_chunk{.lod = lod};
+  const GridBox origin_lattice = lattice_box(origin_chunk);
+  const int chunk_extent = chunk_dimension * origin_chunk.scale();
+  // The lattice of the chunk at c spans origin_lattice shifted by
+  // c * chunk_extent
+  const auto first = [&](int min, int lattice_max) {
+    return ceil_div(min - lattice_max, chunk_extent);
+  };
+  const auto last = [&](int max, int lattice_min) {
+    return floor_div(max - lattice_min, chunk_extent);
+  };
+  return GridBox{
+      .min = {first(points.min.x, origin_lattice.max.x),
+              first(points.min.y, origin_lattice.max.y),
+              first(points.min.z, origin_lattice.max.z)},
+      .max = {last(points.max.x, origin_lattice.min.x),
+              last(points.max.y, origin_lattice.min.y),
+              last(points.max.z, origin_lattice.min.z)},
+  };
+}
+
+auto lattice_points_in(ChunkKey chunk, const GridBox& points) -> GridBox
+{
+  const GridBox lattice = lattice_box(chunk);
+  const GridBox inside = intersection(lattice, points);
+  if (inside.is_empty()) { return {}; }
+  const int scale = chunk.scale();
+  const auto first = [&](int min, int lattice_min) {
+    return ceil_div(min - lattice_min, scale) - halo;
+  };
+  const auto last = [&](int max, int lattice_min) {
+    return floor_div(max - lattice_min, scale) - halo;
+  };
+  return GridBox{
+      .min = {first(inside.min.x, lattice.min.x),
+              first(inside.min.y, lattice.min.y),
+              first(inside.min.z, lattice.min.z)},
+      .max = {last(inside.max.x, lattice.min.x),
+              last(inside.max.y, lattice.min.y),
+              last(inside.max.z, lattice.min.z)},
+  };
+}
+
+auto TerrainEdits::apply(const Brush& brush) -> GridBox
+{
+  const float radius = std::clamp(brush.radius, 0.f, max_brush_radius);
+  const std::array<float, 3> center = {brush.center.x, brush.center.y,
+                                       brush.center.z};
+  std::array<int, 3> min{};
+  std::array<int, 3> max{};
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    min[axis] = static_cast<int>(std::ceil(center[axis] - radius));
+    max[axis] = static_cast<int>(std::floor(center[axis] + radius));
+  }
+  const GridBox box{.min = to_vec(min), .max = to_vec(max)};
+  if (box.is_empty()) { return box; }
+
+  // Falls off over the last unit of the radius, so that the surface moves
+  // smoothly with the radius and the center
+  const auto weight = [&](beyond::IVec3 point) {
+    const std::array<int, 3> p = to_array(point);
+    std::array<float, 3> d{};
+    for (std::size_t axis = 0; axis < 3; ++axis) {
+      d[axis] = std::abs(static_cast<float>(p[axis]) - center[axis]);
+    }
+    const float distance = brush.shape == BrushShape::sphere
+                               ? std::sqrt(d[0] * d[0] + d[1] * d[1] +
+                                           d[2] * d[2])
+                               : std::max({d[0], d[1], d[2]});
+    return std::clamp(radius - distance, 0.f, 1.f);
+  };
+
+  const std::scoped_lock lock{mutex_};
+  if (brush.mode == BrushMode::smooth) {
+    // Densities before the edit, over the box and one point around it
+    const GridBox margin{
+        .min = {box.min.x - 1, box.min.y - 1, box.min.z - 1},
+        .max = {box.max.x + 1, box.max.y + 1, box.max.z + 1},
+    };
+    const std::array<int, 3> size = {margin.max.x - margin.min.x + 1,
+                                     margin.max.y - margin.min.y + 1,
+                                     margin.max.z - margin.min.z + 1};
+    const auto index_of = [&](int x, int y, int z) {
+      return static_cast<std::size_t>(
+          ((z - margin.min.z) * size[1] + (y - margin.min.y)) * size[0] +
+          (x - margin.min.x));
+    };
+    std::vector<float> before(
+        static_cast<std::size_t>(size[0] * size[1] * size[2]));
+    for_each_position(margin, [&](beyond::IVec3 p) {
+      before[index_of(p.x, p.y, p.z)] = density_at_locked(p);
+    });
+
+    const float rate = std::clamp(brush.strength, 0.f, 1.f);
+    for_each_position(box, [&](beyond::IVec3 p) {
+      const float w = weight(p);
+      if (w == 0.f) { return; }
+      const auto [x, y, z] = to_array(p);
+      const float mean =
+          (before[index_of(x - 1, y, z)] + before[index_of(x + 1, y, z)] +
+           before[index_of(x, y - 1, z)] + before[index_of(x, y + 1, z)] +
+           before[index_of(x, y, z - 1)] + before[index_of(x, y, z + 1)]) /
+          6.f;
+      delta(p) += rate * w * (mean - before[index_of(x, y, z)]);
+    });
+  } else {
+    const float change =
+        brush.mode == BrushMode::add ? -brush.strength : brush.strength;
+    for_each_position(box, [&](beyond::IVec3 p) {
+      const float w = weight(p);
+      if (w != 0.f) { delta(p) += change * w; }
+    });
+  }
+
+  if (edited_points_.is_empty()) {
+    edited_points_ = box;
+  } else {
+    edited_points_ = GridBox{
+        .min = {std::min(edited_points_.min.x, box.min.x),
+                std::min(edited_points_.min.y, box.min.y),
+                std::min(edited_points_.min.z, box.min.z)},
+        .max = {std::max(edited_points_.max.x, box.max.x),
+                std::max(edited_points_.max.y, box.max.y),
+                std::max(edited_points_.max.z, box.max.z)},
+    };
+  }
+  ++edit_count_;
+  return box;
+}
+
+void TerrainEdits::add_deltas(ChunkKey chunk, ChunkDensityField& field) const
+{
+  const std::shared_lock lock{mutex_};
+  const GridBox lattice = lattice_box(chunk);
+  const GridBox edited = intersection(lattice, edited_points_);
+  if (edited.is_empty()) { return; }
+
+  const int scale = chunk.scale();
+  const std::array<int, 3> lattice_min = to_array(lattice.min);
+  for_each_position(owner_chunks(edited), [&](beyond::IVec3 owner) {
+    const ChunkDeltas* deltas = chunks_.find(ChunkKey{.position = owner});
+    if (deltas == nullptr) { return; }
+    const std::array<int, 3> owner_origin = {chunk_origin(owner.x, 1),
+                                             chunk_origin(owner.y, 1),
+                                             chunk_origin(owner.z, 1)};
+
+    for (int b = 0; b < bricks_per_axis * bricks_per_axis * bricks_per_axis;
+         ++b) {
+      const Brick* brick = deltas->bricks[static_cast<std::size_t>(b)].get();
+      if (brick == nullptr) { continue; }
+      // Lattice points of the chunk in the brick, along each axis
+      const std::array<int, 3> brick_position = {
+          b % bricks_per_axis, b / bricks_per_axis % bricks_per_axis,
+          b / (bricks_per_axis * bricks_per_axis)};
+      std::array<int, 3> first{};
+      std::array<int, 3> last{};
+      std::array<int, 3> brick_min{};
+      for (std::size_t axis = 0; axis < 3; ++axis) {
+        brick_min[axis] =
+            owner_origin[axis] + brick_dimension * brick_position[axis];
+        first[axis] = std::max(
+            0, ceil_div(brick_min[axis] - lattice_min[axis], scale));
+        last[axis] = std::min(
+            points_per_axis - 1,
+            floor_div(brick_min[axis] + brick_dimension - 1 - lattice_min[axis],
+                      scale));
+      }
+      for_each_position(
+          GridBox{.min = to_vec(first), .max = to_vec(last)},
+          [&](beyond::IVec3 lattice_point) {
+            const std::array<int, 3> i = to_array(lattice_point);
+            std::array<int, 3> offset{};
+            for (std::size_t axis = 0; axis < 3; ++axis) {
+              offset[axis] =
+                  lattice_min[axis] + scale * i[axis] - brick_min[axis];
+            }
+            field.densities[ChunkDensityField::index_of(
+                i[0] - halo, i[1] - halo, i[2] - halo)] +=
+                (*brick)[index_in_brick(offset)];
+          });
+    }
+  });
+}
+
+auto TerrainEdits::is_edited(ChunkKey chunk) const -> bool
+{
+  const std::shared_lock lock{mutex_};
+  const GridBox edited = intersection(lattice_box(chunk), edited_points_);
+  if (edited.is_empty()) { return false; }
+  bool found = false;
+  for_each_position(owner_chunks(edited), [&](beyond::IVec3 owner) {
+    found = found || chunks_.contains(ChunkKey{.position = owner});
+  });
+  return found;
+}
+
+auto TerrainEdits::density_at(beyond::IVec3 point) const -> float
+{
+  const std::shared_lock lock{mutex_};
+  return density_at_locked(point);
+}
+
+auto TerrainEdits::raycast(beyond::Point3 origin, beyond::Vec3 direction,
+                           float max_distance) const
+    -> std::optional<beyond::Point3>
+{
+  constexpr float step = 0.5f;
+  const std::shared_lock lock{mutex_};
+  for (float t = 0; t <= max_distance; t += step) {
+    const beyond::Point3 point{origin.x + direction.x * t,
+                               origin.y + direction.y * t,
+                               origin.z + direction.z * t};
+    const beyond::IVec3 nearest{static_cast<int>(std::lround(point.x)),
+                                static_cast<int>(std::lround(point.y)),
+                                static_cast<int>(std::lround(point.z))};
+    if (density_at_locked(nearest) < 0.f) { return point; }
+  }
+  return std::nullopt;
+}
+
+auto TerrainEdits::edit_count() const -> std::uint64_t
+{
+  const std::shared_lock lock{mutex_};
+  return edit_count_;
+}
+
+auto TerrainEdits::brick_count() const -> std::size_t
+{
+  const std::shared_lock lock{mutex_};
+  return brick_count_;
+}
+
+auto TerrainEdits::memory_bytes() const -> std::size_t
+{
+  const std::shared_lock lock{mutex_};
+  return brick_count_ * sizeof(Brick) +
+         chunks_.capacity() * (sizeof(ChunkDeltas) + sizeof(std::uint64_t));
+}
+
+auto TerrainEdits::find_delta(beyond::IVec3 point) const -> const float*
+{
+  const ChunkDeltas* deltas = chunks_.find(ChunkKey{
+      .position = {owner_chunk(point.x), owner_chunk(point.y),
+                   owner_chunk(point.z)}});
+  if (deltas == nullptr) { return nullptr; }
+  const std::array<int, 3> offset = {owned_offset(point.x),
+                                     owned_offset(point.y),
+                                     owned_offset(point.z)};
+  const Brick* brick = deltas->bricks[brick_index(offset)].get();
+  return brick == nullptr ? nullptr : &(*brick)[index_in_brick(offset)];
+}
+
+auto TerrainEdits::delta(beyond::IVec3 point) -> float&
+{
+  ChunkDeltas& deltas = chunks_[ChunkKey{
+      .position = {owner_chunk(point.x), owner_chunk(point.y),
+                   owner_chunk(point.z)}}];
+  const std::array<int, 3> offset = {owned_offset(point.x),
+                                     owned_offset(point.y),
+                                     owned_offset(point.z)};
+  std::unique_ptr<Brick>& brick = deltas.bricks[brick_index(offset)];
+  if (brick == nullptr) {
+    brick = std::make_unique<Brick>();
+    brick->fill(0.f);
+    ++brick_count_;
+  }
+  return (*brick)[index_in_brick(offset)];
+}
+
+auto TerrainEdits::density_at_locked(beyond::IVec3 point) const -> float
+{
+  const float* delta = find_delta(point);
+  return terrain_density(static_cast<float>(point.x),
+                         static_cast<float>(point.y),
+                         static_cast<float>(point.z)) +
+         (delta != nullptr ? *delta : 0.f);
+}
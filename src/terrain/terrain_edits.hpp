@@ -0,0 +1,128 @@
+#ifndef VOXEL_GAME_TERRAIN_TERRAIN_EDITS_HPP
+#define VOXEL_GAME_TERRAIN_TERRAIN_EDITS_HPP
+
+#include "chunk_key.hpp"
+#include "chunk_map.hpp"
+#include "cpu_mesher.hpp"
+
+#include <beyond/math/point.hpp>
+#include <beyond/math/vector.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+
+// Box of integer coordinates, bounds included. Empty if `min` is past `max`
+// along any axis
+struct GridBox {
+  beyond::IVec3 min{0, 0, 0};
+  beyond::IVec3 max{-1, -1, -1};
+
+  [[nodiscard]] auto is_empty() const -> bool
+  {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+  [[nodiscard]] auto intersects(const GridBox& other) const -> bool;
+};
+
+// World-space points of the lattice of a chunk, see generate_density_field
+[[nodiscard]] auto lattice_box(ChunkKey chunk) -> GridBox;
+// Positions of the chunks of level `lod` whose lattice has points in `points`
+[[nodiscard]] auto chunks_reading(const GridBox& points, int lod) -> GridBox;
+// Coordinates in ChunkDensityField of the lattice points of `chunk` in
+// `points`
+[[nodiscard]] auto lattice_points_in(ChunkKey chunk, const GridBox& points)
+    -> GridBox;
+
+enum class BrushShape {
+  sphere,
+  box,
+};
+
+enum class BrushMode {
+  add,      // Pushes the density below the isolevel
+  subtract, // Pushes it above
+  smooth,   // Moves it toward the mean of the 6 neighbors of each point
+};
+
+struct Brush {
+  BrushShape shape = BrushShape::sphere;
+  BrushMode mode = BrushMode::add;
+  beyond::Point3 center;
+  float radius = 4; // Half the side of boxes
+  // Density added or removed under the brush, or for smoothing, the fraction
+  // of the way to the mean of the neighbors
+  float strength = 1;
+};
+
+// Sparse layer of density deltas on top of the procedural terrain, at the
+// points of the lattice of level 0, which are those of integer world
+// coordinates. The chunks of other levels read the deltas at their own lattice
+// points
+//
+// Deltas are kept per chunk of level 0, in bricks of brick_dimension^3 points
+// allocated on the first edit that touches them. A chunk of level 0 owns the
+// chunk_dimension^3 points from its first corner, and the points of its halo
+// and last corners belong to its neighbors, so chunks sharing a boundary read
+// the same deltas
+//
+// Edits are made on one thread while the tasks of the thread pool read the
+// deltas, under a shared mutex
+class TerrainEdits {
+public:
+  static constexpr int chunk_dimension = ChunkDensityField::chunk_dimension;
+  static constexpr int brick_dimension = 8;
+  static constexpr int bricks_per_axis = chunk_dimension / brick_dimension;
+  static constexpr std::size_t brick_point_count =
+      brick_dimension * brick_dimension * brick_dimension;
+  // Larger brushes are clamped to it
+  static constexpr float max_brush_radius = 32;
+
+private:
+  using Brick = std::array<float, brick_point_count>;
+  struct ChunkDeltas {
+    std::array<std::unique_ptr<Brick>, bricks_per_axis * bricks_per_axis *
+                                           bricks_per_axis>
+        bricks;
+  };
+
+  mutable std::shared_mutex mutex_;
+  ChunkMap<ChunkDeltas> chunks_; // Chunks of level 0 with a brick
+  GridBox edited_points_;        // Bounds of every edit
+  std::size_t brick_count_ = 0;
+  std::uint64_t edit_count_ = 0;
+
+public:
+  // Returns the points whose density changed, an empty box if none
+  auto apply(const Brush& brush) -> GridBox;
+
+  // Adds the deltas at the lattice points of `chunk` to its densities
+  void add_deltas(ChunkKey chunk, ChunkDensityField& field) const;
+  // Whether an edit may have changed a lattice point of `chunk`, which then
+  // differs from the procedural terrain
+  [[nodiscard]] auto is_edited(ChunkKey chunk) const -> bool;
+
+  // Terrain density, with the deltas, at a point of integer coordinates
+  [[nodiscard]] auto density_at(beyond::IVec3 point) const -> float;
+  // First point below the isolevel along the ray, sampled every half unit.
+  // `direction` needs to be normalized
+  [[nodiscard]] auto raycast(beyond::Point3 origin, beyond::Vec3 direction,
+                             float max_distance) const
+      -> std::optional<beyond::Point3>;
+
+  [[nodiscard]] auto edit_count() const -> std::uint64_t;
+  [[nodiscard]] auto brick_count() const -> std::size_t;
+  [[nodiscard]] auto memory_bytes() const -> std::size_t;
+
+private:
+  // The functions below expect the caller to hold the mutex
+  [[nodiscard]] auto find_delta(beyond::IVec3 point) const -> const float*;
+  // Allocates the brick of the point if needed
+  [[nodiscard]] auto delta(beyond::IVec3 point) -> float&;
+  [[nodiscard]] auto density_at_locked(beyond::IVec3 point) const -> float;
+};
+
+#endif // VOXEL_GAME_TERRAIN_TERRAIN_EDITS_HPP
@@ -0,0 +1,186 @@
+#include "transition_cell_tables.hpp"
+
+#include <beyond/utils/assert.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// The tables are generated the way marching cubes tables can be: the surface
+// crosses each face of the cell along segments between the intersected edges
+// of the face, which join into closed loops around the cell, and each loop is
+// triangulated as a fan. The cell is convex, so the fans stay inside it
+//
+// A face crossed by the surface four times is ambiguous. The segments then
+// always cut off the corners below the isolevel, which is what tri_table does
+// for cubes with at most four such corners
+
+namespace {
+
+// Vertices of the polyhedron of a transition cell: the 9 samples of the fine
+// side, then the corners of the coarse side
+constexpr int fine_vertex_count = transition_cell_sample_count;
+constexpr std::array<int, 4> coarse_corner_samples = {0, 2, 6, 8};
+
+[[nodiscard]] constexpr auto sample_of(int vertex) -> int
+{
+  return vertex < fine_vertex_count
+             ? vertex
+             : coarse_corner_samples[static_cast<std::size_t>(
+                   vertex - fine_vertex_count)];
+}
+
+// In half cells, so that the center of the cell has integer coordinates
+[[nodiscard]] constexpr auto position_of(int vertex) -> std::array<int, 3>
+{
+  const int sample = sample_of(vertex);
+  return {2 * (sample % 3), 2 * (sample / 3),
+          vertex < fine_vertex_count ? 0 : 2};
+}
+constexpr std::array<int, 3> cell_center = {2, 2, 1};
+
+struct Face {
+  int vertex_count = 0;
+  std::array<int, 5> vertices{}; // Around the face, in either direction
+};
+
+// The fine side is made of the faces of the 2x2 cells behind it
+constexpr std::array<Face, 9> faces = {{
+    {4, {0, 1, 4, 3}},
+    {4, {1, 2, 5, 4}},
+    {4, {3, 4, 7, 6}},
+    {4, {4, 5, 8, 7}},
+    {4, {9, 10, 12, 11}},
+    {5, {0, 1, 2, 10, 9}},
+    {5, {2, 5, 8, 12, 10}},
+    {5, {8, 7, 6, 11, 12}},
+    {5, {6, 3, 0, 9, 11}},
+}};
+
+// Index into transition_cell_edges, or -1 for the edges between the two sides
+[[nodiscard]] auto edge_between(int vertex, int other_vertex) -> int
+{
+  const bool is_fine = vertex < fine_vertex_count;
+  if (is_fine != (other_vertex < fine_vertex_count)) { return -1; }
+
+  const int first_sample = std::min(sample_of(vertex), sample_of(other_vertex));
+  const int second_sample =
+      std::max(sample_of(vertex), sample_of(other_vertex));
+  for (std::size_t i = 0; i < transition_cell_edges.size(); ++i) {
+    const TransitionCellEdge& edge = transition_cell_edges[i];
+    if (edge.first_sample == first_sample &&
+        edge.second_sample == second_sample && edge.is_coarse != is_fine) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
+// The vertices of the face, counter-clockwise seen from outside the cell
+[[nodiscard]] auto outward_cycle(const Face& face) -> std::vector<int>
+{
+  std::vector<int> cycle(face.vertices.begin(),
+                         face.vertices.begin() + face.vertex_count);
+
+  // Newell's method
+  std::array<int, 3> normal{};
+  std::array<int, 3> centroid{};
+  for (std::size_t i = 0; i < cycle.size(); ++i) {
+    const auto p = position_of(cycle[i]);
+    const auto q = position_of(cycle[(i + 1) % cycle.size()]);
+    normal[0] += (p[1] - q[1]) * (p[2] + q[2]);
+    normal[1] += (p[2] - q[2]) * (p[0] + q[0]);
+    normal[2] += (p[0] - q[0]) * (p[1] + q[1]);
+    for (std::size_t axis = 0; axis < 3; ++axis) { centroid[axis] += p[axis]; }
+  }
+
+  int outwardness = 0;
+  for (std::size_t axis = 0; axis < 3; ++axis) {
+    outwardness += normal[axis] * (centroid[axis] - face.vertex_count *
+                                                        cell_center[axis]);
+  }
+  if (outwardness < 0) { std::ranges::reverse(cycle); }
+  return cycle;
+}
+
+[[nodiscard]] auto generate_case(int case_index,
+                                 const std::vector<std::vector<int>>& cycles)
+    -> TransitionCellCase
+{
+  const auto is_below = [case_index](int vertex) {
+    return ((case_index >> sample_of(vertex)) & 1) != 0;
+  };
+
+  // The surface leaves each face at the end of each run of corners below the
+  // isolevel and enters it again at the start of the run. Following the
+  // segments from the leaving edge to the entering one, the corners below the
+  // isolevel are on the left seen from outside, and the segments of all the
+  // faces chain into loops
+  std::array<int, transition_cell_edges.size()> next_edges{};
+  next_edges.fill(-1);
+  for (const std::vector<int>& cycle : cycles) {
+    const int count = static_cast<int>(cycle.size());
+    const auto vertex_at = [&](int i) {
+      return cycle[static_cast<std::size_t>((i + count) % count)];
+    };
+    for (int first = 0; first < count; ++first) {
+      if (!is_below(vertex_at(first)) || is_below(vertex_at(first - 1))) {
+        continue;
+      }
+      int end = first + 1;
+      while (is_below(vertex_at(end))) { ++end; }
+      const int entering_edge = edge_between(vertex_at(first - 1),
+                                             vertex_at(first));
+      const int leaving_edge = edge_between(vertex_at(end - 1), vertex_at(end));
+      BEYOND_ENSURE(entering_edge >= 0 && leaving_edge >= 0);
+      next_edges[static_cast<std::size_t>(leaving_edge)] = entering_edge;
+    }
+  }
+
+  TransitionCellCase cell_case;
+  std::array<bool, transition_cell_edges.size()> visited{};
+  for (std::size_t start = 0; start < next_edges.size(); ++start) {
+    if (next_edges[start] < 0 || visited[start]) { continue; }
+
+    std::vector<std::uint8_t> loop;
+    for (std::size_t edge = start; !visited[edge];
+         edge = static_cast<std::size_t>(next_edges[edge])) {
+      visited[edge] = true;
+      loop.push_back(static_cast<std::uint8_t>(edge));
+    }
+
+    for (std::size_t i = 1; i + 1 < loop.size(); ++i) {
+      BEYOND_ENSURE(cell_case.triangle_count <
+                    max_transition_cell_triangle_count);
+      const auto first_index =
+          static_cast<std::size_t>(3 * cell_case.triangle_count);
+      cell_case.edges[first_index] = loop[0];
+      cell_case.edges[first_index + 1] = loop[i];
+      cell_case.edges[first_index + 2] = loop[i + 1];
+      ++cell_case.triangle_count;
+    }
+  }
+  return cell_case;
+}
+
+[[nodiscard]] auto generate_cases()
+    -> std::array<TransitionCellCase, transition_cell_case_count>
+{
+  std::vector<std::vector<int>> cycles;
+  for (const Face& face : faces) { cycles.push_back(outward_cycle(face)); }
+
+  std::array<TransitionCellCase, transition_cell_case_count> cases;
+  for (int i = 0; i < transition_cell_case_count; ++i) {
+    cases[static_cast<std::size_t>(i)] = generate_case(i, cycles);
+  }
+  return cases;
+}
+
+} // anonymous namespace
+
+auto transition_cell_cases()
+    -> const std::array<TransitionCellCase, transition_cell_case_count>&
+{
+  static const auto cases = generate_cases();
+  return cases;
+}
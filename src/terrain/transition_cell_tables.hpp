@@ -0,0 +1,64 @@
+#ifndef VOXEL_GAME_TERRAIN_TRANSITION_CELL_TABLES_HPP
+#define VOXEL_GAME_TERRAIN_TRANSITION_CELL_TABLES_HPP
+
+#include <array>
+#include <cstdint>
+
+// Transition cells join a chunk to a neighbor of the level above without
+// cracks, in the manner of Lengyel's Transvoxel. A transition cell spans 2x2
+// cells of the face of the finer chunk. Its fine side has the 3x3 lattice
+// points of the face, like the cells of the finer chunk behind it, and its
+// coarse side, on the face itself, has only the four corners, like the cell of
+// the coarser chunk across it
+//
+// In the frame of a cell, u and v run along the face and t from the fine side
+// to the coarse side. Samples are numbered u + 3 * v over the 3x3 points of
+// the face, and the four corners of the coarse side have the same values as
+// samples 0, 2, 6 and 8
+
+inline constexpr int transition_cell_sample_count = 9;
+inline constexpr int transition_cell_case_count =
+    1 << transition_cell_sample_count;
+inline constexpr int max_transition_cell_triangle_count = 12;
+
+struct TransitionCellEdge {
+  int first_sample = 0; // Lower u and v than the second one
+  int second_sample = 0;
+  bool is_coarse = false; // Between two corners of the coarse side
+};
+
+// The edges of a transition cell that the surface can cross: the 12 edges of
+// the fine side, along u then along v, then the 4 edges of the coarse side. The
+// edges between the two sides join points with the same value
+inline constexpr std::array<TransitionCellEdge, 16> transition_cell_edges = {{
+    {0, 1, false},
+    {1, 2, false},
+    {3, 4, false},
+    {4, 5, false},
+    {6, 7, false},
+    {7, 8, false},
+    {0, 3, false},
+    {3, 6, false},
+    {1, 4, false},
+    {4, 7, false},
+    {2, 5, false},
+    {5, 8, false},
+    {0, 2, true},
+    {6, 8, true},
+    {0, 6, true},
+    {2, 8, true},
+}};
+
+struct TransitionCellCase {
+  int triangle_count = 0;
+  // Indices into transition_cell_edges of the vertices of each triangle, with
+  // the same winding as tri_table in the (u, v, t) frame
+  std::array<std::uint8_t, 3 * max_transition_cell_triangle_count> edges{};
+};
+
+// Indexed by the case index of a transition cell, whose bit `i` is set if
+// sample `i` is below the isolevel. Generated on first use
+[[nodiscard]] auto transition_cell_cases()
+    -> const std::array<TransitionCellCase, transition_cell_case_count>&;
+
+#endif // VOXEL_GAME_TERRAIN_TRANSITION_CELL_TABLES_HPP
@@ -3,14 +3,20 @@
 
 #include <vulkan/vulkan.h>
 
-#include <beyond/math/vector.hpp>
-
 #include <array>
 #include <cstddef>
+#include <cstdint>
 
+// Terrain vertex packed into 12 bytes. Needs to match terrain_vertex.glsl
+//
+// The position is relative to the chunk center and quantized to 16-bit unorm
+// over the chunk extent. The normal is octahedral-encoded into two 16-bit
+// snorm
 struct Vertex {
-  beyond::Vec4 position;
-  beyond::Vec4 normal;
+  static constexpr float position_extent = 32; // Size of a chunk
+
+  std::uint16_t position[4]; // 4th component unused
+  std::int16_t normal[2];
 
   [[nodiscard]] static constexpr auto binding_description()
   {
@@ -26,13 +32,103 @@ struct Vertex {
     return std::to_array<VkVertexInputAttributeDescription>(
         {{.location = 0,
           .binding = 0,
-          .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+          .format = VK_FORMAT_R16G16B16A16_UNORM,
           .offset = offsetof(Vertex, position)},
          {.location = 1,
           .binding = 0,
-          .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+          .format = VK_FORMAT_R16G16_SNORM,
           .offset = offsetof(Vertex, normal)}});
   }
 };
+static_assert(sizeof(Vertex) == 12);
+
+namespace vertex_packing {
+
+namespace detail {
+
+[[nodiscard]] constexpr auto abs(float v) -> float
+{
+  return v < 0 ? -v : v;
+}
+
+// Treats 0 as positive so that both halves of the octahedron fold
+[[nodiscard]] constexpr auto sign_not_zero(float v) -> float
+{
+  return v < 0 ? -1.f : 1.f;
+}
+
+[[nodiscard]] constexpr auto round_to_int(float v) -> int
+{
+  return static_cast<int>(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+} // namespace detail
+
+// Maps a chunk-local coordinate in [-extent / 2, extent / 2] to unorm16
+[[nodiscard]] constexpr auto quantize_position(float v) -> std::uint16_t
+{
+  const float unorm = v / Vertex::position_extent + 0.5f;
+  const float clamped = unorm < 0 ? 0 : (unorm > 1 ? 1 : unorm);
+  return static_cast<std::uint16_t>(detail::round_to_int(clamped * 65535.f));
+}
+
+[[nodiscard]] constexpr auto dequantize_position(std::uint16_t v) -> float
+{
+  return (static_cast<float>(v) / 65535.f - 0.5f) * Vertex::position_extent;
+}
+
+[[nodiscard]] constexpr auto to_snorm16(float v) -> std::int16_t
+{
+  const float clamped = v < -1 ? -1 : (v > 1 ? 1 : v);
+  return static_cast<std::int16_t>(detail::round_to_int(clamped * 32767.f));
+}
+
+[[nodiscard]] constexpr auto from_snorm16(std::int16_t v) -> float
+{
+  const float f = static_cast<float>(v) / 32767.f;
+  return f < -1 ? -1 : f;
+}
+
+// `x`, `y`, `z` need to be normalized
+[[nodiscard]] constexpr auto encode_octahedral(float x, float y, float z)
+    -> std::array<std::int16_t, 2>
+{
+  const float l1_norm = detail::abs(x) + detail::abs(y) + detail::abs(z);
+  float u = x / l1_norm;
+  float v = y / l1_norm;
+  if (z < 0) {
+    const float folded_u = (1 - detail::abs(v)) * detail::sign_not_zero(u);
+    const float folded_v = (1 - detail::abs(u)) * detail::sign_not_zero(v);
+    u = folded_u;
+    v = folded_v;
+  }
+  return {to_snorm16(u), to_snorm16(v)};
+}
+
+// The result is not normalized
+[[nodiscard]] constexpr auto decode_octahedral(std::array<std::int16_t, 2> e)
+    -> std::array<float, 3>
+{
+  const float u = from_snorm16(e[0]);
+  const float v = from_snorm16(e[1]);
+  const float z = 1 - detail::abs(u) - detail::abs(v);
+  if (z >= 0) { return {u, v, z}; }
+  return {(1 - detail::abs(v)) * detail::sign_not_zero(u),
+          (1 - detail::abs(u)) * detail::sign_not_zero(v), z};
+}
+
+[[nodiscard]] constexpr auto pack_vertex(std::array<float, 3> position,
+                                         std::array<float, 3> normal) -> Vertex
+{
+  const auto encoded_normal = encode_octahedral(normal[0], normal[1], normal[2]);
+  return Vertex{
+      .position = {quantize_position(position[0]),
+                   quantize_position(position[1]),
+                   quantize_position(position[2]), 0},
+      .normal = {encoded_normal[0], encoded_normal[1]},
+  };
+}
+
+} // namespace vertex_packing
 
 #endif // VOXEL_GAME_VERTEX_HPP
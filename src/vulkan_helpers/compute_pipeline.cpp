@@ -0,0 +1,53 @@
+#include "compute_pipeline.hpp"
+
+#include "context.hpp"
+#include "debug_utils.hpp"
+#include "shader_module.hpp"
+
+#include <beyond/utils/assert.hpp>
+#include <beyond/utils/bit_cast.hpp>
+
+namespace vkh {
+
+[[nodiscard]] auto
+create_compute_pipeline(Context& context,
+                        const ComputePipelineCreateInfo& create_info)
+    -> Expected<VkPipeline>
+{
+  BEYOND_ENSURE(create_info.pipeline_layout != VK_NULL_HANDLE);
+  BEYOND_ENSURE(create_info.shader_filename != nullptr);
+
+  auto shader_module_ret = load_shader_module_from_file(
+      context, create_info.shader_filename,
+      {.debug_name = create_info.debug_name});
+  if (!shader_module_ret) {
+    return beyond::make_unexpected(shader_module_ret.error());
+  }
+  VkShaderModule shader_module = shader_module_ret.value();
+
+  const VkComputePipelineCreateInfo pipeline_create_info{
+      .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .stage =
+          VkPipelineShaderStageCreateInfo{
+              .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+              .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+              .module = shader_module,
+              .pName = "main",
+          },
+      .layout = create_info.pipeline_layout,
+  };
+  VkPipeline pipeline = VK_NULL_HANDLE;
+  const VkResult result = vkCreateComputePipelines(
+      context.device(), {}, 1, &pipeline_create_info, nullptr, &pipeline);
+  vkDestroyShaderModule(context.device(), shader_module, nullptr);
+  VKH_TRY(result);
+
+  if (set_debug_name(context, beyond::bit_cast<uint64_t>(pipeline),
+                     VK_OBJECT_TYPE_PIPELINE, create_info.debug_name)) {
+    report_fail_to_set_debug_name(create_info.debug_name);
+  }
+
+  return pipeline;
+}
+
+} // namespace vkh
@@ -0,0 +1,28 @@
+#ifndef VOXEL_GAME_VULKAN_COMPUTE_PIPELINE_HPP
+#define VOXEL_GAME_VULKAN_COMPUTE_PIPELINE_HPP
+
+#include <vulkan/vulkan.h>
+
+#include "error_handling.hpp"
+
+namespace vkh {
+
+class Context;
+
+struct ComputePipelineCreateInfo {
+  // Required
+  VkPipelineLayout pipeline_layout = {};
+  const char* shader_filename = nullptr; // SPIR-V with a "main" entry point
+
+  // Optional
+  const char* debug_name = nullptr;
+};
+
+[[nodiscard]] auto
+create_compute_pipeline(Context& context,
+                        const ComputePipelineCreateInfo& create_info)
+    -> Expected<VkPipeline>;
+
+} // namespace vkh
+
+#endif // VOXEL_GAME_VULKAN_COMPUTE_PIPELINE_HPP
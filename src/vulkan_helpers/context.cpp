@@ -36,8 +36,22 @@ namespace vkh {
 
 Context::Context(Window& window)
 {
+  init(&window);
+}
+
+auto Context::create_headless() -> Context
+{
+  Context context;
+  context.init(nullptr);
+  return context;
+}
+
+void Context::init(Window* window)
+{
+  const bool headless = window == nullptr;
   auto instance_ret = vkb::InstanceBuilder{}
                           .require_api_version(1, 2, 0)
+                          .set_headless(headless)
                           .use_default_debug_messenger()
                           .request_validation_layers()
                           .add_validation_feature_enable(
@@ -50,15 +64,27 @@ Context::Context(Window& window)
   }
   instance_ = instance_ret->instance;
   debug_messenger_ = instance_ret->debug_messenger;
-  surface_ = create_surface_glfw(instance_, window.glfw_window());
 
   vkb::PhysicalDeviceSelector phys_device_selector(instance_ret.value());
-  auto phys_device_ret = phys_device_selector.set_surface(surface_)
+  if (headless) {
+    phys_device_selector.defer_surface_initialization();
+  } else {
+    surface_ = create_surface_glfw(instance_, window->glfw_window());
+    phys_device_selector.set_surface(surface_);
+  }
+  auto phys_device_ret = phys_device_selector
                              .add_required_extension(
                                  VK_KHR_SHADER_NON_SEMANTIC_INFO_EXTENSION_NAME)
                              .set_required_features({
+                                 .multiDrawIndirect = true,
+                                 .drawIndirectFirstInstance = true,
                                  .fillModeNonSolid = true,
                              })
+                             .set_required_features_12({
+                                 .sType =
+                                     VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+                                 .drawIndirectCount = true,
+                             })
                              .select();
   if (!phys_device_ret) {
     fmt::print("{}\n", phys_device_ret.error().message());
@@ -86,7 +112,9 @@ Context::Context(Window& window)
   transfer_queue_family_index_ =
       vkb_device.get_queue_index(vkb::QueueType::transfer).value();
 
-  present_queue_ = vkb_device.get_queue(vkb::QueueType::present).value();
+  if (!headless) {
+    present_queue_ = vkb_device.get_queue(vkb::QueueType::present).value();
+  }
 
   functions_ = {
       .setDebugUtilsObjectNameEXT =
@@ -100,7 +128,7 @@ Context::Context(Window& window)
       .instance = instance_,
   };
   VK_CHECK(vmaCreateAllocator(&allocator_create_info, &allocator_));
-} // namespace vkh
+}
 
 Context::~Context()
 {
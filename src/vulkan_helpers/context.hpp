@@ -40,6 +40,8 @@ class Context {
 public:
   Context() = default;
   explicit Context(Window& window);
+  // A context without surface and present queue, for offscreen rendering
+  [[nodiscard]] static auto create_headless() -> Context;
   ~Context();
 
   Context(const Context&) = delete;
@@ -146,6 +148,9 @@ public:
   void unmap(const Buffer& buffer);
 
 private:
+  // `window` is null for headless contexts
+  void init(Window* window);
+
   [[nodiscard]] auto map_impl(const Buffer& buffer) -> Expected<void*>;
 };
 
@@ -0,0 +1,35 @@
+#include "query_pool.hpp"
+
+#include "context.hpp"
+#include "debug_utils.hpp"
+#include "error_handling.hpp"
+
+#include <beyond/utils/bit_cast.hpp>
+
+namespace vkh {
+
+[[nodiscard]] auto create_query_pool(Context& context,
+                                     const QueryPoolCreateInfo& create_info)
+    -> Expected<VkQueryPool>
+{
+  const VkQueryPoolCreateInfo query_pool_create_info{
+      .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .pNext = nullptr,
+      .flags = 0,
+      .queryType = create_info.query_type,
+      .queryCount = create_info.query_count,
+  };
+
+  VkQueryPool query_pool = {};
+  VKH_TRY(vkCreateQueryPool(context, &query_pool_create_info, nullptr,
+                            &query_pool));
+
+  if (set_debug_name(context, beyond::bit_cast<uint64_t>(query_pool),
+                     VK_OBJECT_TYPE_QUERY_POOL, create_info.debug_name)) {
+    report_fail_to_set_debug_name(create_info.debug_name);
+  }
+
+  return query_pool;
+}
+
+} // namespace vkh
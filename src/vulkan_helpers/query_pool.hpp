@@ -0,0 +1,26 @@
+#ifndef VOXEL_GAME_VULKAN_QUERY_POOL_HPP
+#define VOXEL_GAME_VULKAN_QUERY_POOL_HPP
+
+#include <vulkan/vulkan_core.h>
+
+#include "error_handling.hpp"
+
+#include <cstdint>
+
+namespace vkh {
+
+class Context;
+
+struct QueryPoolCreateInfo {
+  VkQueryType query_type = VK_QUERY_TYPE_TIMESTAMP;
+  std::uint32_t query_count = 0;
+  const char* debug_name = nullptr;
+};
+
+[[nodiscard]] auto create_query_pool(Context& context,
+                                     const QueryPoolCreateInfo& create_info)
+    -> Expected<VkQueryPool>;
+
+} // namespace vkh
+
+#endif // VOXEL_GAME_VULKAN_QUERY_POOL_HPP